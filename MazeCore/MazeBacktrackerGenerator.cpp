@@ -0,0 +1,172 @@
+#include "MazeBacktrackerGenerator.h"
+#include "MazeRandom.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    struct FCell
+    {
+        int32_t X;
+        int32_t Y;
+    };
+
+    constexpr FCell Directions[4] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+
+    int32_t GetCarverSeed(const FMazeParams& Params, int32_t CarverId)
+    {
+        switch (CarverId)
+        {
+        case 0: return Params.NorthSeed;
+        case 1: return Params.SouthSeed;
+        case 2: return Params.EastSeed;
+        default: return Params.WestSeed;
+        }
+    }
+
+    // Same rule as GetUnvisitedNeighbors: two cells away, unvisited, and not touching any visited cell.
+    // Guard cells count as visited, so no bounds checks are needed.
+    bool IsCarvable(const FMazeBitGrid& Grid, int32_t X, int32_t Y)
+    {
+        if (Grid.IsVisited(X, Y))
+        {
+            return false;
+        }
+        for (const FCell& Adjacent : Directions)
+        {
+            if (Grid.IsVisited(X + Adjacent.X, Y + Adjacent.Y))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int64_t CarvePath(FMazeBitGrid& Grid, FMazeCellStack& Stack, FMazeXoshiro256& Rng)
+    {
+        MAZE_TRACE_SCOPE("MazeBacktracker.CarvePath");
+        int64_t Steps = 0;
+        int64_t Backtracks = 0;
+        FCell Shuffled[4] = { Directions[0], Directions[1], Directions[2], Directions[3] };
+        FCell Neighbors[4];
+
+        while (!Stack.IsEmpty())
+        {
+            const FMazeCell Current = Stack.Top();
+            for (int32_t i = 3; i > 0; --i)
+            {
+                std::swap(Shuffled[i], Shuffled[Rng.NextBelow(uint32_t(i + 1))]);
+            }
+
+            int32_t NumNeighbors = 0;
+            for (const FCell& Direction : Shuffled)
+            {
+                const int32_t NX = Current.X + Direction.X * 2;
+                const int32_t NY = Current.Y + Direction.Y * 2;
+                if (IsCarvable(Grid, NX, NY))
+                {
+                    Neighbors[NumNeighbors++] = FCell{ NX, NY };
+                }
+            }
+
+            if (NumNeighbors > 0)
+            {
+                const FCell Next = Neighbors[Rng.NextBelow(uint32_t(NumNeighbors))];
+                Grid.Carve(Next.X, Next.Y);
+                Grid.ClearWall((Current.X + Next.X) / 2, (Current.Y + Next.Y) / 2);
+                Stack.Push(FMazeCell{ Next.X, Next.Y });
+            }
+            else
+            {
+                Stack.Pop();
+                ++Backtracks;
+            }
+            ++Steps;
+        }
+
+        // Four candidates per step, each tested along with its own four neighbours
+        MAZE_TRACE_COUNT(StepsTaken, Steps);
+        MAZE_TRACE_COUNT(Backtracks, Backtracks);
+        MAZE_TRACE_COUNT(NeighborChecks, 20 * Steps);
+        return Steps;
+    }
+
+    // Shuffled perimeter cells, corners excluded, as in the actor's CreateExits
+    void CreateExits(const FMazeParams& Params, FMazeBitGrid& Grid)
+    {
+        MAZE_TRACE_SCOPE("MazeBacktracker.CreateExits");
+        std::vector<FCell> PotentialExits;
+        for (int32_t x = 1; x < Params.MazeSize - 1; ++x)
+        {
+            PotentialExits.push_back(FCell{ x, 0 });
+            PotentialExits.push_back(FCell{ x, Params.MazeSize - 1 });
+        }
+        for (int32_t y = 1; y < Params.MazeSize - 1; ++y)
+        {
+            PotentialExits.push_back(FCell{ 0, y });
+            PotentialExits.push_back(FCell{ Params.MazeSize - 1, y });
+        }
+        FMazeSplitMix64 ExitRng(Params.GetCombinedSeed());
+        ShuffleMazeItems(PotentialExits, ExitRng);
+        const int32_t NumExits = std::min<int32_t>(std::max(Params.NumExits, 0), int32_t(PotentialExits.size()));
+        for (int32_t i = 0; i < NumExits; ++i)
+        {
+            Grid.ClearWall(PotentialExits[i].X, PotentialExits[i].Y);
+        }
+    }
+}
+
+void FMazeBacktrackerGenerator::Generate(const FMazeParams& Params, FMazeBitGrid& OutGrid)
+{
+    StepsTaken = 0;
+    {
+        MAZE_TRACE_SCOPE("MazeBacktracker.InitGrid");
+        OutGrid.Init(Params.MazeSize, Params.MazeSize);
+    }
+    if (OutGrid.IsEmpty())
+    {
+        return;
+    }
+
+    const int32_t Size = Params.MazeSize;
+    const int32_t Center = Size / 2;
+    const int32_t Start = Center - Params.StartSize / 2;
+    OutGrid.ClearRect(Start, Start, Params.StartSize, Params.StartSize);
+    {
+        MAZE_TRACE_SCOPE("MazeBacktracker.CreatePerimeterWall");
+        OutGrid.SetPerimeterWalls();
+    }
+
+    CreateExits(Params, OutGrid);
+
+    const FCell Starts[4] = {
+        { Center, Center - Params.StartSize / 2 - 1 },
+        { Center, Center + Params.StartSize / 2 },
+        { Center + Params.StartSize / 2, Center },
+        { Center - Params.StartSize / 2 - 1, Center },
+    };
+    for (const FCell& Cell : Starts)
+    {
+        if (Cell.X >= 0 && Cell.X < Size && Cell.Y >= 0 && Cell.Y < Size)
+        {
+            OutGrid.Carve(Cell.X, Cell.Y);
+        }
+    }
+
+    // One carver after the other, like the actor's CarvePath("N") ... CarvePath("W")
+    StackArena.Reserve(1, GetMazeCellStackBound(Size, Size));
+    for (int32_t CarverId = 0; CarverId < 4; ++CarverId)
+    {
+        const FCell& Cell = Starts[CarverId];
+        if (Cell.X < 0 || Cell.X >= Size || Cell.Y < 0 || Cell.Y >= Size)
+        {
+            continue;
+        }
+        FMazeXoshiro256 Rng = FMazeXoshiro256::ForStream(uint32_t(GetCarverSeed(Params, CarverId)), uint32_t(CarverId));
+        FMazeCellStack Stack = StackArena.GetStack(0);
+        Stack.Push(FMazeCell{ Cell.X, Cell.Y });
+        StepsTaken += CarvePath(OutGrid, Stack, Rng);
+    }
+}
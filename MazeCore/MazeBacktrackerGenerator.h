@@ -0,0 +1,26 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeCarverArena.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+
+// Engine-independent port of the basic actor's GenerateMaze: start room, perimeter, exits, then the four
+// carvers (N, S, E, W) each run their iterative backtracker to completion one after another on the calling thread.
+// Carver streams are FMazeXoshiro256::ForStream(Seed, CarverId) instead of FRandomStream, so layouts differ
+// from the actor's while the amount of work matches.
+class FMazeBacktrackerGenerator
+{
+public:
+    void Generate(const FMazeParams& Params, FMazeBitGrid& OutGrid);
+
+    // Carver moves (forward carves plus backtracks) of the last Generate
+    int64_t GetStepsTaken() const { return StepsTaken; }
+
+private:
+    int64_t StepsTaken = 0;
+
+    // One stack shared by the carvers, which run one at a time; kept so Generate at the same size allocates nothing
+    FMazeCarverArena StackArena;
+};
@@ -0,0 +1,444 @@
+#include "MazeBakedMaze.h"
+#include "MazeFlowField.h"
+#include "MazeTrace.h"
+
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(std::endian::native == std::endian::little, "Baked mazes are read and written in place as little-endian");
+
+namespace
+{
+    constexpr char BakedMagic[8] = { 'M', 'A', 'Z', 'E', 'B', 'A', 'K', 'E' };
+    constexpr uint64_t SectionAlignment = 64;
+    constexpr uint8_t WallTile = 0xFF;
+
+    uint64_t AlignSection(uint64_t Offset)
+    {
+        return (Offset + SectionAlignment - 1) & ~(SectionAlignment - 1);
+    }
+
+    uint64_t MixHash(uint64_t Value)
+    {
+        Value ^= Value >> 33;
+        Value *= 0xFF51AFD7ED558CCDull;
+        Value ^= Value >> 33;
+        Value *= 0xC4CEB9FE1A85EC53ull;
+        return Value ^ (Value >> 33);
+    }
+
+    uint64_t ReadWord(const uint8_t* Bytes)
+    {
+        uint64_t Word;
+        std::memcpy(&Word, Bytes, sizeof(Word));
+        return Word;
+    }
+
+    struct FSectionSizes
+    {
+        uint64_t Walls;
+        uint64_t Exits;
+        uint64_t Tiles;
+        uint64_t Distances;
+    };
+
+    FSectionSizes GetSectionSizes(int32_t Width, int32_t Height, uint32_t NumExits, uint32_t Flags, uint32_t DistanceBytes)
+    {
+        const uint64_t NumCells = uint64_t(Width) * uint64_t(Height);
+        FSectionSizes Sizes;
+        Sizes.Walls = uint64_t(FMazeBitGrid::GetNumWords(Width, Height)) * sizeof(uint64_t);
+        Sizes.Exits = uint64_t(NumExits) * sizeof(FMazeCell);
+        Sizes.Tiles = (Flags & MazeBakedTiles) ? NumCells : 0;
+        Sizes.Distances = (Flags & MazeBakedDistances) ? NumCells * DistanceBytes : 0;
+        return Sizes;
+    }
+
+    uint64_t GetChecksum(const FMazeBakedHeader& Header, const uint8_t* Walls, const uint8_t* Exits, const uint8_t* Tiles, const uint8_t* Distances)
+    {
+        const FSectionSizes Sizes = GetSectionSizes(Header.Width, Header.Height, Header.NumExits, Header.Flags, Header.DistanceBytes);
+        uint64_t Hash = HashMazeBytes(Walls, Sizes.Walls, 0);
+        Hash = HashMazeBytes(Exits, Sizes.Exits, Hash);
+        Hash = HashMazeBytes(Tiles, Sizes.Tiles, Hash);
+        Hash = HashMazeBytes(Distances, Sizes.Distances, Hash);
+
+        FMazeBakedHeader Zeroed = Header;
+        Zeroed.Checksum = 0;
+        return HashMazeBytes(&Zeroed, sizeof(Zeroed), Hash);
+    }
+
+    // Readers skip bounds checks on the strength of the guard cells, so a plane whose guard rows, guard bits or
+    // row padding are open is rejected even when the checksum is not verified
+    bool HasWallGuards(const uint64_t* Words, int32_t Width, int32_t Height)
+    {
+        constexpr int32_t Guard = FMazeBitGrid::GuardCells;
+        constexpr int32_t BitsPerWord = FMazeBitGrid::BitsPerWord;
+        const int32_t WordsPerRow = FMazeBitGrid::GetWordsPerRow(Width);
+        const size_t RowsWords = size_t(Guard) * WordsPerRow;
+        const uint64_t* Bottom = Words + size_t(Height + Guard) * WordsPerRow;
+        for (size_t i = 0; i < RowsWords; ++i)
+        {
+            if (~Words[i] != 0 || ~Bottom[i] != 0)
+            {
+                return false;
+            }
+        }
+
+        // Bits [0, Guard) and [Width + Guard, WordsPerRow * 64) of each row, the right side may reach into a second word
+        const uint64_t LeftMask = (uint64_t(1) << Guard) - 1;
+        const int32_t RightBit = Width + Guard;
+        const int32_t RightWord = RightBit / BitsPerWord;
+        const uint64_t RightMask = ~uint64_t(0) << (RightBit % BitsPerWord);
+        for (int32_t y = 0; y < Height; ++y)
+        {
+            const uint64_t* Row = Words + size_t(y + Guard) * WordsPerRow;
+            if ((Row[0] & LeftMask) != LeftMask || (Row[RightWord] & RightMask) != RightMask)
+            {
+                return false;
+            }
+            for (int32_t Word = RightWord + 1; Word < WordsPerRow; ++Word)
+            {
+                if (~Row[Word] != 0)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool WriteSection(FILE* File, const void* Data, uint64_t Size, uint64_t& InOutOffset)
+    {
+        static const uint8_t Padding[SectionAlignment] = {};
+        const uint64_t Aligned = AlignSection(InOutOffset);
+        if (Aligned > InOutOffset && std::fwrite(Padding, 1, size_t(Aligned - InOutOffset), File) != size_t(Aligned - InOutOffset))
+        {
+            return false;
+        }
+        InOutOffset = Aligned + Size;
+        return Size == 0 || std::fwrite(Data, 1, size_t(Size), File) == size_t(Size);
+    }
+}
+
+uint64_t HashMazeBytes(const void* Data, size_t Size, uint64_t Seed)
+{
+    // Four independent lanes keep the multiplies from serialising on one dependency chain
+    const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+    uint64_t Lanes[4] = { Seed ^ 0x9E3779B97F4A7C15ull, Seed ^ 0xBF58476D1CE4E5B9ull, Seed ^ 0x94D049BB133111EBull, Seed ^ 0xD6E8FEB86659FD93ull };
+
+    size_t Offset = 0;
+    for (; Offset + 32 <= Size; Offset += 32)
+    {
+        for (int32_t Lane = 0; Lane < 4; ++Lane)
+        {
+            Lanes[Lane] = std::rotl(Lanes[Lane] ^ (ReadWord(Bytes + Offset + Lane * 8) * 0x9E3779B97F4A7C15ull), 29) * 0xBF58476D1CE4E5B9ull;
+        }
+    }
+
+    uint64_t Hash = MixHash(Lanes[0]) ^ std::rotl(MixHash(Lanes[1]), 16) ^ std::rotl(MixHash(Lanes[2]), 32) ^ std::rotl(MixHash(Lanes[3]), 48);
+    for (; Offset < Size; ++Offset)
+    {
+        Hash = (Hash ^ Bytes[Offset]) * 0x100000001B3ull;
+    }
+    return MixHash(Hash ^ uint64_t(Size));
+}
+
+bool FMazeMappedFile::Open(const std::string& Path)
+{
+    Close();
+#if defined(_WIN32)
+    HANDLE File = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER FileSize;
+    HANDLE Mapping = GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0 ? CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    const void* View = Mapping ? MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!View)
+    {
+        if (Mapping)
+        {
+            CloseHandle(Mapping);
+        }
+        CloseHandle(File);
+        return false;
+    }
+    FileHandle = File;
+    MappingHandle = Mapping;
+    Data = static_cast<const uint8_t*>(View);
+    Size = size_t(FileSize.QuadPart);
+#else
+    const int Descriptor = ::open(Path.c_str(), O_RDONLY);
+    if (Descriptor < 0)
+    {
+        return false;
+    }
+    struct stat Stat;
+    void* View = MAP_FAILED;
+    if (::fstat(Descriptor, &Stat) == 0 && Stat.st_size > 0)
+    {
+        View = ::mmap(nullptr, size_t(Stat.st_size), PROT_READ, MAP_PRIVATE, Descriptor, 0);
+    }
+    // The mapping keeps the file alive on its own
+    ::close(Descriptor);
+    if (View == MAP_FAILED)
+    {
+        return false;
+    }
+    Data = static_cast<const uint8_t*>(View);
+    Size = size_t(Stat.st_size);
+#endif
+    return true;
+}
+
+void FMazeMappedFile::Close()
+{
+    if (!Data)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(Data);
+    CloseHandle(MappingHandle);
+    CloseHandle(FileHandle);
+    MappingHandle = nullptr;
+    FileHandle = nullptr;
+#else
+    ::munmap(const_cast<uint8_t*>(Data), Size);
+#endif
+    Data = nullptr;
+    Size = 0;
+}
+
+bool WriteMazeBakedFile(const std::string& Path, const FMazeParams& Params, const FMazeRect& StartRoom, const FMazeBitGrid& Grid, const FMazeBakeOptions& Options, FMazeThreadPool* Pool)
+{
+    MAZE_TRACE_SCOPE("MazeBaked.Write");
+    const int32_t Width = Grid.GetWidth();
+    const int32_t Height = Grid.GetHeight();
+    const std::vector<FMazeCell> ExitCells = GetMazeExitCells(Grid);
+
+    FMazeBakedHeader Header = {};
+    std::memcpy(Header.Magic, BakedMagic, sizeof(BakedMagic));
+    Header.Version = MazeBakedVersion;
+    Header.HeaderBytes = sizeof(FMazeBakedHeader);
+    Header.Width = Width;
+    Header.Height = Height;
+    Header.GuardCells = FMazeBitGrid::GuardCells;
+    Header.StartRoom[0] = StartRoom.X;
+    Header.StartRoom[1] = StartRoom.Y;
+    Header.StartRoom[2] = StartRoom.Width;
+    Header.StartRoom[3] = StartRoom.Height;
+    Header.Seeds[0] = Params.NorthSeed;
+    Header.Seeds[1] = Params.SouthSeed;
+    Header.Seeds[2] = Params.EastSeed;
+    Header.Seeds[3] = Params.WestSeed;
+    Header.StartSize = Params.StartSize;
+    Header.NumExits = uint32_t(ExitCells.size());
+    Header.RequestedExits = Params.NumExits;
+    Header.GeneratorId = Options.GeneratorId;
+    Header.GeneratorVersion = Options.GeneratorVersion;
+
+    std::vector<uint8_t> Tiles;
+    if (Options.bTiles)
+    {
+        FMazeTileArrays Classified;
+        FMazeTileClassifier(Pool).Classify(Grid, Classified);
+        Tiles.assign(size_t(Width) * size_t(Height), WallTile);
+        for (size_t i = 0; i < Classified.Num(); ++i)
+        {
+            Tiles[size_t(Classified.Y[i]) * size_t(Width) + size_t(Classified.X[i])] = uint8_t(uint8_t(Classified.Type[i]) | Classified.Rotation[i] << 4);
+        }
+        Header.Flags |= MazeBakedTiles;
+    }
+
+    std::vector<uint8_t> Distances;
+    if (Options.bDistances)
+    {
+        FMazeFlowField ExitField;
+        ExitField.Build(Grid, ExitCells, Pool);
+
+        // Two bytes a cell whenever the longest path allows it
+        Header.DistanceBytes = ExitField.GetMaxDistance() < 0xFFFF ? 2 : 4;
+        Distances.resize(size_t(Width) * size_t(Height) * Header.DistanceBytes);
+        for (int32_t y = 0; y < Height; ++y)
+        {
+            for (int32_t x = 0; x < Width; ++x)
+            {
+                const uint32_t Distance = ExitField.GetDistance(x, y);
+                const size_t Index = size_t(y) * size_t(Width) + size_t(x);
+                if (Header.DistanceBytes == 2)
+                {
+                    const uint16_t Narrow = Distance == FMazeFlowField::Unreachable ? uint16_t(0xFFFF) : uint16_t(Distance);
+                    std::memcpy(&Distances[Index * 2], &Narrow, sizeof(Narrow));
+                }
+                else
+                {
+                    std::memcpy(&Distances[Index * 4], &Distance, sizeof(Distance));
+                }
+            }
+        }
+        Header.Flags |= MazeBakedDistances;
+    }
+
+    const FSectionSizes Sizes = GetSectionSizes(Width, Height, Header.NumExits, Header.Flags, Header.DistanceBytes);
+    Header.WallsOffset = AlignSection(sizeof(FMazeBakedHeader));
+    Header.ExitsOffset = AlignSection(Header.WallsOffset + Sizes.Walls);
+    Header.TilesOffset = AlignSection(Header.ExitsOffset + Sizes.Exits);
+    Header.DistancesOffset = AlignSection(Header.TilesOffset + Sizes.Tiles);
+    Header.FileBytes = Header.DistancesOffset + Sizes.Distances;
+
+    const uint8_t* WallBytes = reinterpret_cast<const uint8_t*>(Grid.GetWallPlane().GetWords());
+    Header.Checksum = GetChecksum(Header, WallBytes, reinterpret_cast<const uint8_t*>(ExitCells.data()), Tiles.data(), Distances.data());
+
+    FILE* File = std::fopen(Path.c_str(), "wb");
+    if (!File)
+    {
+        return false;
+    }
+    uint64_t Offset = 0;
+    bool bWritten = WriteSection(File, &Header, sizeof(Header), Offset);
+    bWritten = bWritten && WriteSection(File, WallBytes, Sizes.Walls, Offset);
+    bWritten = bWritten && WriteSection(File, ExitCells.data(), Sizes.Exits, Offset);
+    bWritten = bWritten && WriteSection(File, Tiles.data(), Sizes.Tiles, Offset);
+    bWritten = bWritten && WriteSection(File, Distances.data(), Sizes.Distances, Offset);
+    return std::fclose(File) == 0 && bWritten;
+}
+
+bool FMazeBakedMaze::Open(const std::string& Path, bool bVerifyChecksum)
+{
+    MAZE_TRACE_SCOPE("MazeBaked.Open");
+    Close();
+    if (!File.Open(Path))
+    {
+        Error = "cannot map file";
+        return false;
+    }
+
+    const uint8_t* Data = File.GetData();
+    const FMazeBakedHeader* Candidate = reinterpret_cast<const FMazeBakedHeader*>(Data);
+    if (File.GetSize() < sizeof(FMazeBakedHeader) || std::memcmp(Candidate->Magic, BakedMagic, sizeof(BakedMagic)) != 0)
+    {
+        Error = "not a baked maze";
+    }
+    else if (Candidate->Version != MazeBakedVersion || Candidate->HeaderBytes != sizeof(FMazeBakedHeader) || Candidate->GuardCells != FMazeBitGrid::GuardCells)
+    {
+        Error = "unsupported version";
+    }
+    else
+    {
+        const FSectionSizes Sizes = GetSectionSizes(Candidate->Width, Candidate->Height, Candidate->NumExits, Candidate->Flags, Candidate->DistanceBytes);
+        const bool bDistanceWidth = !(Candidate->Flags & MazeBakedDistances) || Candidate->DistanceBytes == 2 || Candidate->DistanceBytes == 4;
+        auto InFile = [this](uint64_t Offset, uint64_t Bytes) { return Offset % SectionAlignment == 0 && Offset <= File.GetSize() && Bytes <= File.GetSize() - Offset; };
+
+        if (Candidate->Width < 0 || Candidate->Height < 0 || !bDistanceWidth || Candidate->FileBytes != File.GetSize()
+            || !InFile(Candidate->WallsOffset, Sizes.Walls) || !InFile(Candidate->ExitsOffset, Sizes.Exits)
+            || !InFile(Candidate->TilesOffset, Sizes.Tiles) || !InFile(Candidate->DistancesOffset, Sizes.Distances))
+        {
+            Error = "truncated or corrupt header";
+        }
+        else if (bVerifyChecksum && GetChecksum(*Candidate, Data + Candidate->WallsOffset, Data + Candidate->ExitsOffset, Data + Candidate->TilesOffset, Data + Candidate->DistancesOffset) != Candidate->Checksum)
+        {
+            Error = "checksum mismatch";
+        }
+        else if (!HasWallGuards(reinterpret_cast<const uint64_t*>(Data + Candidate->WallsOffset), Candidate->Width, Candidate->Height))
+        {
+            Error = "open guard cells";
+        }
+        else
+        {
+            Header = Candidate;
+            Walls = reinterpret_cast<const uint64_t*>(Data + Header->WallsOffset);
+            Exits = reinterpret_cast<const FMazeCell*>(Data + Header->ExitsOffset);
+            Tiles = (Header->Flags & MazeBakedTiles) ? Data + Header->TilesOffset : nullptr;
+            Distances = (Header->Flags & MazeBakedDistances) ? Data + Header->DistancesOffset : nullptr;
+            Error = "";
+            return true;
+        }
+    }
+
+    File.Close();
+    return false;
+}
+
+void FMazeBakedMaze::Close()
+{
+    File.Close();
+    Header = nullptr;
+    Walls = nullptr;
+    Exits = nullptr;
+    Tiles = nullptr;
+    Distances = nullptr;
+}
+
+FMazeParams FMazeBakedMaze::GetParams() const
+{
+    FMazeParams Params;
+    Params.MazeSize = Header->Width;
+    Params.StartSize = Header->StartSize;
+    Params.NumExits = Header->RequestedExits;
+    Params.NorthSeed = Header->Seeds[0];
+    Params.SouthSeed = Header->Seeds[1];
+    Params.EastSeed = Header->Seeds[2];
+    Params.WestSeed = Header->Seeds[3];
+    return Params;
+}
+
+FMazeRect FMazeBakedMaze::GetStartRoom() const
+{
+    return FMazeRect{ Header->StartRoom[0], Header->StartRoom[1], Header->StartRoom[2], Header->StartRoom[3] };
+}
+
+bool FMazeBakedMaze::GetTile(int32_t X, int32_t Y, FMazeTileShape& OutShape) const
+{
+    const uint8_t Tile = Tiles[size_t(Y) * size_t(Header->Width) + size_t(X)];
+    if (Tile == WallTile)
+    {
+        return false;
+    }
+    OutShape.Type = EMazeTileType(Tile & 0x0F);
+    OutShape.Rotation = uint8_t(Tile >> 4);
+    return true;
+}
+
+uint32_t FMazeBakedMaze::GetDistance(int32_t X, int32_t Y) const
+{
+    const size_t Index = size_t(Y) * size_t(Header->Width) + size_t(X);
+    if (Header->DistanceBytes == 2)
+    {
+        uint16_t Narrow;
+        std::memcpy(&Narrow, Distances + Index * 2, sizeof(Narrow));
+        return Narrow == 0xFFFF ? FMazeFlowField::Unreachable : Narrow;
+    }
+    uint32_t Distance;
+    std::memcpy(&Distance, Distances + Index * 4, sizeof(Distance));
+    return Distance;
+}
+
+bool FMazeBakedMaze::BuildExitField(FMazeFlowField& OutField, FMazeThreadPool* Pool) const
+{
+    if (!HasDistances())
+    {
+        return false;
+    }
+    OutField.InitFromDistances(Header->Width, Header->Height, [this](int32_t Y, uint32_t* OutRow)
+    {
+        for (int32_t x = 0; x < Header->Width; ++x)
+        {
+            OutRow[x] = GetDistance(x, Y);
+        }
+    }, Pool);
+    return true;
+}
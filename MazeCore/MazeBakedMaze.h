@@ -0,0 +1,143 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTileClassifier.h"
+#include "MazeTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class FMazeFlowField;
+class FMazeThreadPool;
+
+// Baked maze file, little-endian, every section 64-byte aligned:
+//   header (144 bytes) | wall plane | exits | tiles (optional) | distances (optional)
+// The wall plane is stored exactly as FMazeBitGrid keeps it in memory (guard rows and bits included), so a mapped
+// file can be handed to the instance builder and the tile classifier without a copy.
+// Tiles are one byte per cell, Type | Rotation << 4, 0xFF for walls. Distances are steps to the nearest exit,
+// DistanceBytes (2 or 4) per cell, all ones when unreachable.
+struct FMazeBakedHeader
+{
+    char Magic[8];
+    uint32_t Version;
+    uint32_t HeaderBytes;
+    int32_t Width;
+    int32_t Height;
+    int32_t GuardCells;
+    uint32_t Flags;
+    int32_t StartRoom[4];
+    int32_t Seeds[4];
+    int32_t StartSize;
+    uint32_t NumExits;
+    uint32_t DistanceBytes;
+    // What the maze was generated from beyond the seeds: the exit count asked for (NumExits is what was opened) and
+    // the generator's id and version, 0 unless the writer set them
+    int32_t RequestedExits;
+    uint32_t GeneratorId;
+    uint32_t GeneratorVersion;
+    uint32_t Reserved;
+    uint64_t WallsOffset;
+    uint64_t ExitsOffset;
+    uint64_t TilesOffset;
+    uint64_t DistancesOffset;
+    uint64_t FileBytes;
+    // Over the sections in file order, then the header with this field zeroed
+    uint64_t Checksum;
+};
+
+static_assert(sizeof(FMazeBakedHeader) == 144, "The baked header is part of the file format");
+
+constexpr uint32_t MazeBakedVersion = 2;
+constexpr uint32_t MazeBakedTiles = 1;
+constexpr uint32_t MazeBakedDistances = 2;
+
+struct FMazeBakeOptions
+{
+    bool bTiles = false;
+    bool bDistances = false;
+
+    // Stored in the header as is; FMazeDiskCache checks them on load
+    uint32_t GeneratorId = 0;
+    uint32_t GeneratorVersion = 0;
+};
+
+// Read-only file mapping; the whole file is mapped at once
+class FMazeMappedFile
+{
+public:
+    FMazeMappedFile() = default;
+    ~FMazeMappedFile() { Close(); }
+
+    FMazeMappedFile(const FMazeMappedFile&) = delete;
+    FMazeMappedFile& operator=(const FMazeMappedFile&) = delete;
+
+    bool Open(const std::string& Path);
+    void Close();
+
+    const uint8_t* GetData() const { return Data; }
+    size_t GetSize() const { return Size; }
+
+private:
+    const uint8_t* Data = nullptr;
+    size_t Size = 0;
+#if defined(_WIN32)
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#endif
+};
+
+// Writes a finished grid, computing the optional sections (on Pool when given). False if the file cannot be written.
+bool WriteMazeBakedFile(const std::string& Path, const FMazeParams& Params, const FMazeRect& StartRoom, const FMazeBitGrid& Grid, const FMazeBakeOptions& Options, FMazeThreadPool* Pool = nullptr);
+
+// Baked maze mapped into memory. Everything it returns points into the mapping and is valid until Close.
+class FMazeBakedMaze
+{
+public:
+    // Validates the header, section bounds and wall guard cells, and the checksum unless told not to (it reads every
+    // page once)
+    bool Open(const std::string& Path, bool bVerifyChecksum = true);
+    void Close();
+
+    bool IsOpen() const { return Header != nullptr; }
+
+    // Why the last Open failed
+    const char* GetError() const { return Error; }
+
+    const FMazeBakedHeader& GetHeader() const { return *Header; }
+    // NumExits is the requested count, GetNumExits the exits actually opened
+    FMazeParams GetParams() const;
+    uint32_t GetGeneratorId() const { return Header->GeneratorId; }
+    uint32_t GetGeneratorVersion() const { return Header->GeneratorVersion; }
+    FMazeRect GetStartRoom() const;
+
+    FMazeWallPlane GetWalls() const { return FMazeWallPlane(Walls, Header->Width, Header->Height); }
+
+    int32_t GetNumExits() const { return int32_t(Header->NumExits); }
+    const FMazeCell* GetExits() const { return Exits; }
+
+    bool HasTiles() const { return Tiles != nullptr; }
+
+    // False for walls
+    bool GetTile(int32_t X, int32_t Y, FMazeTileShape& OutShape) const;
+
+    bool HasDistances() const { return Distances != nullptr; }
+
+    // Steps to the nearest exit, ~0u when unreachable
+    uint32_t GetDistance(int32_t X, int32_t Y) const;
+
+    // Exit flow field straight from the distance section, only the directions are computed; false without one
+    bool BuildExitField(FMazeFlowField& OutField, FMazeThreadPool* Pool = nullptr) const;
+
+private:
+    FMazeMappedFile File;
+    const FMazeBakedHeader* Header = nullptr;
+    const uint64_t* Walls = nullptr;
+    const FMazeCell* Exits = nullptr;
+    const uint8_t* Tiles = nullptr;
+    const uint8_t* Distances = nullptr;
+    const char* Error = "";
+};
+
+// Word-at-a-time 64-bit hash used for the baked checksum, Seed chains calls over several buffers
+uint64_t HashMazeBytes(const void* Data, size_t Size, uint64_t Seed);
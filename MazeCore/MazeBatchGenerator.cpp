@@ -0,0 +1,72 @@
+#include "MazeBatchGenerator.h"
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+    int64_t GetMazeCells(const FMazeParams& Params)
+    {
+        return int64_t(Params.MazeSize) * Params.MazeSize;
+    }
+}
+
+void FMazeBatchGenerator::Generate(const std::vector<FMazeParams>& Jobs, const FMazeBatchSettings& Settings, const FMazeBatchSink& Sink)
+{
+    MAZE_TRACE_SCOPE("MazeBatch.Generate");
+
+    // Largest first, so the long jobs start early and the small ones fill the gaps at the end
+    std::vector<int32_t> Order(Jobs.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    std::stable_sort(Order.begin(), Order.end(), [&Jobs](int32_t A, int32_t B) { return GetMazeCells(Jobs[A]) > GetMazeCells(Jobs[B]); });
+
+    // Task t runs Order[TaskStarts[t], TaskStarts[t + 1])
+    std::vector<int32_t> TaskStarts;
+    int64_t TaskCells = 0;
+    for (int32_t i = 0; i < int32_t(Order.size()); ++i)
+    {
+        const int64_t Cells = GetMazeCells(Jobs[Order[i]]);
+        if (TaskStarts.empty() || TaskCells + Cells > Settings.CellsPerTask)
+        {
+            TaskStarts.push_back(i);
+            TaskCells = 0;
+        }
+        TaskCells += Cells;
+    }
+    const int32_t NumTasks = int32_t(TaskStarts.size());
+    TaskStarts.push_back(int32_t(Order.size()));
+
+    FMazeTiledGenerator Generator(Pool);
+    Pool.ParallelFor(NumTasks, [this, &Jobs, &Settings, &Sink, &Order, &TaskStarts, &Generator](int32_t Task)
+    {
+        MAZE_TRACE_SCOPE("MazeBatch.Task");
+        std::unique_ptr<FMazeBitGrid> Grid = AcquireGrid();
+        for (int32_t i = TaskStarts[Task]; i < TaskStarts[Task + 1]; ++i)
+        {
+            const int32_t JobIndex = Order[i];
+            Generator.Generate(Jobs[JobIndex], Settings.Tiled, *Grid);
+            Sink(JobIndex, *Grid);
+        }
+        ReleaseGrid(std::move(Grid));
+    });
+}
+
+std::unique_ptr<FMazeBitGrid> FMazeBatchGenerator::AcquireGrid()
+{
+    std::lock_guard<std::mutex> Lock(FreeGridsMutex);
+    if (FreeGrids.empty())
+    {
+        return std::make_unique<FMazeBitGrid>();
+    }
+    std::unique_ptr<FMazeBitGrid> Grid = std::move(FreeGrids.back());
+    FreeGrids.pop_back();
+    return Grid;
+}
+
+void FMazeBatchGenerator::ReleaseGrid(std::unique_ptr<FMazeBitGrid> Grid)
+{
+    std::lock_guard<std::mutex> Lock(FreeGridsMutex);
+    FreeGrids.push_back(std::move(Grid));
+}
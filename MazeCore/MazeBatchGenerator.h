@@ -0,0 +1,47 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTiledGenerator.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class FMazeThreadPool;
+
+struct FMazeBatchSettings
+{
+    // Used for every maze, so a maze is the same whether it came from a batch or from FMazeTiledGenerator
+    FMazeTiledSettings Tiled;
+
+    // Small mazes are packed into one pool task until it holds about this many cells
+    int64_t CellsPerTask = int64_t(1) << 20;
+};
+
+// Called on the worker that finished the maze, possibly from several workers at once. Grid is scratch that the
+// next job reuses, so copy out (or write out) whatever has to outlive the call.
+using FMazeBatchSink = std::function<void(int32_t JobIndex, const FMazeBitGrid& Grid)>;
+
+// Generates many mazes at once on a pool. Jobs are scheduled largest first; mazes above CellsPerTask get a task
+// each and are split further by the tiled generator's own tile loop, smaller ones share tasks so the per-task
+// overhead does not dominate. Grids are recycled between jobs and across batches.
+class FMazeBatchGenerator
+{
+public:
+    explicit FMazeBatchGenerator(FMazeThreadPool& InPool) : Pool(InPool) {}
+
+    // Returns once every job has been handed to Sink, in completion order
+    void Generate(const std::vector<FMazeParams>& Jobs, const FMazeBatchSettings& Settings, const FMazeBatchSink& Sink);
+
+private:
+    std::unique_ptr<FMazeBitGrid> AcquireGrid();
+    void ReleaseGrid(std::unique_ptr<FMazeBitGrid> Grid);
+
+    FMazeThreadPool& Pool;
+
+    std::mutex FreeGridsMutex;
+    std::vector<std::unique_ptr<FMazeBitGrid>> FreeGrids;
+};
@@ -0,0 +1,145 @@
+#include "MazeBitGrid.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace
+{
+    // Bits [Lo, Hi) of a word, Hi <= 64
+    uint64_t RangeMask(uint32_t Lo, uint32_t Hi)
+    {
+        const uint64_t Upper = Hi >= 64 ? ~uint64_t(0) : (uint64_t(1) << Hi) - 1;
+        return Upper & ~((uint64_t(1) << Lo) - 1);
+    }
+}
+
+void FMazeBitGrid::Init(int32_t InWidth, int32_t InHeight)
+{
+    Width = std::max(InWidth, 0);
+    Height = std::max(InHeight, 0);
+    WordsPerRow = GetWordsPerRow(Width);
+
+    const size_t NumWords = GetNumWords(Width, Height);
+    Walls.assign(NumWords, 0);
+    Visited.assign(NumWords, 0);
+    Reset();
+}
+
+void FMazeBitGrid::Reset()
+{
+    FillWalls();
+    ClearVisited();
+}
+
+void FMazeBitGrid::FillWalls()
+{
+    std::fill(Walls.begin(), Walls.end(), ~uint64_t(0));
+}
+
+void FMazeBitGrid::ClearVisited()
+{
+    // Guard cells stay visited so carvers never step outside the playable area
+    std::fill(Visited.begin(), Visited.end(), ~uint64_t(0));
+    for (int32_t y = 0; y < Height; ++y)
+    {
+        SetRowRange(Visited, y, 0, Width, false);
+    }
+}
+
+void FMazeBitGrid::SetPerimeterWalls()
+{
+    if (IsEmpty())
+    {
+        return;
+    }
+
+    SetRowRange(Walls, 0, 0, Width, true);
+    SetRowRange(Walls, Height - 1, 0, Width, true);
+    for (int32_t y = 0; y < Height; ++y)
+    {
+        SetWall(0, y);
+        SetWall(Width - 1, y);
+    }
+}
+
+void FMazeBitGrid::ClearRect(int32_t X, int32_t Y, int32_t RectWidth, int32_t RectHeight)
+{
+    const int32_t X0 = std::max(X, 0);
+    const int32_t X1 = std::min(X + RectWidth, Width);
+    const int32_t Y0 = std::max(Y, 0);
+    const int32_t Y1 = std::min(Y + RectHeight, Height);
+
+    for (int32_t y = Y0; y < Y1; ++y)
+    {
+        SetRowRange(Walls, y, X0, X1, false);
+        SetRowRange(Visited, y, X0, X1, true);
+    }
+}
+
+int64_t FMazeBitGrid::CountWalls() const
+{
+    return GetWallPlane().CountWalls();
+}
+
+int64_t FMazeBitGrid::CountWallsInRow(int32_t Y) const
+{
+    return GetWallPlane().CountWallsInRow(Y);
+}
+
+void FMazeBitGrid::InitFromWalls(const FMazeWallPlane& Plane)
+{
+    Width = Plane.GetWidth();
+    Height = Plane.GetHeight();
+    WordsPerRow = Plane.GetWordsPerRow();
+
+    const size_t NumWords = GetNumWords(Width, Height);
+    Walls.assign(Plane.GetWords(), Plane.GetWords() + NumWords);
+    Visited.assign(NumWords, ~uint64_t(0));
+}
+
+int64_t FMazeWallPlane::CountWalls() const
+{
+    int64_t Count = 0;
+    for (int32_t y = 0; y < Height; ++y)
+    {
+        Count += CountWallsInRow(y);
+    }
+    return Count;
+}
+
+int64_t FMazeWallPlane::CountWallsInRow(int32_t Y) const
+{
+    constexpr uint32_t BitsPerWord = FMazeBitGrid::BitsPerWord;
+    const uint32_t FirstBit = FMazeBitGrid::GuardCells;
+    const uint32_t LastBit = FMazeBitGrid::GuardCells + Width;
+    const uint64_t* Row = GetWallRow(Y);
+
+    int64_t Count = 0;
+    for (uint32_t w = FirstBit / BitsPerWord; w * BitsPerWord < LastBit; ++w)
+    {
+        const uint32_t Lo = std::max(FirstBit, w * BitsPerWord) - w * BitsPerWord;
+        const uint32_t Hi = std::min(LastBit, (w + 1) * BitsPerWord) - w * BitsPerWord;
+        Count += std::popcount(Row[w] & RangeMask(Lo, Hi));
+    }
+    return Count;
+}
+
+void FMazeBitGrid::SetRowRange(std::vector<uint64_t>& Plane, int32_t Y, int32_t X0, int32_t X1, bool bValue)
+{
+    if (X0 >= X1)
+    {
+        return;
+    }
+
+    uint64_t* Row = &Plane[size_t(Y + GuardCells) * WordsPerRow];
+    const uint32_t FirstBit = uint32_t(X0 + GuardCells);
+    const uint32_t LastBit = uint32_t(X1 + GuardCells);
+
+    for (uint32_t w = FirstBit / BitsPerWord; w * BitsPerWord < LastBit; ++w)
+    {
+        const uint32_t Lo = std::max(FirstBit, w * BitsPerWord) - w * BitsPerWord;
+        const uint32_t Hi = std::min(LastBit, (w + 1) * BitsPerWord) - w * BitsPerWord;
+        const uint64_t Mask = RangeMask(Lo, Hi);
+        Row[w] = bValue ? (Row[w] | Mask) : (Row[w] & ~Mask);
+    }
+}
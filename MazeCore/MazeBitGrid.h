@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FMazeWallPlane;
+
+// Contiguous, row-major, bit-packed maze grid shared by every generation path.
+// Two bit-planes are kept: walls (1 = wall, 0 = path) and visited (1 = claimed by a carver).
+// Every row is padded with a band of guard cells that are walls and already visited,
+// so neighbour lookups up to GuardCells away from the playable area need no bounds checks.
+class FMazeBitGrid
+{
+public:
+    // Padding around the playable area (covers the step-of-2 lookups plus the adjacency check around them)
+    static constexpr int32_t GuardCells = 4;
+    static constexpr int32_t BitsPerWord = 64;
+
+    FMazeBitGrid() = default;
+    FMazeBitGrid(int32_t InWidth, int32_t InHeight) { Init(InWidth, InHeight); }
+
+    // Allocate the grid, every playable cell becomes an unvisited wall
+    void Init(int32_t InWidth, int32_t InHeight);
+
+    // Reset every playable cell to an unvisited wall without reallocating
+    void Reset();
+
+    int32_t GetWidth() const { return Width; }
+    int32_t GetHeight() const { return Height; }
+    int32_t GetWordsPerRow() const { return WordsPerRow; }
+    bool IsEmpty() const { return Width == 0 || Height == 0; }
+
+    // Single cell access, valid for -GuardCells <= X < Width + GuardCells (same for Y)
+    bool IsWall(int32_t X, int32_t Y) const { return (Walls[WordIndex(X, Y)] >> BitIndex(X)) & 1; }
+    void SetWall(int32_t X, int32_t Y) { Walls[WordIndex(X, Y)] |= BitMask(X); }
+    void ClearWall(int32_t X, int32_t Y) { Walls[WordIndex(X, Y)] &= ~BitMask(X); }
+
+    bool IsVisited(int32_t X, int32_t Y) const { return (Visited[WordIndex(X, Y)] >> BitIndex(X)) & 1; }
+    void MarkVisited(int32_t X, int32_t Y) { Visited[WordIndex(X, Y)] |= BitMask(X); }
+
+    // Open a cell and mark it visited
+    void Carve(int32_t X, int32_t Y)
+    {
+        ClearWall(X, Y);
+        MarkVisited(X, Y);
+    }
+
+    // Lock-free access for carvers sharing the grid; these must not be mixed with the plain accessors while carvers run
+    bool IsVisitedAtomic(int32_t X, int32_t Y) const
+    {
+        return (AtomicWord(const_cast<uint64_t&>(Visited[WordIndex(X, Y)])).load(std::memory_order_relaxed) >> BitIndex(X)) & 1;
+    }
+
+    // Atomically mark a cell visited, returns false if another carver claimed it first
+    bool TryClaim(int32_t X, int32_t Y)
+    {
+        const uint64_t Mask = BitMask(X);
+        return (AtomicWord(Visited[WordIndex(X, Y)]).fetch_or(Mask, std::memory_order_relaxed) & Mask) == 0;
+    }
+
+    void ClearWallAtomic(int32_t X, int32_t Y)
+    {
+        AtomicWord(Walls[WordIndex(X, Y)]).fetch_and(~BitMask(X), std::memory_order_relaxed);
+    }
+
+    // Word-wide bulk operations
+    void FillWalls();
+    void ClearVisited();
+    void SetPerimeterWalls();
+
+    // Open and mark visited every cell of the rectangle (used for the central start room)
+    void ClearRect(int32_t X, int32_t Y, int32_t RectWidth, int32_t RectHeight);
+
+    // Raw rows, bit (X + GuardCells) of the row is cell X
+    const uint64_t* GetWallRow(int32_t Y) const { return &Walls[size_t(Y + GuardCells) * WordsPerRow]; }
+    const uint64_t* GetVisitedRow(int32_t Y) const { return &Visited[size_t(Y + GuardCells) * WordsPerRow]; }
+
+    // Number of wall cells inside the playable area
+    int64_t CountWalls() const;
+    int64_t CountWallsInRow(int32_t Y) const;
+
+    FMazeWallPlane GetWallPlane() const;
+
+    // Resize to Plane's dimensions and copy its walls; every cell is marked visited, as in a finished maze
+    void InitFromWalls(const FMazeWallPlane& Plane);
+
+    // Words of one plane for a Width x Height grid, guard rows included
+    static int32_t GetWordsPerRow(int32_t InWidth) { return (InWidth + 2 * GuardCells + BitsPerWord - 1) / BitsPerWord; }
+    static size_t GetNumWords(int32_t InWidth, int32_t InHeight) { return size_t(InHeight + 2 * GuardCells) * GetWordsPerRow(InWidth); }
+
+    // Bytes held by both bit-planes
+    size_t GetAllocatedBytes() const { return (Walls.capacity() + Visited.capacity()) * sizeof(uint64_t); }
+
+private:
+    size_t WordIndex(int32_t X, int32_t Y) const { return size_t(Y + GuardCells) * WordsPerRow + size_t(X + GuardCells) / BitsPerWord; }
+    static uint32_t BitIndex(int32_t X) { return uint32_t(X + GuardCells) % BitsPerWord; }
+    static uint64_t BitMask(int32_t X) { return uint64_t(1) << BitIndex(X); }
+    static std::atomic_ref<uint64_t> AtomicWord(uint64_t& Word) { return std::atomic_ref<uint64_t>(Word); }
+
+    // Set or clear cells [X0, X1) of a row one word at a time
+    void SetRowRange(std::vector<uint64_t>& Plane, int32_t Y, int32_t X0, int32_t X1, bool bValue);
+
+    int32_t Width = 0;
+    int32_t Height = 0;
+    int32_t WordsPerRow = 0;
+
+    std::vector<uint64_t> Walls;
+    std::vector<uint64_t> Visited;
+};
+
+// Read-only wall plane in FMazeBitGrid's guard-padded layout. It may point into a grid or into memory no grid owns
+// (a mapped baked maze), so passes that only read walls accept either.
+class FMazeWallPlane
+{
+public:
+    FMazeWallPlane() = default;
+    FMazeWallPlane(const uint64_t* InWords, int32_t InWidth, int32_t InHeight)
+        : Words(InWords), Width(InWidth), Height(InHeight), WordsPerRow(FMazeBitGrid::GetWordsPerRow(InWidth)) {}
+
+    // Implicit, so wall-only passes keep taking grids as before
+    FMazeWallPlane(const FMazeBitGrid& Grid) : FMazeWallPlane(Grid.GetWallPlane()) {}
+
+    int32_t GetWidth() const { return Width; }
+    int32_t GetHeight() const { return Height; }
+    int32_t GetWordsPerRow() const { return WordsPerRow; }
+    bool IsEmpty() const { return Width == 0 || Height == 0; }
+    const uint64_t* GetWords() const { return Words; }
+
+    // Same addressing as the grid: bit (X + GuardCells) of row Y, guard rows and bits included
+    const uint64_t* GetWallRow(int32_t Y) const { return Words + size_t(Y + FMazeBitGrid::GuardCells) * WordsPerRow; }
+    bool IsWall(int32_t X, int32_t Y) const
+    {
+        const uint32_t Bit = uint32_t(X + FMazeBitGrid::GuardCells);
+        return (GetWallRow(Y)[Bit / FMazeBitGrid::BitsPerWord] >> (Bit % FMazeBitGrid::BitsPerWord)) & 1;
+    }
+
+    int64_t CountWalls() const;
+    int64_t CountWallsInRow(int32_t Y) const;
+
+private:
+    const uint64_t* Words = nullptr;
+    int32_t Width = 0;
+    int32_t Height = 0;
+    int32_t WordsPerRow = 0;
+};
+
+inline FMazeWallPlane FMazeBitGrid::GetWallPlane() const
+{
+    return FMazeWallPlane(Walls.data(), Width, Height);
+}
@@ -0,0 +1,421 @@
+#include "MazeBoruvkaGenerator.h"
+#include "MazeRandom.h"
+#include "MazeThreadPool.h"
+#include "MazeTiledGenerator.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+
+namespace
+{
+    constexpr uint64_t NoEdge = ~uint64_t(0);
+    constexpr uint32_t NoComponent = ~uint32_t(0);
+
+    // Roughly the work of one ParallelFor index, in lattice cells or passages
+    constexpr int32_t BlockItems = 1 << 16;
+
+    // Passage ids of an L x L lattice: 2 * Node for the passage to the right of a row-major lattice cell, 2 * Node + 1
+    // for the one below it. Decoding needs no division, and both ends of a passage sit close in memory.
+    struct FLatticeEdges
+    {
+        int32_t Size = 0;
+        uint64_t IdMask = 0;
+        uint64_t Seed = 0;
+
+        FLatticeEdges(int32_t InSize, uint64_t InSeed) : Size(InSize), Seed(InSeed)
+        {
+            IdMask = (uint64_t(1) << std::bit_width(2 * uint64_t(Size) * uint64_t(Size))) - 1;
+        }
+
+        static uint32_t GetRightEdge(uint32_t Node) { return 2 * Node; }
+        static uint32_t GetDownEdge(uint32_t Node) { return 2 * Node + 1; }
+
+        // Random weight in the high bits and the id in the low ones, a total order without ties
+        uint64_t GetKey(uint32_t Edge) const { return (MixMazeSeed(Seed, Edge) & ~IdMask) | Edge; }
+        uint32_t GetEdge(uint64_t Key) const { return uint32_t(Key & IdMask); }
+
+        void GetNodes(uint32_t Edge, uint32_t& OutA, uint32_t& OutB) const
+        {
+            OutA = Edge >> 1;
+            OutB = OutA + ((Edge & 1) ? uint32_t(Size) : 1);
+        }
+
+        // Wall cell the passage opens
+        void GetWall(uint32_t Edge, int32_t& OutX, int32_t& OutY) const
+        {
+            const uint32_t Node = Edge >> 1;
+            OutX = 2 * int32_t(Node % uint32_t(Size)) + ((Edge & 1) ? 1 : 2);
+            OutY = 2 * int32_t(Node / uint32_t(Size)) + ((Edge & 1) ? 2 : 1);
+        }
+    };
+
+    void AtomicMin(uint64_t& Target, uint64_t Value)
+    {
+        std::atomic_ref<uint64_t> Ref(Target);
+        uint64_t Current = Ref.load(std::memory_order_relaxed);
+        while (Value < Current && !Ref.compare_exchange_weak(Current, Value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Concurrent find with path halving; a parent only ever moves up the tree, so racing halvings are harmless
+    uint32_t FindRoot(std::vector<uint32_t>& Parents, uint32_t Node)
+    {
+        for (;;)
+        {
+            uint32_t Parent = std::atomic_ref<uint32_t>(Parents[Node]).load(std::memory_order_relaxed);
+            if (Parent == Node)
+            {
+                return Node;
+            }
+            const uint32_t GrandParent = std::atomic_ref<uint32_t>(Parents[Parent]).load(std::memory_order_relaxed);
+            if (GrandParent == Parent)
+            {
+                return Parent;
+            }
+            std::atomic_ref<uint32_t>(Parents[Node]).compare_exchange_weak(Parent, GrandParent, std::memory_order_relaxed);
+            Node = GrandParent;
+        }
+    }
+
+    // Lock-free union, the larger root is linked below the smaller. False if both were already joined.
+    bool Unite(std::vector<uint32_t>& Parents, uint32_t A, uint32_t B)
+    {
+        for (;;)
+        {
+            A = FindRoot(Parents, A);
+            B = FindRoot(Parents, B);
+            if (A == B)
+            {
+                return false;
+            }
+            if (A < B)
+            {
+                std::swap(A, B);
+            }
+            uint32_t Expected = A;
+            if (std::atomic_ref<uint32_t>(Parents[A]).compare_exchange_strong(Expected, B, std::memory_order_relaxed))
+            {
+                return true;
+            }
+        }
+    }
+
+    int32_t GetNumBlocks(size_t NumItems)
+    {
+        return int32_t((NumItems + BlockItems - 1) / BlockItems);
+    }
+}
+
+void FMazeBoruvkaGenerator::Generate(const FMazeParams& Params, FMazeBitGrid& OutGrid)
+{
+    MAZE_TRACE_SCOPE("MazeBoruvka.Generate");
+    OutGrid.Init(Params.MazeSize, Params.MazeSize);
+    NumRounds = 0;
+
+    const int32_t L = GetLatticeSize(Params.MazeSize);
+    const FMazeRect Room = GetLatticeStartRoom(Params);
+    if (!Room.IsEmpty())
+    {
+        OutGrid.ClearRect(Room.X, Room.Y, Room.Width, Room.Height);
+    }
+
+    const uint64_t BaseSeed = Params.GetCombinedSeed();
+    if (L > 0)
+    {
+        const FLatticeEdges Edges(L, BaseSeed);
+        const uint32_t NumNodes = uint32_t(L) * uint32_t(L);
+        const int64_t NumEdges = 2 * int64_t(L) * (L - 1);
+        const int32_t RowsPerBlock = std::max(BlockItems / L, 1);
+        const int32_t NumRowBlocks = (L + RowsPerBlock - 1) / RowsPerBlock;
+
+        // Every lattice cell is open from the start, only passages are decided. The room's cells share one label.
+        const uint32_t RoomNode = Room.IsEmpty() ? NoComponent : uint32_t((Room.Y - 1) / 2) * uint32_t(L) + uint32_t((Room.X - 1) / 2);
+        Labels.resize(NumNodes);
+        Pool.ParallelFor(L, [this, &OutGrid, &Room, L, RoomNode](int32_t J)
+        {
+            for (int32_t I = 0; I < L; ++I)
+            {
+                const int32_t X = 2 * I + 1;
+                const int32_t Y = 2 * J + 1;
+                OutGrid.ClearWall(X, Y);
+                Labels[size_t(J) * L + I] = Room.Contains(X, Y) ? RoomNode : uint32_t(J) * uint32_t(L) + uint32_t(I);
+            }
+        });
+
+        uint32_t NumComponents = NumNodes;
+        bool bListed = false;
+        LiveEdges.clear();
+
+        for (;;)
+        {
+            ++NumRounds;
+
+            // Lightest outgoing passage of every component
+            Lightest.assign(NumComponents, NoEdge);
+            std::atomic<int64_t> NumLive{ 0 };
+            {
+                MAZE_TRACE_SCOPE("MazeBoruvka.Lightest");
+                auto Offer = [this, &Edges](uint32_t Edge, uint32_t A, uint32_t B)
+                {
+                    const uint64_t Key = Edges.GetKey(Edge);
+                    AtomicMin(Lightest[A], Key);
+                    AtomicMin(Lightest[B], Key);
+                };
+
+                if (NumRounds == 1)
+                {
+                    // Every cell outside the room is still its own component and owns its slot, so it takes the
+                    // min over its own passages without atomics. Only the room gathers through AtomicMin.
+                    Pool.ParallelFor(NumRowBlocks, [this, &Edges, &NumLive, L, RowsPerBlock, RoomNode](int32_t Block)
+                    {
+                        int64_t BlockLive = 0;
+                        const int32_t EndJ = std::min(L, (Block + 1) * RowsPerBlock);
+                        for (int32_t J = Block * RowsPerBlock; J < EndJ; ++J)
+                        {
+                            for (int32_t I = 0; I < L; ++I)
+                            {
+                                const uint32_t Node = uint32_t(J) * uint32_t(L) + uint32_t(I);
+                                const uint32_t Label = Labels[Node];
+                                uint64_t Best = NoEdge;
+                                auto Consider = [this, &Edges, &Best, Label](uint32_t Edge, uint32_t Other)
+                                {
+                                    if (Labels[Other] != Label)
+                                    {
+                                        Best = std::min(Best, Edges.GetKey(Edge));
+                                        return 1;
+                                    }
+                                    return 0;
+                                };
+                                if (I > 0)
+                                {
+                                    Consider(Edges.GetRightEdge(Node - 1), Node - 1);
+                                }
+                                if (J > 0)
+                                {
+                                    Consider(Edges.GetDownEdge(Node - uint32_t(L)), Node - uint32_t(L));
+                                }
+                                if (I + 1 < L)
+                                {
+                                    BlockLive += Consider(Edges.GetRightEdge(Node), Node + 1);
+                                }
+                                if (J + 1 < L)
+                                {
+                                    BlockLive += Consider(Edges.GetDownEdge(Node), Node + uint32_t(L));
+                                }
+
+                                if (Label == Node && Node != RoomNode)
+                                {
+                                    Lightest[Node] = Best;
+                                }
+                                else if (Best != NoEdge)
+                                {
+                                    AtomicMin(Lightest[Label], Best);
+                                }
+                            }
+                        }
+                        NumLive += BlockLive;
+                    });
+                }
+                else if (!bListed)
+                {
+                    // Passages are implicit until few enough are left for a list to be smaller than a scan
+                    Pool.ParallelFor(NumRowBlocks, [this, &Edges, &Offer, &NumLive, L, RowsPerBlock](int32_t Block)
+                    {
+                        int64_t BlockLive = 0;
+                        const int32_t EndJ = std::min(L, (Block + 1) * RowsPerBlock);
+                        for (int32_t J = Block * RowsPerBlock; J < EndJ; ++J)
+                        {
+                            const uint32_t RowStart = uint32_t(J) * uint32_t(L);
+                            const uint32_t* Row = &Labels[RowStart];
+                            for (int32_t I = 0; I < L; ++I)
+                            {
+                                if (I + 1 < L && Row[I] != Row[I + 1])
+                                {
+                                    Offer(Edges.GetRightEdge(RowStart + I), Row[I], Row[I + 1]);
+                                    ++BlockLive;
+                                }
+                                if (J + 1 < L && Row[I] != Row[I + L])
+                                {
+                                    Offer(Edges.GetDownEdge(RowStart + I), Row[I], Row[I + L]);
+                                    ++BlockLive;
+                                }
+                            }
+                        }
+                        NumLive += BlockLive;
+                    });
+                }
+                else
+                {
+                    Pool.ParallelFor(GetNumBlocks(LiveEdges.size()), [this, &Edges, &Offer, &NumLive](int32_t Block)
+                    {
+                        int64_t BlockLive = 0;
+                        const size_t End = std::min(LiveEdges.size(), size_t(Block + 1) * BlockItems);
+                        for (size_t i = size_t(Block) * BlockItems; i < End; ++i)
+                        {
+                            uint32_t A;
+                            uint32_t B;
+                            Edges.GetNodes(LiveEdges[i], A, B);
+                            A = FindRoot(Parents, Labels[A]);
+                            B = FindRoot(Parents, Labels[B]);
+                            if (A != B)
+                            {
+                                Offer(LiveEdges[i], A, B);
+                                ++BlockLive;
+                            }
+                        }
+                        NumLive += BlockLive;
+                    });
+                }
+            }
+            if (NumLive.load() == 0)
+            {
+                break;
+            }
+
+            // Distinct weights make the picks a forest; a passage picked from both sides only unites once
+            {
+                MAZE_TRACE_SCOPE("MazeBoruvka.Unite");
+                if (!bListed)
+                {
+                    ResetParents(NumComponents);
+                }
+                Pool.ParallelFor(GetNumBlocks(NumComponents), [this, &Edges, &OutGrid, NumComponents](int32_t Block)
+                {
+                    const uint32_t End = std::min(NumComponents, uint32_t(Block + 1) * BlockItems);
+                    for (uint32_t c = uint32_t(Block) * BlockItems; c < End; ++c)
+                    {
+                        if (Lightest[c] == NoEdge)
+                        {
+                            continue;
+                        }
+                        const uint32_t Edge = Edges.GetEdge(Lightest[c]);
+                        uint32_t A;
+                        uint32_t B;
+                        Edges.GetNodes(Edge, A, B);
+                        if (Unite(Parents, Labels[A], Labels[B]))
+                        {
+                            int32_t X;
+                            int32_t Y;
+                            Edges.GetWall(Edge, X, Y);
+                            OutGrid.ClearWallAtomic(X, Y);
+                        }
+                    }
+                });
+            }
+
+            // Dense ids for the merged components, Lightest doubles as the old-to-new map. Once passages are listed
+            // only their ends are ever looked up, and the union-find stays on top of the labels instead.
+            if (!bListed)
+            {
+                MAZE_TRACE_SCOPE("MazeBoruvka.Relabel");
+                Pool.ParallelFor(GetNumBlocks(NumComponents), [this, NumComponents](int32_t Block)
+                {
+                    const uint32_t End = std::min(NumComponents, uint32_t(Block + 1) * BlockItems);
+                    for (uint32_t c = uint32_t(Block) * BlockItems; c < End; ++c)
+                    {
+                        Lightest[c] = NoEdge;
+                        std::atomic_ref<uint32_t>(Parents[c]).store(FindRoot(Parents, c), std::memory_order_relaxed);
+                    }
+                });
+                Pool.ParallelFor(GetNumBlocks(NumNodes), [this, NumNodes](int32_t Block)
+                {
+                    const uint32_t End = std::min(NumNodes, uint32_t(Block + 1) * BlockItems);
+                    for (uint32_t n = uint32_t(Block) * BlockItems; n < End; ++n)
+                    {
+                        std::atomic_ref<uint64_t>(Lightest[Parents[Labels[n]]]).store(0, std::memory_order_relaxed);
+                    }
+                });
+
+                uint32_t NumMerged = 0;
+                for (uint32_t c = 0; c < NumComponents; ++c)
+                {
+                    Lightest[c] = Lightest[c] == 0 ? NumMerged++ : NoEdge;
+                }
+                Pool.ParallelFor(GetNumBlocks(NumNodes), [this, NumNodes](int32_t Block)
+                {
+                    const uint32_t End = std::min(NumNodes, uint32_t(Block + 1) * BlockItems);
+                    for (uint32_t n = uint32_t(Block) * BlockItems; n < End; ++n)
+                    {
+                        Labels[n] = uint32_t(Lightest[Parents[Labels[n]]]);
+                    }
+                });
+                NumComponents = NumMerged;
+            }
+
+            // Filter: keep only passages that still join two components
+            if (bListed || NumLive.load() <= NumEdges / 4)
+            {
+                MAZE_TRACE_SCOPE("MazeBoruvka.Filter");
+                const int32_t NumBlocks = bListed ? GetNumBlocks(LiveEdges.size()) : NumRowBlocks;
+                std::vector<std::vector<uint32_t>> Kept(NumBlocks);
+                Pool.ParallelFor(NumBlocks, [this, &Edges, &Kept, bListed, L, RowsPerBlock](int32_t Block)
+                {
+                    std::vector<uint32_t>& Out = Kept[Block];
+                    if (bListed)
+                    {
+                        const size_t End = std::min(LiveEdges.size(), size_t(Block + 1) * BlockItems);
+                        for (size_t i = size_t(Block) * BlockItems; i < End; ++i)
+                        {
+                            uint32_t A;
+                            uint32_t B;
+                            Edges.GetNodes(LiveEdges[i], A, B);
+                            if (FindRoot(Parents, Labels[A]) != FindRoot(Parents, Labels[B]))
+                            {
+                                Out.push_back(LiveEdges[i]);
+                            }
+                        }
+                        return;
+                    }
+
+                    const int32_t EndJ = std::min(L, (Block + 1) * RowsPerBlock);
+                    for (int32_t J = Block * RowsPerBlock; J < EndJ; ++J)
+                    {
+                        const uint32_t RowStart = uint32_t(J) * uint32_t(L);
+                        const uint32_t* Row = &Labels[RowStart];
+                        for (int32_t I = 0; I < L; ++I)
+                        {
+                            if (I + 1 < L && Row[I] != Row[I + 1])
+                            {
+                                Out.push_back(Edges.GetRightEdge(RowStart + I));
+                            }
+                            if (J + 1 < L && Row[I] != Row[I + L])
+                            {
+                                Out.push_back(Edges.GetDownEdge(RowStart + I));
+                            }
+                        }
+                    }
+                });
+
+                LiveEdges.clear();
+                for (const std::vector<uint32_t>& Block : Kept)
+                {
+                    LiveEdges.insert(LiveEdges.end(), Block.begin(), Block.end());
+                }
+                if (!bListed)
+                {
+                    ResetParents(NumComponents);
+                    bListed = true;
+                }
+            }
+        }
+    }
+
+    OutGrid.SetPerimeterWalls();
+    CreateLatticeExits(Params, MixMazeSeed(BaseSeed, ~uint64_t(0)), OutGrid);
+}
+
+void FMazeBoruvkaGenerator::ResetParents(uint32_t NumComponents)
+{
+    Parents.resize(NumComponents);
+    Pool.ParallelFor(GetNumBlocks(NumComponents), [this, NumComponents](int32_t Block)
+    {
+        const uint32_t End = std::min(NumComponents, uint32_t(Block + 1) * BlockItems);
+        for (uint32_t c = uint32_t(Block) * BlockItems; c < End; ++c)
+        {
+            Parents[c] = c;
+        }
+    });
+}
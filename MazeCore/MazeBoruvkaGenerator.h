@@ -0,0 +1,42 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+class FMazeThreadPool;
+
+// Perfect maze as the minimum spanning tree of the corridor lattice under random edge weights, which is the same
+// distribution as Kruskal over a shuffled edge list. Built with Borůvka rounds: every component picks its lightest
+// outgoing passage in parallel, the picks are merged with a lock-free union-find, then components are relabelled
+// to dense ids. Weights are hashed from the seed and the passage index, so there is no edge list to shuffle or
+// sort and the maze does not depend on the number of threads. The start room is a single node and the exits are
+// opened like the tiled generator's.
+class FMazeBoruvkaGenerator
+{
+public:
+    explicit FMazeBoruvkaGenerator(FMazeThreadPool& InPool) : Pool(InPool) {}
+
+    void Generate(const FMazeParams& Params, FMazeBitGrid& OutGrid);
+
+    // Rounds the last Generate needed, about log of the lattice size
+    int32_t GetNumRounds() const { return NumRounds; }
+
+private:
+    void ResetParents(uint32_t NumComponents);
+
+    FMazeThreadPool& Pool;
+
+    // Component of every lattice cell, row-major, dense in [0, NumComponents). Parents is the union-find over
+    // those ids, reset each round until the passages are listed and kept from then on.
+    std::vector<uint32_t> Labels;
+    std::vector<uint32_t> Parents;
+    std::vector<uint64_t> Lightest;
+
+    // Passages still joining two components, once few enough are left to be worth listing
+    std::vector<uint32_t> LiveEdges;
+
+    int32_t NumRounds = 0;
+};
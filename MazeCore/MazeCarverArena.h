@@ -0,0 +1,80 @@
+#pragma once
+
+#include "MazeTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Cell packed into 32 bits as Y << 16 | X, for grids of up to 65536 cells a side
+inline uint32_t PackMazeCell(FMazeCell Cell)
+{
+    return uint32_t(Cell.Y) << 16 | uint32_t(Cell.X);
+}
+
+inline FMazeCell UnpackMazeCell(uint32_t Packed)
+{
+    return FMazeCell{ int32_t(Packed & 0xFFFF), int32_t(Packed >> 16) };
+}
+
+// Deepest a depth-first carver stack can get in a Width x Height area: every entry is a distinct cell of the start
+// cell's parity, plus one for a start cell outside the area
+inline size_t GetMazeCellStackBound(int32_t Width, int32_t Height)
+{
+    return size_t((Width + 1) / 2) * size_t((Height + 1) / 2) + 1;
+}
+
+// Stack of packed cells over a slice of an FMazeCarverArena. Its capacity is an upper bound the owner worked out
+// beforehand (GetMazeCellStackBound), so pushes are not checked and never allocate.
+class FMazeCellStack
+{
+public:
+    FMazeCellStack() = default;
+    FMazeCellStack(uint32_t* InData, size_t InCapacity) : Data(InData), Capacity(InCapacity) {}
+
+    bool IsEmpty() const { return Num == 0; }
+    size_t GetNum() const { return Num; }
+    size_t GetCapacity() const { return Capacity; }
+
+    void Push(FMazeCell Cell) { Data[Num++] = PackMazeCell(Cell); }
+    void Pop() { --Num; }
+    void Clear() { Num = 0; }
+
+    FMazeCell Top() const { return UnpackMazeCell(Data[Num - 1]); }
+    FMazeCell Bottom() const { return UnpackMazeCell(Data[0]); }
+
+private:
+    uint32_t* Data = nullptr;
+    size_t Num = 0;
+    size_t Capacity = 0;
+};
+
+// One block of stack memory for the carvers of a generation, cut into equal slices. The block is only replaced
+// when a larger maze needs more, so an arena kept by its owner makes later generations allocation-free. It is
+// left uninitialised: the upper bounds are far above what a stack usually reaches, and pages nobody writes to
+// are never committed.
+class FMazeCarverArena
+{
+public:
+    // Room for NumStacks stacks of StackCapacity cells; stacks handed out before are invalidated
+    void Reserve(int32_t NumStacks, size_t StackCapacity)
+    {
+        const size_t Needed = size_t(NumStacks > 0 ? NumStacks : 0) * StackCapacity;
+        if (Needed > BlockSize)
+        {
+            Block = std::make_unique_for_overwrite<uint32_t[]>(Needed);
+            BlockSize = Needed;
+        }
+        Capacity = StackCapacity;
+    }
+
+    // Empty stack over slice Index of the last Reserve
+    FMazeCellStack GetStack(int32_t Index) const { return FMazeCellStack(Block.get() + size_t(Index) * Capacity, Capacity); }
+
+    size_t GetReservedBytes() const { return BlockSize * sizeof(uint32_t); }
+
+private:
+    std::unique_ptr<uint32_t[]> Block;
+    size_t BlockSize = 0;
+    size_t Capacity = 0;
+};
@@ -0,0 +1,534 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeCarverArena.h"
+#include "MazeRandom.h"
+#include "MazeTrace.h"
+#include "MazeTypes.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Algorithms a direction carver can use. Each one carves a spanning tree of the cells its region allows, starting
+// from a cell that is already open, so every carved cell stays reachable whatever the mix.
+enum class EMazeCarverAlgorithm : uint8_t
+{
+    // Depth-first with an explicit stack: long winding corridors, the stack is a slice of the caller's arena
+    Backtracker,
+    // Randomized Prim over a frontier of candidate passages: short branches and many dead ends, memory grows with the frontier
+    Prim,
+    // Randomized Kruskal with a union-find over every passage of the region: evenly spread texture, the most memory
+    Kruskal,
+    // Wilson's loop-erased random walks: an unbiased uniform spanning tree, slowest while the tree is still small
+    Wilson
+};
+
+// The wedge of one of the four direction carvers (0..3 = north, south, east, west) between the diagonals through the
+// maze centre; north and south own the diagonals themselves. The wedges are disjoint, so every cell has one writer.
+// The perimeter is left out, it is walled up after carving and would cut off anything routed along it.
+struct FMazeWedgeRegion
+{
+    int32_t Width = 0;
+    int32_t Height = 0;
+    int32_t Carver = 0;
+
+    bool Contains(int32_t X, int32_t Y) const
+    {
+        if (X <= 0 || Y <= 0 || X >= Width - 1 || Y >= Height - 1)
+        {
+            return false;
+        }
+
+        const int32_t dx = X - Width / 2;
+        const int32_t dy = Y - Height / 2;
+        const bool bNorth = dy < 0 && -dy >= std::abs(dx);
+        const bool bSouth = dy > 0 && dy >= std::abs(dx);
+
+        switch (Carver)
+        {
+        case 0: return bNorth;
+        case 1: return bSouth;
+        case 2: return dx > 0 && !bNorth && !bSouth;
+        default: return dx < 0 && !bNorth && !bSouth;
+        }
+    }
+
+    // Grid cells that can be inside the wedge
+    FMazeRect GetBounds() const
+    {
+        const int32_t CenterX = Width / 2;
+        const int32_t CenterY = Height / 2;
+        switch (Carver)
+        {
+        case 0: return FMazeRect{ 0, 0, Width, CenterY };
+        case 1: return FMazeRect{ 0, CenterY + 1, Width, Height - CenterY - 1 };
+        case 2: return FMazeRect{ CenterX + 1, 0, Width - CenterX - 1, Height };
+        default: return FMazeRect{ 0, 0, CenterX, Height };
+        }
+    }
+};
+
+// Shared plumbing of the carvers below. TRegion needs Contains(X, Y) and, for the carvers that index their whole
+// region up front, GetBounds(). Cells sit two apart (the start cell's parity) with a wall cell between them.
+// Grid writes are atomic because carvers of neighbouring regions run concurrently on the same grid words.
+template <typename TRegion>
+class TMazeCarverBase
+{
+protected:
+    static constexpr int32_t DirX[4] = { 1, -1, 0, 0 };
+    static constexpr int32_t DirY[4] = { 0, 0, 1, -1 };
+    static constexpr uint32_t NoCell = ~uint32_t(0);
+
+    TMazeCarverBase(FMazeBitGrid& InGrid, const TRegion& InRegion, FMazeCell InStart, const FMazeXoshiro256& InRng)
+        : Grid(InGrid), Region(InRegion), Start(InStart), Rng(InRng)
+    {
+    }
+
+    // The cell two steps from From in direction D and the wall between, if both lie in the region
+    bool GetStep(FMazeCell From, int32_t D, FMazeCell& OutNext, FMazeCell& OutBetween) const
+    {
+        OutNext = FMazeCell{ From.X + 2 * DirX[D], From.Y + 2 * DirY[D] };
+        OutBetween = FMazeCell{ From.X + DirX[D], From.Y + DirY[D] };
+        return Region.Contains(OutNext.X, OutNext.Y) && Region.Contains(OutBetween.X, OutBetween.Y);
+    }
+
+    // Opens the passage into a cell this carver already owns
+    void Open(FMazeCell Between, FMazeCell Cell)
+    {
+        Grid.TryClaim(Between.X, Between.Y);
+        Grid.ClearWallAtomic(Between.X, Between.Y);
+        Grid.ClearWallAtomic(Cell.X, Cell.Y);
+    }
+
+    // Claims every cell reachable from Start inside the region and gives each an id (Start is 0), for the
+    // algorithms that need the whole cell set before they carve. Claimed cells keep their walls until carved.
+    void ReserveRegion()
+    {
+        const FMazeRect Bounds = Region.GetBounds();
+        LatticeX = Bounds.X + ((Start.X - Bounds.X) & 1);
+        LatticeY = Bounds.Y + ((Start.Y - Bounds.Y) & 1);
+        LatticeWidth = std::max((Bounds.X + Bounds.Width - LatticeX + 1) / 2, 0);
+        LatticeHeight = std::max((Bounds.Y + Bounds.Height - LatticeY + 1) / 2, 0);
+        CellIds.assign(size_t(LatticeWidth) * LatticeHeight, NoCell);
+
+        Cells.push_back(Start);
+        if (const size_t StartIndex = FindLatticeIndex(Start); StartIndex != NoLatticeIndex)
+        {
+            CellIds[StartIndex] = 0;
+        }
+        for (size_t i = 0; i < Cells.size(); ++i)
+        {
+            for (int32_t D = 0; D < 4; ++D)
+            {
+                FMazeCell Next;
+                FMazeCell Between;
+                if (!GetStep(Cells[i], D, Next, Between))
+                {
+                    continue;
+                }
+                ++NumChecks;
+                const size_t Index = FindLatticeIndex(Next);
+                if (Index != NoLatticeIndex && CellIds[Index] == NoCell && Grid.TryClaim(Next.X, Next.Y))
+                {
+                    CellIds[Index] = uint32_t(Cells.size());
+                    Cells.push_back(Next);
+                }
+            }
+        }
+    }
+
+    // Id of the reserved neighbour of cell Id in direction D, NoCell if there is none
+    uint32_t GetReservedNeighbor(uint32_t Id, int32_t D) const
+    {
+        FMazeCell Next;
+        FMazeCell Between;
+        if (!GetStep(Cells[Id], D, Next, Between))
+        {
+            return NoCell;
+        }
+        const size_t Index = FindLatticeIndex(Next);
+        return Index == NoLatticeIndex ? NoCell : CellIds[Index];
+    }
+
+    // Publishes the counters once the carver has run out of work; always returns false
+    bool Finish()
+    {
+        MAZE_TRACE_COUNT(StepsTaken, NumSteps);
+        MAZE_TRACE_COUNT(Backtracks, NumBacktracks);
+        MAZE_TRACE_COUNT(NeighborChecks, NumChecks);
+        NumSteps = NumBacktracks = NumChecks = 0;
+        return false;
+    }
+
+    FMazeBitGrid& Grid;
+    TRegion Region;
+    FMazeCell Start;
+    FMazeXoshiro256 Rng;
+
+    // Summed locally, carvers bumping the shared counters every step would only measure the counters
+    int64_t NumSteps = 0;
+    int64_t NumBacktracks = 0;
+    int64_t NumChecks = 0;
+
+    // Filled by ReserveRegion
+    std::vector<FMazeCell> Cells;
+
+private:
+    static constexpr size_t NoLatticeIndex = ~size_t(0);
+
+    size_t FindLatticeIndex(FMazeCell Cell) const
+    {
+        const int32_t I = (Cell.X - LatticeX) >> 1;
+        const int32_t J = (Cell.Y - LatticeY) >> 1;
+        if (Cell.X < LatticeX || Cell.Y < LatticeY || I >= LatticeWidth || J >= LatticeHeight)
+        {
+            return NoLatticeIndex;
+        }
+        return size_t(J) * LatticeWidth + I;
+    }
+
+    int32_t LatticeX = 0;
+    int32_t LatticeY = 0;
+    int32_t LatticeWidth = 0;
+    int32_t LatticeHeight = 0;
+    std::vector<uint32_t> CellIds;
+};
+
+// Every carver has the same shape: construct it on an open start cell, then call Step until it returns false.
+// Steps are small, so callers can interleave carvers or stop between them. The exception is the first step of
+// Kruskal and Wilson, which reserves the whole region.
+
+template <typename TRegion>
+class TMazeBacktrackerCarver : public TMazeCarverBase<TRegion>
+{
+    using Super = TMazeCarverBase<TRegion>;
+
+public:
+    // InStack is an empty arena stack with room for GetMazeCellStackBound of the region's bounds
+    TMazeBacktrackerCarver(FMazeBitGrid& InGrid, const TRegion& InRegion, FMazeCell InStart, const FMazeXoshiro256& InRng, FMazeCellStack InStack)
+        : Super(InGrid, InRegion, InStart, InRng)
+        , Stack(InStack)
+    {
+        Stack.Push(InStart);
+    }
+
+    bool Step()
+    {
+        if (Stack.IsEmpty())
+        {
+            return this->Finish();
+        }
+
+        // The order is shuffled in place, each step starts from the previous permutation
+        const FMazeCell Current = Stack.Top();
+        for (int32_t i = 3; i > 0; --i)
+        {
+            std::swap(Order[i], Order[this->Rng.NextBelow(uint32_t(i + 1))]);
+        }
+        ++this->NumSteps;
+
+        for (int32_t D : Order)
+        {
+            FMazeCell Next;
+            FMazeCell Between;
+            if (!this->GetStep(Current, D, Next, Between))
+            {
+                continue;
+            }
+            ++this->NumChecks;
+            if (!this->Grid.IsVisitedAtomic(Next.X, Next.Y) && this->Grid.TryClaim(Next.X, Next.Y))
+            {
+                this->Open(Between, Next);
+                Stack.Push(Next);
+                return true;
+            }
+        }
+
+        ++this->NumBacktracks;
+        Stack.Pop();
+        return true;
+    }
+
+private:
+    FMazeCellStack Stack;
+    int32_t Order[4] = { 0, 1, 2, 3 };
+};
+
+template <typename TRegion>
+class TMazePrimCarver : public TMazeCarverBase<TRegion>
+{
+    using Super = TMazeCarverBase<TRegion>;
+
+public:
+    TMazePrimCarver(FMazeBitGrid& InGrid, const TRegion& InRegion, FMazeCell InStart, const FMazeXoshiro256& InRng)
+        : Super(InGrid, InRegion, InStart, InRng)
+    {
+        AddFrontier(InStart);
+    }
+
+    bool Step()
+    {
+        if (Frontier.empty())
+        {
+            return this->Finish();
+        }
+
+        // Swap-remove a random candidate; it is stale if the cell was reached through another passage meanwhile
+        ++this->NumSteps;
+        const size_t Pick = this->Rng.NextBelow(uint32_t(Frontier.size()));
+        const FCandidate Candidate = Frontier[Pick];
+        Frontier[Pick] = Frontier.back();
+        Frontier.pop_back();
+
+        if (this->Grid.TryClaim(Candidate.Cell.X, Candidate.Cell.Y))
+        {
+            this->Open(Candidate.Between, Candidate.Cell);
+            AddFrontier(Candidate.Cell);
+        }
+        else
+        {
+            ++this->NumBacktracks;
+        }
+        return true;
+    }
+
+private:
+    struct FCandidate
+    {
+        FMazeCell Cell;
+        FMazeCell Between;
+    };
+
+    void AddFrontier(FMazeCell From)
+    {
+        for (int32_t D = 0; D < 4; ++D)
+        {
+            FCandidate Candidate;
+            if (this->GetStep(From, D, Candidate.Cell, Candidate.Between))
+            {
+                ++this->NumChecks;
+                if (!this->Grid.IsVisitedAtomic(Candidate.Cell.X, Candidate.Cell.Y))
+                {
+                    Frontier.push_back(Candidate);
+                }
+            }
+        }
+    }
+
+    std::vector<FCandidate> Frontier;
+};
+
+template <typename TRegion>
+class TMazeKruskalCarver : public TMazeCarverBase<TRegion>
+{
+    using Super = TMazeCarverBase<TRegion>;
+
+public:
+    TMazeKruskalCarver(FMazeBitGrid& InGrid, const TRegion& InRegion, FMazeCell InStart, const FMazeXoshiro256& InRng)
+        : Super(InGrid, InRegion, InStart, InRng)
+    {
+    }
+
+    bool Step()
+    {
+        if (!bPrepared)
+        {
+            Prepare();
+            return true;
+        }
+        if (NextEdge == Edges.size())
+        {
+            return this->Finish();
+        }
+
+        ++this->NumSteps;
+        const FEdge Edge = Edges[NextEdge++];
+        const uint32_t RootA = Find(Edge.A);
+        const uint32_t RootB = Find(Edge.B);
+        if (RootA == RootB)
+        {
+            return true;
+        }
+        Parent[std::max(RootA, RootB)] = std::min(RootA, RootB);
+
+        const FMazeCell A = this->Cells[Edge.A];
+        const FMazeCell B = this->Cells[Edge.B];
+        this->Grid.ClearWallAtomic(A.X, A.Y);
+        this->Open(FMazeCell{ (A.X + B.X) / 2, (A.Y + B.Y) / 2 }, B);
+        return true;
+    }
+
+private:
+    struct FEdge
+    {
+        uint32_t A;
+        uint32_t B;
+    };
+
+    // The first step, so the whole-region setup runs wherever the carver runs
+    void Prepare()
+    {
+        bPrepared = true;
+        this->ReserveRegion();
+
+        // Every passage once, towards +x and +y
+        const uint32_t NumCells = uint32_t(this->Cells.size());
+        for (uint32_t Id = 0; Id < NumCells; ++Id)
+        {
+            for (int32_t D : { 0, 2 })
+            {
+                const uint32_t Neighbor = this->GetReservedNeighbor(Id, D);
+                if (Neighbor != Super::NoCell)
+                {
+                    Edges.push_back({ Id, Neighbor });
+                }
+            }
+        }
+        ShuffleMazeItems(Edges, this->Rng);
+
+        Parent.resize(NumCells);
+        for (uint32_t Id = 0; Id < NumCells; ++Id)
+        {
+            Parent[Id] = Id;
+        }
+    }
+
+    uint32_t Find(uint32_t Id)
+    {
+        while (Parent[Id] != Id)
+        {
+            Parent[Id] = Parent[Parent[Id]];
+            Id = Parent[Id];
+        }
+        return Id;
+    }
+
+    std::vector<FEdge> Edges;
+    std::vector<uint32_t> Parent;
+    size_t NextEdge = 0;
+    bool bPrepared = false;
+};
+
+template <typename TRegion>
+class TMazeWilsonCarver : public TMazeCarverBase<TRegion>
+{
+    using Super = TMazeCarverBase<TRegion>;
+
+public:
+    TMazeWilsonCarver(FMazeBitGrid& InGrid, const TRegion& InRegion, FMazeCell InStart, const FMazeXoshiro256& InRng)
+        : Super(InGrid, InRegion, InStart, InRng)
+    {
+    }
+
+    bool Step()
+    {
+        if (Phase == EPhase::Unprepared)
+        {
+            // Like Kruskal, the region is reserved by the first step rather than by whoever builds the carver
+            this->ReserveRegion();
+            InTree.assign(this->Cells.size(), 0);
+            InTree[0] = 1;
+            WalkDirections.assign(this->Cells.size(), 0);
+            Phase = EPhase::Idle;
+            return true;
+        }
+        if (Phase == EPhase::Idle)
+        {
+            // Cells come in reservation order, nearest to the tree first, which keeps the early walks short
+            while (NextWalkStart < this->Cells.size() && InTree[NextWalkStart])
+            {
+                ++NextWalkStart;
+            }
+            if (NextWalkStart == this->Cells.size())
+            {
+                return this->Finish();
+            }
+            Walker = uint32_t(NextWalkStart);
+            Phase = EPhase::Walking;
+        }
+
+        ++this->NumSteps;
+        if (Phase == EPhase::Walking)
+        {
+            // Overwriting the direction a cell was last left by erases any loop the walk made through it
+            int32_t Directions[4];
+            uint32_t Neighbors[4];
+            uint32_t NumOptions = 0;
+            for (int32_t D = 0; D < 4; ++D)
+            {
+                ++this->NumChecks;
+                const uint32_t Neighbor = this->GetReservedNeighbor(Walker, D);
+                if (Neighbor != Super::NoCell)
+                {
+                    Directions[NumOptions] = D;
+                    Neighbors[NumOptions++] = Neighbor;
+                }
+            }
+
+            const uint32_t Pick = this->Rng.NextBelow(NumOptions);
+            WalkDirections[Walker] = uint8_t(Directions[Pick]);
+            Walker = Neighbors[Pick];
+            if (InTree[Walker])
+            {
+                Walker = uint32_t(NextWalkStart);
+                Phase = EPhase::Carving;
+            }
+            return true;
+        }
+
+        // Carving: follow the loop-erased walk into the tree, one cell per step
+        const uint32_t Next = this->GetReservedNeighbor(Walker, WalkDirections[Walker]);
+        const FMazeCell Cell = this->Cells[Walker];
+        const FMazeCell NextCell = this->Cells[Next];
+        this->Grid.ClearWallAtomic(Cell.X, Cell.Y);
+        this->Open(FMazeCell{ (Cell.X + NextCell.X) / 2, (Cell.Y + NextCell.Y) / 2 }, NextCell);
+        InTree[Walker] = 1;
+        Walker = Next;
+        if (InTree[Walker])
+        {
+            Phase = EPhase::Idle;
+        }
+        return true;
+    }
+
+private:
+    enum class EPhase : uint8_t
+    {
+        Unprepared,
+        Idle,
+        Walking,
+        Carving
+    };
+
+    std::vector<uint8_t> InTree;
+    std::vector<uint8_t> WalkDirections;
+    size_t NextWalkStart = 1;
+    uint32_t Walker = 0;
+    EPhase Phase = EPhase::Unprepared;
+};
+
+// One carver of any algorithm. The algorithm is picked once when the carver is made; callers std::visit it with a
+// generic lambda that loops over Step, so the loop itself is compiled per algorithm with no dispatch inside.
+template <typename TRegion>
+using TMazeCarver = std::variant<TMazeBacktrackerCarver<TRegion>, TMazePrimCarver<TRegion>, TMazeKruskalCarver<TRegion>, TMazeWilsonCarver<TRegion>>;
+
+// Stack is only used by the backtracker, the other algorithms keep their own cell lists
+template <typename TRegion>
+TMazeCarver<TRegion> MakeMazeCarver(EMazeCarverAlgorithm Algorithm, FMazeBitGrid& Grid, const TRegion& Region, FMazeCell Start, const FMazeXoshiro256& Rng, FMazeCellStack Stack)
+{
+    switch (Algorithm)
+    {
+    case EMazeCarverAlgorithm::Prim:
+        return TMazeCarver<TRegion>(std::in_place_type<TMazePrimCarver<TRegion>>, Grid, Region, Start, Rng);
+    case EMazeCarverAlgorithm::Kruskal:
+        return TMazeCarver<TRegion>(std::in_place_type<TMazeKruskalCarver<TRegion>>, Grid, Region, Start, Rng);
+    case EMazeCarverAlgorithm::Wilson:
+        return TMazeCarver<TRegion>(std::in_place_type<TMazeWilsonCarver<TRegion>>, Grid, Region, Start, Rng);
+    default:
+        return TMazeCarver<TRegion>(std::in_place_type<TMazeBacktrackerCarver<TRegion>>, Grid, Region, Start, Rng, Stack);
+    }
+}
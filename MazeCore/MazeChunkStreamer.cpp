@@ -0,0 +1,202 @@
+#include "MazeChunkStreamer.h"
+#include "MazeRandom.h"
+#include "MazeThreadPool.h"
+#include "MazeTiledGenerator.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+    // Salts keeping chunk interiors and the two borders a chunk owns on independent streams
+    constexpr uint64_t InteriorSalt = 0;
+    constexpr uint64_t WestBorderSalt = 1;
+    constexpr uint64_t NorthBorderSalt = 2;
+
+    uint64_t GetChunkSeed(uint64_t BaseSeed, FMazeChunkCoord Coord, uint64_t Salt)
+    {
+        return MixMazeSeed(MixMazeSeed(BaseSeed, Coord.GetKey()), Salt);
+    }
+
+    // Pick distinct lattice positions along a border
+    void ChooseBorderOpenings(uint64_t Seed, int32_t LatticeCells, int32_t NumOpenings, std::vector<int32_t>& OutPositions)
+    {
+        OutPositions.resize(LatticeCells);
+        for (int32_t i = 0; i < LatticeCells; ++i)
+        {
+            OutPositions[i] = i;
+        }
+
+        FMazeSplitMix64 Rng(Seed);
+        NumOpenings = std::min(NumOpenings, LatticeCells);
+        for (int32_t i = 0; i < NumOpenings; ++i)
+        {
+            std::swap(OutPositions[i], OutPositions[i + Rng.NextBelow(uint32_t(LatticeCells - i))]);
+        }
+        OutPositions.resize(NumOpenings);
+    }
+}
+
+FMazeChunkGenerator::FMazeChunkGenerator(const FMazeParams& InParams, int32_t InChunkSize, int32_t InOpeningsPerBorder)
+    : BaseSeed(InParams.GetCombinedSeed())
+    , ChunkSize(std::max((InChunkSize + 1) & ~1, 4))
+    , OpeningsPerBorder(std::max(InOpeningsPerBorder, 1))
+{
+}
+
+void FMazeChunkGenerator::Generate(FMazeChunkCoord Coord, FMazeBitGrid& OutGrid) const
+{
+    MAZE_TRACE_SCOPE("MazeChunk.Generate");
+    // Row 0 and column 0 are the borders shared with the north and west neighbours
+    OutGrid.Init(ChunkSize, ChunkSize);
+
+    const int32_t LatticeCells = ChunkSize / 2;
+    std::vector<uint32_t> Labels;
+    CarveLatticeForest(OutGrid, 0, 0, LatticeCells, LatticeCells, FMazeRect(), GetChunkSeed(BaseSeed, Coord, InteriorSalt), Labels);
+
+    std::vector<int32_t> Openings;
+    ChooseBorderOpenings(GetChunkSeed(BaseSeed, Coord, WestBorderSalt), LatticeCells, OpeningsPerBorder, Openings);
+    for (int32_t j : Openings)
+    {
+        OutGrid.ClearWall(0, 2 * j + 1);
+    }
+
+    ChooseBorderOpenings(GetChunkSeed(BaseSeed, Coord, NorthBorderSalt), LatticeCells, OpeningsPerBorder, Openings);
+    for (int32_t i : Openings)
+    {
+        OutGrid.ClearWall(2 * i + 1, 0);
+    }
+}
+
+FMazeChunkCache::FMazeChunkCache(const FMazeChunkGenerator& InGenerator, size_t InCapacity, FMazeThreadPool& InPool)
+    : Generator(InGenerator)
+    , Pool(InPool)
+    , Capacity(std::max<size_t>(InCapacity, 1))
+{
+}
+
+FMazeChunkCache::~FMazeChunkCache()
+{
+    // Jobs hold a pointer to the cache, wait for them before tearing it down
+    std::unique_lock<std::mutex> Lock(Mutex);
+    JobsChanged.wait(Lock, [this]() { return NumJobsInFlight == 0; });
+}
+
+void FMazeChunkCache::Prefetch(FMazeChunkCoord Center, int32_t Radius)
+{
+    std::vector<FMazeChunkCoord> ToGenerate;
+    {
+        std::unique_lock<std::mutex> Lock(Mutex, std::defer_lock);
+        LockMazeTraced(Lock);
+
+        // Touch from the outside in so the chunks nearest the centre end up most recently used
+        for (int32_t Ring = Radius; Ring >= 0; --Ring)
+        {
+            for (int32_t dy = -Ring; dy <= Ring; ++dy)
+            {
+                for (int32_t dx = -Ring; dx <= Ring; ++dx)
+                {
+                    if (std::max(std::abs(dx), std::abs(dy)) != Ring)
+                    {
+                        continue;
+                    }
+
+                    const FMazeChunkCoord Coord{ Center.X + dx, Center.Y + dy };
+                    auto Found = Entries.find(Coord.GetKey());
+                    if (Found != Entries.end())
+                    {
+                        Touch(Found->second);
+                        continue;
+                    }
+
+                    // A pending entry has no chunk yet; it is filled in when its job finishes
+                    Lru.push_front(Coord.GetKey());
+                    Entries.emplace(Coord.GetKey(), FEntry{ nullptr, Lru.begin() });
+                    ToGenerate.push_back(Coord);
+                }
+            }
+        }
+
+        NumJobsInFlight += int32_t(ToGenerate.size());
+        EvictOverCapacity();
+    }
+
+    // Nearest chunks were added last, queue them first
+    for (auto It = ToGenerate.rbegin(); It != ToGenerate.rend(); ++It)
+    {
+        const FMazeChunkCoord Coord = *It;
+        Pool.Submit([this, Coord]()
+        {
+            auto Chunk = std::make_shared<FMazeChunk>();
+            Chunk->Coord = Coord;
+            Generator.Generate(Coord, Chunk->Grid);
+            OnChunkGenerated(std::move(Chunk));
+        });
+    }
+}
+
+std::shared_ptr<const FMazeChunk> FMazeChunkCache::Find(FMazeChunkCoord Coord) const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto Found = Entries.find(Coord.GetKey());
+    return Found != Entries.end() ? Found->second.Chunk : nullptr;
+}
+
+void FMazeChunkCache::ConsumeCompleted(std::vector<std::shared_ptr<const FMazeChunk>>& OutChunks)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    OutChunks.clear();
+    OutChunks.swap(Completed);
+}
+
+void FMazeChunkCache::ConsumeEvicted(std::vector<FMazeChunkCoord>& OutCoords)
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    OutCoords.clear();
+    OutCoords.swap(Evicted);
+}
+
+size_t FMazeChunkCache::GetNumCached() const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Entries.size();
+}
+
+void FMazeChunkCache::Touch(FEntry& Entry)
+{
+    Lru.splice(Lru.begin(), Lru, Entry.LruPosition);
+}
+
+void FMazeChunkCache::EvictOverCapacity()
+{
+    while (Entries.size() > Capacity)
+    {
+        const uint64_t Key = Lru.back();
+        Lru.pop_back();
+
+        auto Found = Entries.find(Key);
+        if (Found->second.Chunk)
+        {
+            Evicted.push_back(Found->second.Chunk->Coord);
+        }
+        Entries.erase(Found);
+    }
+}
+
+void FMazeChunkCache::OnChunkGenerated(std::shared_ptr<const FMazeChunk> Chunk)
+{
+    std::unique_lock<std::mutex> Lock(Mutex, std::defer_lock);
+    LockMazeTraced(Lock);
+
+    // Drop the result if the chunk was evicted while it was being generated
+    auto Found = Entries.find(Chunk->Coord.GetKey());
+    if (Found != Entries.end() && !Found->second.Chunk)
+    {
+        Found->second.Chunk = Chunk;
+        Completed.push_back(std::move(Chunk));
+    }
+
+    --NumJobsInFlight;
+    JobsChanged.notify_all();
+}
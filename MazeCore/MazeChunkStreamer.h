@@ -0,0 +1,99 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTypes.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class FMazeThreadPool;
+
+struct FMazeChunkCoord
+{
+    int32_t X = 0;
+    int32_t Y = 0;
+
+    bool operator==(const FMazeChunkCoord& Other) const { return X == Other.X && Y == Other.Y; }
+    uint64_t GetKey() const { return uint64_t(uint32_t(X)) << 32 | uint32_t(Y); }
+};
+
+// One square piece of an unbounded maze, covering world cells [Coord * Size, Coord * Size + Size)
+struct FMazeChunk
+{
+    FMazeChunkCoord Coord;
+    FMazeBitGrid Grid;
+};
+
+// Produces any chunk of an unbounded maze on demand. A chunk only depends on the seeds and its coordinates.
+// Each chunk owns its west column and north row; openings in them are derived from the border's own seed,
+// so two neighbouring chunks always agree on their shared border no matter which one is generated first.
+class FMazeChunkGenerator
+{
+public:
+    // ChunkSize is rounded up to an even number of cells (at least 4)
+    FMazeChunkGenerator(const FMazeParams& InParams, int32_t InChunkSize, int32_t InOpeningsPerBorder = 2);
+
+    int32_t GetChunkSize() const { return ChunkSize; }
+
+    void Generate(FMazeChunkCoord Coord, FMazeBitGrid& OutGrid) const;
+
+private:
+    uint64_t BaseSeed;
+    int32_t ChunkSize;
+    int32_t OpeningsPerBorder;
+};
+
+// Bounded LRU cache of generated chunks. Missing chunks around the player are generated on background
+// threads; once the cache is over capacity the least recently requested chunks are evicted.
+// Capacity should exceed (2 * Radius + 1)^2 of the largest prefetch, otherwise chunks in view get evicted.
+class FMazeChunkCache
+{
+public:
+    FMazeChunkCache(const FMazeChunkGenerator& InGenerator, size_t InCapacity, FMazeThreadPool& InPool);
+    ~FMazeChunkCache();
+
+    FMazeChunkCache(const FMazeChunkCache&) = delete;
+    FMazeChunkCache& operator=(const FMazeChunkCache&) = delete;
+
+    // Mark every chunk within Radius of Center as recently used and queue the missing ones for generation
+    void Prefetch(FMazeChunkCoord Center, int32_t Radius);
+
+    // Generated chunk, or nullptr if it is not cached or still being generated
+    std::shared_ptr<const FMazeChunk> Find(FMazeChunkCoord Coord) const;
+
+    // Chunks that finished generating since the last call
+    void ConsumeCompleted(std::vector<std::shared_ptr<const FMazeChunk>>& OutChunks);
+
+    // Chunks that were evicted since the last call
+    void ConsumeEvicted(std::vector<FMazeChunkCoord>& OutCoords);
+
+    size_t GetNumCached() const;
+
+private:
+    struct FEntry
+    {
+        std::shared_ptr<const FMazeChunk> Chunk;
+        std::list<uint64_t>::iterator LruPosition;
+    };
+
+    void Touch(FEntry& Entry);
+    void EvictOverCapacity();
+    void OnChunkGenerated(std::shared_ptr<const FMazeChunk> Chunk);
+
+    const FMazeChunkGenerator& Generator;
+    FMazeThreadPool& Pool;
+    size_t Capacity;
+
+    mutable std::mutex Mutex;
+    std::condition_variable JobsChanged;
+    std::unordered_map<uint64_t, FEntry> Entries;
+    std::list<uint64_t> Lru;
+    std::vector<std::shared_ptr<const FMazeChunk>> Completed;
+    std::vector<FMazeChunkCoord> Evicted;
+    int32_t NumJobsInFlight = 0;
+};
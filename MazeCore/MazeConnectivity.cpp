@@ -0,0 +1,337 @@
+#include "MazeConnectivity.h"
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <numeric>
+
+namespace
+{
+    // Rows handed to one task, and the rows whose runs are merged without looking outside the band
+    constexpr int32_t RowsPerBand = 128;
+
+    // Open runs of a row as [X0, X1), from the first and last cell of each run found a word at a time. Guard and
+    // padding bits are walls, so runs never leave [0, Width).
+    template <typename TEmit>
+    void ForEachRunInRow(const uint64_t* Row, int32_t WordsPerRow, TEmit&& Emit)
+    {
+        uint64_t OpenBefore = 0;
+        int32_t RunStart = 0;
+        for (int32_t w = 0; w < WordsPerRow; ++w)
+        {
+            const uint64_t Open = ~Row[w];
+            const uint64_t OpenAfter = w + 1 < WordsPerRow ? ~Row[w + 1] & 1 : 0;
+            uint64_t Starts = Open & ~((Open << 1) | OpenBefore);
+            uint64_t Ends = Open & ~((Open >> 1) | (OpenAfter << 63));
+            OpenBefore = Open >> 63;
+
+            // Starts and ends alternate; a one-cell run has both on the same bit, the start goes first
+            const int32_t Base = w * FMazeBitGrid::BitsPerWord - FMazeBitGrid::GuardCells;
+            while (Starts | Ends)
+            {
+                if (Starts && (!Ends || std::countr_zero(Starts) <= std::countr_zero(Ends)))
+                {
+                    RunStart = Base + std::countr_zero(Starts);
+                    Starts &= Starts - 1;
+                }
+                else
+                {
+                    Emit(RunStart, Base + std::countr_zero(Ends) + 1);
+                    Ends &= Ends - 1;
+                }
+            }
+        }
+    }
+}
+
+uint32_t FMazeConnectivityValidator::Find(uint32_t Run)
+{
+    while (Labels[Run] != Run)
+    {
+        Labels[Run] = Labels[Labels[Run]];
+        Run = Labels[Run];
+    }
+    return Run;
+}
+
+void FMazeConnectivityValidator::Unite(uint32_t A, uint32_t B)
+{
+    A = Find(A);
+    B = Find(B);
+    if (A < B)
+    {
+        Labels[B] = A;
+    }
+    else if (B < A)
+    {
+        Labels[A] = B;
+    }
+}
+
+void FMazeConnectivityValidator::UniteRows(int32_t Y)
+{
+    // Runs of rows Y - 1 and Y that share a column are connected
+    uint32_t Above = RowStarts[Y - 1];
+    uint32_t Below = RowStarts[Y];
+    const uint32_t AboveEnd = RowStarts[Y];
+    const uint32_t BelowEnd = RowStarts[Y + 1];
+    while (Above < AboveEnd && Below < BelowEnd)
+    {
+        const FRun& A = Runs[Above];
+        const FRun& B = Runs[Below];
+        if (A.X0 < B.X1 && B.X0 < A.X1)
+        {
+            Unite(Above, Below);
+        }
+        if (A.X1 < B.X1)
+        {
+            ++Above;
+        }
+        else
+        {
+            ++Below;
+        }
+    }
+}
+
+void FMazeConnectivityValidator::BuildRuns(const FMazeWallPlane& Grid)
+{
+    const int32_t Height = Grid.GetHeight();
+    const int32_t WordsPerRow = Grid.GetWordsPerRow();
+    const int32_t NumBands = (Height + RowsPerBand - 1) / RowsPerBand;
+    auto ForEachBand = [this, NumBands](const std::function<void(int32_t)>& Body)
+    {
+        if (Pool && NumBands > 1)
+        {
+            Pool->ParallelFor(NumBands, Body);
+        }
+        else
+        {
+            for (int32_t Band = 0; Band < NumBands; ++Band)
+            {
+                Body(Band);
+            }
+        }
+    };
+
+    // Count, then fill at the prefix sums, so every row writes its own slice
+    RowStarts.assign(size_t(Height) + 1, 0);
+    ForEachBand([this, &Grid, Height, WordsPerRow](int32_t Band)
+    {
+        const int32_t EndY = std::min(Height, (Band + 1) * RowsPerBand);
+        for (int32_t y = Band * RowsPerBand; y < EndY; ++y)
+        {
+            uint32_t Count = 0;
+            ForEachRunInRow(Grid.GetWallRow(y), WordsPerRow, [&Count](int32_t, int32_t) { ++Count; });
+            RowStarts[y + 1] = Count;
+        }
+    });
+    std::partial_sum(RowStarts.begin(), RowStarts.end(), RowStarts.begin());
+
+    Runs.resize(RowStarts[Height]);
+    ForEachBand([this, &Grid, Height, WordsPerRow](int32_t Band)
+    {
+        const int32_t EndY = std::min(Height, (Band + 1) * RowsPerBand);
+        for (int32_t y = Band * RowsPerBand; y < EndY; ++y)
+        {
+            FRun* Out = Runs.data() + RowStarts[y];
+            ForEachRunInRow(Grid.GetWallRow(y), WordsPerRow, [&Out](int32_t X0, int32_t X1) { *Out++ = FRun{ X0, X1 }; });
+        }
+    });
+}
+
+void FMazeConnectivityValidator::LabelRuns(int32_t Height)
+{
+    Labels.resize(Runs.size());
+    std::iota(Labels.begin(), Labels.end(), 0u);
+
+    // Inside a band, roots and parents stay among the band's own runs, so bands never touch each other's entries
+    const int32_t NumBands = (Height + RowsPerBand - 1) / RowsPerBand;
+    auto LabelBand = [this, Height](int32_t Band)
+    {
+        const int32_t EndY = std::min(Height, (Band + 1) * RowsPerBand);
+        for (int32_t y = Band * RowsPerBand + 1; y < EndY; ++y)
+        {
+            UniteRows(y);
+        }
+    };
+    if (Pool && NumBands > 1)
+    {
+        Pool->ParallelFor(NumBands, LabelBand);
+    }
+    else
+    {
+        for (int32_t Band = 0; Band < NumBands; ++Band)
+        {
+            LabelBand(Band);
+        }
+    }
+    for (int32_t Band = 1; Band < NumBands; ++Band)
+    {
+        UniteRows(Band * RowsPerBand);
+    }
+
+    // Parents come before their children, so one forward pass turns roots into dense component ids
+    NumComponents = 0;
+    for (size_t Run = 0; Run < Labels.size(); ++Run)
+    {
+        Labels[Run] = Labels[Run] == Run ? uint32_t(NumComponents++) : Labels[Labels[Run]];
+    }
+
+    ComponentCells.assign(NumComponents, 0);
+    for (size_t Run = 0; Run < Runs.size(); ++Run)
+    {
+        ComponentCells[Labels[Run]] += Runs[Run].X1 - Runs[Run].X0;
+    }
+}
+
+void FMazeConnectivityValidator::Report(const FMazeWallPlane& Grid, const FMazeRect& StartRoom, FMazeConnectivityReport& OutReport)
+{
+    const int32_t Width = Grid.GetWidth();
+    const int32_t Height = Grid.GetHeight();
+    OutReport.NumComponents = NumComponents;
+    OutReport.OpenCells = std::accumulate(ComponentCells.begin(), ComponentCells.end(), int64_t(0));
+    OutReport.NumExits = 0;
+    OutReport.DeadExits.clear();
+    if (NumComponents == 0)
+    {
+        OutReport.UnreachableCells = 0;
+        return;
+    }
+
+    // First open cell of the room, row by row
+    bool bFoundRoom = false;
+    for (int32_t y = std::max(StartRoom.Y, 0); y < std::min(StartRoom.Y + StartRoom.Height, Height) && !bFoundRoom; ++y)
+    {
+        for (uint32_t Run = RowStarts[y]; Run < RowStarts[y + 1]; ++Run)
+        {
+            if (Runs[Run].X0 < StartRoom.X + StartRoom.Width && StartRoom.X < Runs[Run].X1)
+            {
+                ReferenceComponent = Labels[Run];
+                bFoundRoom = true;
+                break;
+            }
+        }
+    }
+    if (!bFoundRoom)
+    {
+        ReferenceComponent = uint32_t(std::max_element(ComponentCells.begin(), ComponentCells.end()) - ComponentCells.begin());
+    }
+    OutReport.UnreachableCells = OutReport.OpenCells - ComponentCells[ReferenceComponent];
+
+    auto AddExit = [this, &OutReport](uint32_t Run, int32_t X, int32_t Y)
+    {
+        ++OutReport.NumExits;
+        if (Labels[Run] != ReferenceComponent)
+        {
+            OutReport.DeadExits.push_back(FMazeCell{ X, Y });
+        }
+    };
+    for (int32_t y = 0; y < Height; ++y)
+    {
+        const uint32_t First = RowStarts[y];
+        const uint32_t End = RowStarts[y + 1];
+        if (y == 0 || y == Height - 1)
+        {
+            for (uint32_t Run = First; Run < End; ++Run)
+            {
+                for (int32_t x = Runs[Run].X0; x < Runs[Run].X1; ++x)
+                {
+                    AddExit(Run, x, y);
+                }
+            }
+            continue;
+        }
+        if (First < End && Runs[First].X0 == 0)
+        {
+            AddExit(First, 0, y);
+        }
+        if (First < End && Runs[End - 1].X1 == Width && Width > 1)
+        {
+            AddExit(End - 1, Width - 1, y);
+        }
+    }
+}
+
+void FMazeConnectivityValidator::Validate(const FMazeWallPlane& Grid, const FMazeRect& StartRoom, FMazeConnectivityReport& OutReport)
+{
+    MAZE_TRACE_SCOPE("MazeConnectivity.Validate");
+    OutReport.WallsOpened = 0;
+    BuildRuns(Grid);
+    LabelRuns(Grid.GetHeight());
+    Report(Grid, StartRoom, OutReport);
+}
+
+void FMazeConnectivityValidator::Repair(FMazeBitGrid& Grid, const FMazeRect& StartRoom, FMazeConnectivityReport& OutReport)
+{
+    Validate(Grid, StartRoom, OutReport);
+    if (OutReport.UnreachableCells == 0 || NumComponents < 2)
+    {
+        return;
+    }
+
+    MAZE_TRACE_SCOPE("MazeConnectivity.Repair");
+    const int32_t Width = Grid.GetWidth();
+    const int32_t Height = Grid.GetHeight();
+
+    // Kruskal over components: a wall is opened only if it joins two that are still apart. Labels are dense now,
+    // the union-find over components reuses the run union-find's Find on a fresh array.
+    std::vector<uint32_t> RunComponents;
+    RunComponents.swap(Labels);
+    Labels.resize(NumComponents);
+    std::iota(Labels.begin(), Labels.end(), 0u);
+
+    int32_t WallsOpened = 0;
+    auto TryOpen = [this, &Grid, &RunComponents, &WallsOpened](uint32_t RunA, uint32_t RunB, int32_t X, int32_t Y)
+    {
+        const uint32_t A = Find(RunComponents[RunA]);
+        const uint32_t B = Find(RunComponents[RunB]);
+        if (A != B && Grid.IsWall(X, Y))
+        {
+            Unite(A, B);
+            Grid.Carve(X, Y);
+            ++WallsOpened;
+        }
+    };
+
+    // Walls between two runs of the same row, then walls between runs two rows apart; the perimeter stays closed
+    for (int32_t y = 1; y < Height - 1; ++y)
+    {
+        for (uint32_t Run = RowStarts[y]; Run + 1 < RowStarts[y + 1]; ++Run)
+        {
+            if (Runs[Run].X1 + 1 == Runs[Run + 1].X0)
+            {
+                TryOpen(Run, Run + 1, Runs[Run].X1, y);
+            }
+        }
+    }
+    for (int32_t y = 0; y + 2 < Height; ++y)
+    {
+        uint32_t Above = RowStarts[y];
+        uint32_t Below = RowStarts[y + 2];
+        while (Above < RowStarts[y + 1] && Below < RowStarts[y + 3])
+        {
+            const FRun& A = Runs[Above];
+            const FRun& B = Runs[Below];
+            const int32_t X = std::max({ A.X0, B.X0, 1 });
+            if (X < std::min({ A.X1, B.X1, Width - 1 }))
+            {
+                TryOpen(Above, Below, X, y + 1);
+            }
+            if (A.X1 < B.X1)
+            {
+                ++Above;
+            }
+            else
+            {
+                ++Below;
+            }
+        }
+    }
+
+    // The report describes the grid as it is now
+    Validate(Grid, StartRoom, OutReport);
+    OutReport.WallsOpened = WallsOpened;
+}
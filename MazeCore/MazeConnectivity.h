@@ -0,0 +1,80 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTypes.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class FMazeThreadPool;
+
+// What FMazeConnectivityValidator found in one maze
+struct FMazeConnectivityReport
+{
+    // Groups of open cells joined through their four neighbours
+    int32_t NumComponents = 0;
+    int64_t OpenCells = 0;
+
+    // Open cells not connected to the start room
+    int64_t UnreachableCells = 0;
+
+    // Open perimeter cells, and those of them the start room cannot reach
+    int32_t NumExits = 0;
+    std::vector<FMazeCell> DeadExits;
+
+    // Walls Repair opened, always 0 after Validate
+    int32_t WallsOpened = 0;
+
+    // Every open cell reachable and exactly the exits that were asked for; a maze configured without exits is
+    // valid without any
+    bool IsValid(int32_t RequestedExits) const { return NumExits == std::max(RequestedExits, 0) && UnreachableCells == 0; }
+};
+
+// Checks that every open cell of a finished maze, exits included, can be reached from the start room; cheap
+// enough to run after every generation. Open cells are read a word at a time as horizontal runs, and runs that
+// touch in consecutive rows are merged in a union-find, bands of rows in parallel and then the seams between
+// them. The cost follows the number of runs rather than the number of cells.
+class FMazeConnectivityValidator
+{
+public:
+    // Pool == nullptr validates on the calling thread
+    explicit FMazeConnectivityValidator(FMazeThreadPool* InPool = nullptr) : Pool(InPool) {}
+
+    // StartRoom is the reference; when none of its cells is open, the largest component is used instead
+    void Validate(const FMazeWallPlane& Grid, const FMazeRect& StartRoom, FMazeConnectivityReport& OutReport);
+
+    // Validate, then join the other components to the start room's by opening interior walls that have cells of
+    // two different components on opposite sides, one wall per component joined. Components only a thicker wall
+    // separates are left as they are and still show up in the report, which describes the repaired grid.
+    void Repair(FMazeBitGrid& Grid, const FMazeRect& StartRoom, FMazeConnectivityReport& OutReport);
+
+private:
+    // Open cells [X0, X1) of one row
+    struct FRun
+    {
+        int32_t X0;
+        int32_t X1;
+    };
+
+    void BuildRuns(const FMazeWallPlane& Grid);
+    void LabelRuns(int32_t Height);
+    void Report(const FMazeWallPlane& Grid, const FMazeRect& StartRoom, FMazeConnectivityReport& OutReport);
+
+    // Root with the smallest run index, so every parent index is at most its child's
+    uint32_t Find(uint32_t Run);
+    void Unite(uint32_t A, uint32_t B);
+    void UniteRows(int32_t Y);
+
+    FMazeThreadPool* Pool;
+
+    // Runs of row Y are [RowStarts[Y], RowStarts[Y + 1]), left to right
+    std::vector<FRun> Runs;
+    std::vector<uint32_t> RowStarts;
+
+    // Union-find over runs, then the component of every run
+    std::vector<uint32_t> Labels;
+    std::vector<int64_t> ComponentCells;
+    int32_t NumComponents = 0;
+    uint32_t ReferenceComponent = 0;
+};
@@ -0,0 +1,446 @@
+#include "MazeCorridorGraph.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+    // Same order as the tile neighbour mask bits: north, east, south, west
+    constexpr int32_t OffsetX[4] = { 0, 1, 0, -1 };
+    constexpr int32_t OffsetY[4] = { -1, 0, 1, 0 };
+
+    constexpr int32_t Opposite(int32_t Direction)
+    {
+        return (Direction + 2) & 3;
+    }
+
+    bool IsNodeType(EMazeTileType Type)
+    {
+        return Type == EMazeTileType::Junction || Type == EMazeTileType::Intersection || Type == EMazeTileType::DeadEnd;
+    }
+}
+
+int32_t FMazeCorridorGraph::AddNode(const FMazeBitGrid& Grid, int32_t X, int32_t Y, EMazeTileType Type)
+{
+    const int32_t Node = int32_t(NodeX.size());
+    NodeX.push_back(X);
+    NodeY.push_back(Y);
+    NodeTypes.push_back(Type);
+    NodeExits.push_back(X == 0 || Y == 0 || X == Grid.GetWidth() - 1 || Y == Grid.GetHeight() - 1);
+    CellPositions[size_t(Y) * Width + X] = NodeBit | uint32_t(Node);
+    return Node;
+}
+
+void FMazeCorridorGraph::TraceCorridor(const FMazeBitGrid& Grid, int32_t Node, int32_t Direction)
+{
+    int32_t X = NodeX[Node] + OffsetX[Direction];
+    int32_t Y = NodeY[Node] + OffsetY[Direction];
+    uint32_t Position = CellPositions[size_t(Y) * Width + X];
+
+    FMazeCorridor Corridor;
+    Corridor.NodeA = Node;
+    Corridor.FirstCell = uint32_t(CorridorCellX.size());
+
+    if (Position != NoPosition && (Position & NodeBit))
+    {
+        // Neighbouring nodes, added once from the lower index
+        const int32_t Other = int32_t(Position & ~NodeBit);
+        if (Other < Node)
+        {
+            return;
+        }
+        Corridor.NodeB = Other;
+        Corridor.Length = 1;
+        Corridors.push_back(Corridor);
+        return;
+    }
+    if (Position != NoPosition)
+    {
+        // Traced from the other end already
+        return;
+    }
+
+    const int32_t CorridorIndex = int32_t(Corridors.size());
+    int32_t Came = Opposite(Direction);
+    uint32_t Length = 1;
+    while (Position == NoPosition)
+    {
+        CellPositions[size_t(Y) * Width + X] = uint32_t(CorridorCellX.size());
+        CorridorCellX.push_back(X);
+        CorridorCellY.push_back(Y);
+        CorridorOfCell.push_back(CorridorIndex);
+        ++Length;
+
+        // Corridor cells have exactly two open sides, leave through the one we did not come from
+        const uint8_t Mask = uint8_t(GetMazeTileMask(Grid, X, Y) & ~(1 << Came));
+        int32_t Next = 0;
+        while (!(Mask & (1 << Next)))
+        {
+            ++Next;
+        }
+        X += OffsetX[Next];
+        Y += OffsetY[Next];
+        Came = Opposite(Next);
+        Position = CellPositions[size_t(Y) * Width + X];
+    }
+
+    // Every corridor ends on a node: the walk stops on the first assigned cell, and unassigned cells are never
+    // adjacent to cells of another corridor
+    Corridor.NodeB = int32_t(Position & ~NodeBit);
+    Corridor.Length = Length;
+    Corridors.push_back(Corridor);
+}
+
+void FMazeCorridorGraph::Build(const FMazeBitGrid& Grid, FMazeThreadPool* Pool)
+{
+    MAZE_TRACE_SCOPE("MazeCorridorGraph.Build");
+    Width = Grid.GetWidth();
+    Height = Grid.GetHeight();
+    NodeX.clear();
+    NodeY.clear();
+    NodeTypes.clear();
+    NodeExits.clear();
+    Corridors.clear();
+    CorridorCellX.clear();
+    CorridorCellY.clear();
+    CorridorOfCell.clear();
+    CellPositions.assign(size_t(Width) * Height, NoPosition);
+
+    FMazeTileArrays Tiles;
+    FMazeTileClassifier(Pool).Classify(Grid, Tiles);
+    NumPathCells = int64_t(Tiles.Num());
+
+    for (size_t i = 0; i < Tiles.Num(); ++i)
+    {
+        const int32_t X = Tiles.X[i];
+        const int32_t Y = Tiles.Y[i];
+        if (IsNodeType(Tiles.Type[i]) || X == 0 || Y == 0 || X == Width - 1 || Y == Height - 1)
+        {
+            AddNode(Grid, X, Y, Tiles.Type[i]);
+        }
+    }
+
+    auto TraceFrom = [this, &Grid](int32_t Node)
+    {
+        const uint8_t Mask = GetMazeTileMask(Grid, NodeX[Node], NodeY[Node]);
+        for (int32_t Direction = 0; Direction < 4; ++Direction)
+        {
+            if (Mask & (1 << Direction))
+            {
+                TraceCorridor(Grid, Node, Direction);
+            }
+        }
+    };
+
+    const int32_t NumJunctionNodes = GetNumNodes();
+    for (int32_t Node = 0; Node < NumJunctionNodes; ++Node)
+    {
+        TraceFrom(Node);
+    }
+
+    // Closed loops of straight and corner cells have no node to start from; break each one at its first cell
+    for (size_t i = 0; i < Tiles.Num(); ++i)
+    {
+        if (CellPositions[size_t(Tiles.Y[i]) * Width + Tiles.X[i]] == NoPosition)
+        {
+            TraceFrom(AddNode(Grid, Tiles.X[i], Tiles.Y[i], Tiles.Type[i]));
+        }
+    }
+
+    // CSR adjacency, each corridor once from NodeA (forward) and once from NodeB (reversed)
+    const int32_t NumNodes = GetNumNodes();
+    EdgeOffsets.assign(size_t(NumNodes) + 1, 0);
+    for (const FMazeCorridor& Corridor : Corridors)
+    {
+        ++EdgeOffsets[size_t(Corridor.NodeA) + 1];
+        ++EdgeOffsets[size_t(Corridor.NodeB) + 1];
+    }
+    for (int32_t Node = 0; Node < NumNodes; ++Node)
+    {
+        EdgeOffsets[size_t(Node) + 1] += EdgeOffsets[Node];
+    }
+
+    EdgeTargets.resize(EdgeOffsets[NumNodes]);
+    EdgeCorridors.resize(EdgeOffsets[NumNodes]);
+    std::vector<uint32_t> Fill(EdgeOffsets.begin(), EdgeOffsets.end() - 1);
+    for (int32_t c = 0; c < GetNumCorridors(); ++c)
+    {
+        const FMazeCorridor& Corridor = Corridors[c];
+        const uint32_t Forward = Fill[Corridor.NodeA]++;
+        EdgeTargets[Forward] = Corridor.NodeB;
+        EdgeCorridors[Forward] = uint32_t(c) << 1;
+        const uint32_t Reversed = Fill[Corridor.NodeB]++;
+        EdgeTargets[Reversed] = Corridor.NodeA;
+        EdgeCorridors[Reversed] = uint32_t(c) << 1 | 1;
+    }
+}
+
+FMazeCell FMazeCorridorGraph::GetCorridorCell(int32_t Corridor, uint32_t Index) const
+{
+    const uint32_t Cell = Corridors[Corridor].FirstCell + Index;
+    return FMazeCell{ CorridorCellX[Cell], CorridorCellY[Cell] };
+}
+
+FMazeGraphPosition FMazeCorridorGraph::GetPosition(int32_t X, int32_t Y) const
+{
+    FMazeGraphPosition Result;
+    if (X < 0 || X >= Width || Y < 0 || Y >= Height)
+    {
+        return Result;
+    }
+
+    const uint32_t Position = CellPositions[size_t(Y) * Width + X];
+    if (Position == NoPosition)
+    {
+        return Result;
+    }
+    if (Position & NodeBit)
+    {
+        Result.Node = int32_t(Position & ~NodeBit);
+        return Result;
+    }
+    Result.Corridor = CorridorOfCell[Position];
+    Result.Offset = int32_t(Position - Corridors[Result.Corridor].FirstCell) + 1;
+    return Result;
+}
+
+size_t FMazeCorridorGraph::GetAllocatedBytes() const
+{
+    return NodeX.capacity() * sizeof(int32_t) + NodeY.capacity() * sizeof(int32_t) + NodeTypes.capacity() + NodeExits.capacity()
+        + EdgeOffsets.capacity() * sizeof(uint32_t) + EdgeTargets.capacity() * sizeof(int32_t) + EdgeCorridors.capacity() * sizeof(uint32_t)
+        + Corridors.capacity() * sizeof(FMazeCorridor) + (CorridorCellX.capacity() + CorridorCellY.capacity() + CorridorOfCell.capacity()) * sizeof(int32_t)
+        + CellPositions.capacity() * sizeof(uint32_t);
+}
+
+uint32_t FMazeCorridorPathfinder::GetHeuristic(int32_t Node) const
+{
+    if (!bUseHeuristic)
+    {
+        return 0;
+    }
+    const FMazeCell Cell = Graph.GetNodeCell(Node);
+    return uint32_t(std::abs(Cell.X - HeuristicTarget.X) + std::abs(Cell.Y - HeuristicTarget.Y));
+}
+
+void FMazeCorridorPathfinder::Relax(int32_t Node, uint32_t Cost, int32_t ParentEdge)
+{
+    if (Cost >= GetCost(Node))
+    {
+        return;
+    }
+    Stamps[Node] = Stamp;
+    Costs[Node] = Cost;
+    ParentEdges[Node] = ParentEdge;
+    Queue.push_back(FQueueEntry{ Cost + GetHeuristic(Node), Cost, Node });
+    std::push_heap(Queue.begin(), Queue.end());
+}
+
+void FMazeCorridorPathfinder::BeginSearch(const FMazeGraphPosition& Start, const FMazeCell* Target)
+{
+    const size_t NumNodes = size_t(Graph.GetNumNodes());
+    if (Stamps.size() != NumNodes)
+    {
+        Stamps.assign(NumNodes, 0);
+        Costs.resize(NumNodes);
+        ParentEdges.resize(NumNodes);
+        Stamp = 0;
+    }
+    if (++Stamp == 0)
+    {
+        std::fill(Stamps.begin(), Stamps.end(), 0);
+        Stamp = 1;
+    }
+    Queue.clear();
+
+    bUseHeuristic = Target != nullptr;
+    if (Target)
+    {
+        HeuristicTarget = *Target;
+    }
+
+    if (Start.IsNode())
+    {
+        Relax(Start.Node, 0, StartNode);
+        return;
+    }
+    const FMazeCorridor& Corridor = Graph.GetCorridor(Start.Corridor);
+    Relax(Corridor.NodeA, uint32_t(Start.Offset), StartViaNodeA);
+    Relax(Corridor.NodeB, Corridor.Length - uint32_t(Start.Offset), StartViaNodeB);
+}
+
+void FMazeCorridorPathfinder::AppendCorridorCells(int32_t Corridor, int32_t FromOffset, int32_t ToOffset, std::vector<FMazeCell>& OutPath) const
+{
+    // Offset k (0 < k < Length) is interior cell k - 1
+    const int32_t Step = ToOffset > FromOffset ? 1 : -1;
+    for (int32_t Offset = FromOffset + Step; Offset != ToOffset; Offset += Step)
+    {
+        OutPath.push_back(Graph.GetCorridorCell(Corridor, uint32_t(Offset - 1)));
+    }
+}
+
+uint32_t FMazeCorridorPathfinder::FindPath(FMazeCell From, FMazeCell To, std::vector<FMazeCell>* OutPath)
+{
+    constexpr uint32_t NoPath = ~uint32_t(0);
+    if (OutPath)
+    {
+        OutPath->clear();
+    }
+
+    const FMazeGraphPosition Start = Graph.GetPosition(From.X, From.Y);
+    const FMazeGraphPosition Goal = Graph.GetPosition(To.X, To.Y);
+    if (!Start.IsValid() || !Goal.IsValid())
+    {
+        return NoPath;
+    }
+
+    // Goal entry points: the goal node itself, or both ends of its corridor plus the steps still left to walk
+    int32_t GoalNodes[2] = { Goal.Node, -1 };
+    uint32_t GoalExtra[2] = { 0, 0 };
+    if (!Goal.IsNode())
+    {
+        const FMazeCorridor& Corridor = Graph.GetCorridor(Goal.Corridor);
+        GoalNodes[0] = Corridor.NodeA;
+        GoalExtra[0] = uint32_t(Goal.Offset);
+        GoalNodes[1] = Corridor.NodeB;
+        GoalExtra[1] = Corridor.Length - uint32_t(Goal.Offset);
+    }
+
+    // Both cells on the same corridor can also be joined without leaving it
+    uint32_t Best = NoPath;
+    int32_t BestNode = -1;
+    int32_t BestSide = 0;
+    if (!Start.IsNode() && Start.Corridor == Goal.Corridor)
+    {
+        Best = uint32_t(std::abs(Start.Offset - Goal.Offset));
+    }
+    else if (Start.IsNode() && Start.Node == Goal.Node)
+    {
+        Best = 0;
+    }
+
+    BeginSearch(Start, &To);
+    while (!Queue.empty())
+    {
+        std::pop_heap(Queue.begin(), Queue.end());
+        const FQueueEntry Entry = Queue.back();
+        Queue.pop_back();
+        if (Entry.Priority >= Best)
+        {
+            break;
+        }
+        if (Entry.Cost != GetCost(Entry.Node))
+        {
+            continue;
+        }
+
+        for (int32_t Side = 0; Side < 2; ++Side)
+        {
+            if (Entry.Node == GoalNodes[Side] && Entry.Cost + GoalExtra[Side] < Best)
+            {
+                Best = Entry.Cost + GoalExtra[Side];
+                BestNode = Entry.Node;
+                BestSide = Side;
+            }
+        }
+
+        const uint32_t LastEdge = Graph.GetFirstEdge(Entry.Node + 1);
+        for (uint32_t Edge = Graph.GetFirstEdge(Entry.Node); Edge < LastEdge; ++Edge)
+        {
+            Relax(Graph.GetEdgeTarget(Edge), Entry.Cost + Graph.GetEdgeWeight(Edge), int32_t(Edge));
+        }
+    }
+
+    if (!OutPath || Best == NoPath)
+    {
+        return Best;
+    }
+
+    std::vector<FMazeCell>& Path = *OutPath;
+    Path.push_back(From);
+    if (BestNode < 0)
+    {
+        // Direct walk along the shared corridor, or From == To
+        if (Best > 0)
+        {
+            AppendCorridorCells(Start.Corridor, Start.Offset, Goal.Offset, Path);
+            Path.push_back(To);
+        }
+        return Best;
+    }
+
+    // Edges from the start to BestNode, collected backwards through the corridor ends they leave from
+    std::vector<int32_t> Edges;
+    int32_t Node = BestNode;
+    while (ParentEdges[Node] >= 0)
+    {
+        const uint32_t Edge = uint32_t(ParentEdges[Node]);
+        Edges.push_back(int32_t(Edge));
+        const FMazeCorridor& Corridor = Graph.GetCorridor(Graph.GetEdgeCorridor(Edge));
+        Node = Graph.IsEdgeReversed(Edge) ? Corridor.NodeB : Corridor.NodeA;
+    }
+
+    if (ParentEdges[Node] == StartViaNodeA)
+    {
+        AppendCorridorCells(Start.Corridor, Start.Offset, 0, Path);
+        Path.push_back(Graph.GetNodeCell(Node));
+    }
+    else if (ParentEdges[Node] == StartViaNodeB)
+    {
+        AppendCorridorCells(Start.Corridor, Start.Offset, int32_t(Graph.GetCorridor(Start.Corridor).Length), Path);
+        Path.push_back(Graph.GetNodeCell(Node));
+    }
+
+    for (auto It = Edges.rbegin(); It != Edges.rend(); ++It)
+    {
+        const uint32_t Edge = uint32_t(*It);
+        const int32_t Corridor = Graph.GetEdgeCorridor(Edge);
+        const int32_t Length = int32_t(Graph.GetCorridor(Corridor).Length);
+        if (Graph.IsEdgeReversed(Edge))
+        {
+            AppendCorridorCells(Corridor, Length, 0, Path);
+        }
+        else
+        {
+            AppendCorridorCells(Corridor, 0, Length, Path);
+        }
+        Path.push_back(Graph.GetNodeCell(Graph.GetEdgeTarget(Edge)));
+    }
+
+    if (!Goal.IsNode())
+    {
+        const int32_t EndOffset = BestSide == 0 ? 0 : int32_t(Graph.GetCorridor(Goal.Corridor).Length);
+        AppendCorridorCells(Goal.Corridor, EndOffset, Goal.Offset, Path);
+        Path.push_back(To);
+    }
+    return Best;
+}
+
+void FMazeCorridorPathfinder::ComputeNodeDistances(FMazeCell From, std::vector<uint32_t>& OutDistances)
+{
+    OutDistances.assign(size_t(Graph.GetNumNodes()), ~uint32_t(0));
+    const FMazeGraphPosition Start = Graph.GetPosition(From.X, From.Y);
+    if (!Start.IsValid())
+    {
+        return;
+    }
+
+    BeginSearch(Start, nullptr);
+    while (!Queue.empty())
+    {
+        std::pop_heap(Queue.begin(), Queue.end());
+        const FQueueEntry Entry = Queue.back();
+        Queue.pop_back();
+        if (Entry.Cost != GetCost(Entry.Node))
+        {
+            continue;
+        }
+
+        OutDistances[Entry.Node] = Entry.Cost;
+        const uint32_t LastEdge = Graph.GetFirstEdge(Entry.Node + 1);
+        for (uint32_t Edge = Graph.GetFirstEdge(Entry.Node); Edge < LastEdge; ++Edge)
+        {
+            Relax(Graph.GetEdgeTarget(Edge), Entry.Cost + Graph.GetEdgeWeight(Edge), int32_t(Edge));
+        }
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTileClassifier.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+class FMazeThreadPool;
+
+// Where a path cell sits on the graph: on a node, or Offset steps from NodeA along a corridor towards NodeB
+struct FMazeGraphPosition
+{
+    int32_t Node = -1;
+    int32_t Corridor = -1;
+    int32_t Offset = 0;
+
+    bool IsValid() const { return Node >= 0 || Corridor >= 0; }
+    bool IsNode() const { return Node >= 0; }
+};
+
+// Corridor between two nodes. Its interior cells are stored in order from NodeA to NodeB, Length counts the steps
+// from NodeA to NodeB (interior cells + 1). NodeA == NodeB for a loop.
+struct FMazeCorridor
+{
+    int32_t NodeA = 0;
+    int32_t NodeB = 0;
+    uint32_t Length = 0;
+    uint32_t FirstCell = 0;
+};
+
+// Compressed maze: junctions, intersections, dead ends and exits become nodes, and the straight and corner cells
+// between them collapse into weighted edges. Adjacency is stored in CSR form (EdgeOffsets indexes the edge arrays),
+// every corridor appearing once from each end. The graph is immutable once built and can be shared between threads.
+class FMazeCorridorGraph
+{
+public:
+    // Pool == nullptr builds on the calling thread
+    void Build(const FMazeBitGrid& Grid, FMazeThreadPool* Pool = nullptr);
+
+    int32_t GetNumNodes() const { return int32_t(NodeX.size()); }
+    int32_t GetNumCorridors() const { return int32_t(Corridors.size()); }
+    int64_t GetNumPathCells() const { return NumPathCells; }
+    int32_t GetWidth() const { return Width; }
+    int32_t GetHeight() const { return Height; }
+
+    FMazeCell GetNodeCell(int32_t Node) const { return FMazeCell{ NodeX[Node], NodeY[Node] }; }
+    EMazeTileType GetNodeType(int32_t Node) const { return NodeTypes[Node]; }
+    bool IsExitNode(int32_t Node) const { return NodeExits[Node] != 0; }
+
+    // Outgoing edges of Node are [GetFirstEdge(Node), GetFirstEdge(Node + 1))
+    uint32_t GetFirstEdge(int32_t Node) const { return EdgeOffsets[Node]; }
+    int32_t GetEdgeTarget(uint32_t Edge) const { return EdgeTargets[Edge]; }
+    uint32_t GetEdgeWeight(uint32_t Edge) const { return Corridors[GetEdgeCorridor(Edge)].Length; }
+    int32_t GetEdgeCorridor(uint32_t Edge) const { return int32_t(EdgeCorridors[Edge] >> 1); }
+
+    // Reversed edges walk their corridor from NodeB to NodeA
+    bool IsEdgeReversed(uint32_t Edge) const { return EdgeCorridors[Edge] & 1; }
+
+    const FMazeCorridor& GetCorridor(int32_t Corridor) const { return Corridors[Corridor]; }
+
+    // Interior cell Index (0 based, from NodeA) of a corridor
+    FMazeCell GetCorridorCell(int32_t Corridor, uint32_t Index) const;
+
+    // O(1); invalid for walls and cells outside the grid
+    FMazeGraphPosition GetPosition(int32_t X, int32_t Y) const;
+
+    size_t GetAllocatedBytes() const;
+
+private:
+    // Per grid cell: node index, or NodeBit clear and the index into CorridorCellX/Y
+    static constexpr uint32_t NoPosition = ~uint32_t(0);
+    static constexpr uint32_t NodeBit = uint32_t(1) << 31;
+
+    int32_t AddNode(const FMazeBitGrid& Grid, int32_t X, int32_t Y, EMazeTileType Type);
+
+    // Follow the corridor leaving Node through its open side Direction, unless it was already traced from its other end
+    void TraceCorridor(const FMazeBitGrid& Grid, int32_t Node, int32_t Direction);
+
+    int32_t Width = 0;
+    int32_t Height = 0;
+    int64_t NumPathCells = 0;
+
+    std::vector<int32_t> NodeX;
+    std::vector<int32_t> NodeY;
+    std::vector<EMazeTileType> NodeTypes;
+    std::vector<uint8_t> NodeExits;
+
+    std::vector<uint32_t> EdgeOffsets;
+    std::vector<int32_t> EdgeTargets;
+    // Corridor index << 1 | reversed
+    std::vector<uint32_t> EdgeCorridors;
+
+    std::vector<FMazeCorridor> Corridors;
+    std::vector<int32_t> CorridorCellX;
+    std::vector<int32_t> CorridorCellY;
+    std::vector<int32_t> CorridorOfCell;
+
+    std::vector<uint32_t> CellPositions;
+};
+
+// Path queries against a corridor graph. Holds the per-query scratch (stamped, so nothing is cleared between
+// queries); use one pathfinder per thread over a shared graph.
+class FMazeCorridorPathfinder
+{
+public:
+    explicit FMazeCorridorPathfinder(const FMazeCorridorGraph& InGraph) : Graph(InGraph) {}
+
+    // A* with the Manhattan distance as heuristic. Returns the number of steps, or ~0u if To cannot be reached.
+    // OutPath, when given, receives every cell from From to To inclusive.
+    uint32_t FindPath(FMazeCell From, FMazeCell To, std::vector<FMazeCell>* OutPath = nullptr);
+
+    // Dijkstra from one cell to every node, ~0u for unreachable nodes
+    void ComputeNodeDistances(FMazeCell From, std::vector<uint32_t>& OutDistances);
+
+private:
+    struct FQueueEntry
+    {
+        uint32_t Priority;
+        uint32_t Cost;
+        int32_t Node;
+
+        bool operator<(const FQueueEntry& Other) const { return Priority > Other.Priority; }
+    };
+
+    // Start markers in ParentEdges
+    static constexpr int32_t StartNode = -1;
+    static constexpr int32_t StartViaNodeA = -2;
+    static constexpr int32_t StartViaNodeB = -3;
+
+    // Resets the scratch for a new query and seeds it with the ends of Start's corridor (or Start's node).
+    // Target == nullptr runs without a heuristic.
+    void BeginSearch(const FMazeGraphPosition& Start, const FMazeCell* Target);
+    void Relax(int32_t Node, uint32_t Cost, int32_t ParentEdge);
+    uint32_t GetCost(int32_t Node) const { return Stamps[Node] == Stamp ? Costs[Node] : ~uint32_t(0); }
+    uint32_t GetHeuristic(int32_t Node) const;
+
+    // Appends the cells of corridor Corridor strictly between offsets From and To (either direction)
+    void AppendCorridorCells(int32_t Corridor, int32_t FromOffset, int32_t ToOffset, std::vector<FMazeCell>& OutPath) const;
+
+    const FMazeCorridorGraph& Graph;
+
+    uint32_t Stamp = 0;
+    std::vector<uint32_t> Stamps;
+    std::vector<uint32_t> Costs;
+    // Edge used to reach each node, or one of the start markers
+    std::vector<int32_t> ParentEdges;
+    std::vector<FQueueEntry> Queue;
+
+    bool bUseHeuristic = false;
+    FMazeCell HeuristicTarget;
+};
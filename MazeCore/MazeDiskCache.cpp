@@ -0,0 +1,202 @@
+#include "MazeDiskCache.h"
+#include "MazeBakedMaze.h"
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr const char* EntryExtension = ".maze";
+    constexpr const char* TempExtension = ".tmp";
+
+    // A store's temp file older than this belongs to a process that died before renaming it
+    constexpr std::chrono::minutes StaleTempAge(10);
+
+    unsigned long GetProcessTag()
+    {
+#if defined(_WIN32)
+        return ::GetCurrentProcessId();
+#else
+        return (unsigned long)::getpid();
+#endif
+    }
+}
+
+uint64_t FMazeCacheKey::GetHash() const
+{
+    // Field by field, so padding never reaches the hash
+    const uint32_t Fields[] = {
+        MazeCacheGeneratorVersion, GeneratorId, uint32_t(Params.MazeSize), uint32_t(Params.StartSize), uint32_t(Params.NumExits),
+        uint32_t(Params.NorthSeed), uint32_t(Params.SouthSeed), uint32_t(Params.EastSeed), uint32_t(Params.WestSeed),
+    };
+    return HashMazeBytes(Fields, sizeof(Fields), 0);
+}
+
+FMazeDiskCache::FMazeDiskCache(std::string InDirectory, uint64_t InMaxBytes, FMazeThreadPool& InPool)
+    : Shared(std::make_shared<FShared>()), Pool(InPool)
+{
+    Shared->Directory = std::move(InDirectory);
+    Shared->MaxBytes = InMaxBytes;
+
+    std::error_code Error;
+    std::filesystem::create_directories(Shared->Directory, Error);
+}
+
+std::string FMazeDiskCache::GetPath(const FMazeCacheKey& Key) const
+{
+    char Name[32];
+    std::snprintf(Name, sizeof(Name), "%016llx", (unsigned long long)Key.GetHash());
+    return (std::filesystem::path(Shared->Directory) / (std::string(Name) + EntryExtension)).string();
+}
+
+bool FMazeDiskCache::TryLoad(const FMazeCacheKey& Key, FMazeBitGrid& OutGrid) const
+{
+    MAZE_TRACE_SCOPE("MazeDiskCache.TryLoad");
+    const std::string Path = GetPath(Key);
+    FMazeBakedMaze Baked;
+    if (!Baked.Open(Path))
+    {
+        return false;
+    }
+
+    // A 64-bit name collision is unlikely, but a wrong maze would be worse than a miss: every field of the key
+    // has to match, not just the ones the hash happened to agree on
+    const FMazeParams Stored = Baked.GetParams();
+    const FMazeParams& Wanted = Key.Params;
+    if (Stored.MazeSize != Wanted.MazeSize || Stored.StartSize != Wanted.StartSize || Stored.NumExits != Wanted.NumExits
+        || Stored.NorthSeed != Wanted.NorthSeed || Stored.SouthSeed != Wanted.SouthSeed || Stored.EastSeed != Wanted.EastSeed
+        || Stored.WestSeed != Wanted.WestSeed || Baked.GetGeneratorId() != Key.GeneratorId || Baked.GetGeneratorVersion() != MazeCacheGeneratorVersion)
+    {
+        return false;
+    }
+
+    OutGrid.InitFromWalls(Baked.GetWalls());
+
+    // Refresh the entry's age for eviction; failure only makes it look older
+    std::error_code Error;
+    std::filesystem::last_write_time(Path, std::filesystem::file_time_type::clock::now(), Error);
+    return true;
+}
+
+void FMazeDiskCache::StoreAsync(const FMazeCacheKey& Key, std::shared_ptr<const FMazeBitGrid> Grid, const FMazeRect& StartRoom)
+{
+    {
+        std::lock_guard<std::mutex> Lock(Shared->Mutex);
+        ++Shared->NumPendingStores;
+    }
+
+    Pool.Submit([Shared = Shared, Path = GetPath(Key), Params = Key.Params, GeneratorId = Key.GeneratorId, Grid = std::move(Grid), StartRoom]()
+    {
+        MAZE_TRACE_SCOPE("MazeDiskCache.Store");
+
+        // Unique per process, thread and store, so processes sharing the directory never write the same temp
+        // file; renamed over the entry only once complete
+        const uint64_t TempId = Shared->NextTempId.fetch_add(1);
+        const size_t ThreadTag = std::hash<std::thread::id>()(std::this_thread::get_id());
+        char Suffix[96];
+        std::snprintf(Suffix, sizeof(Suffix), ".%lx.%zx.%llu%s", GetProcessTag(), ThreadTag, (unsigned long long)TempId, TempExtension);
+        const std::string TempPath = Path + Suffix;
+
+        FMazeBakeOptions Options;
+        Options.GeneratorId = GeneratorId;
+        Options.GeneratorVersion = MazeCacheGeneratorVersion;
+
+        std::error_code Error;
+        if (WriteMazeBakedFile(TempPath, Params, StartRoom, *Grid, Options))
+        {
+            std::filesystem::rename(TempPath, Path, Error);
+        }
+        if (Error || !std::filesystem::exists(Path, Error))
+        {
+            std::filesystem::remove(TempPath, Error);
+        }
+        Shared->Evict();
+
+        std::lock_guard<std::mutex> Lock(Shared->Mutex);
+        --Shared->NumPendingStores;
+        Shared->StoresChanged.notify_all();
+    });
+}
+
+void FMazeDiskCache::Flush()
+{
+    std::unique_lock<std::mutex> Lock(Shared->Mutex);
+    Shared->StoresChanged.wait(Lock, [this]() { return Shared->NumPendingStores == 0; });
+}
+
+void FMazeDiskCache::FShared::Evict()
+{
+    struct FEntry
+    {
+        std::filesystem::path Path;
+        std::filesystem::file_time_type Time;
+        uint64_t Bytes;
+    };
+
+    std::vector<FEntry> Entries;
+    uint64_t TotalBytes = 0;
+    const std::filesystem::file_time_type StaleBefore = std::filesystem::file_time_type::clock::now() - StaleTempAge;
+    std::error_code Error;
+    for (std::filesystem::directory_iterator It(Directory, Error), End; !Error && It != End; It.increment(Error))
+    {
+        // Entries, and the temp files of stores ("<entry>.maze.<tag>.<id>.tmp") that take up the same disk
+        const std::filesystem::path& Path = It->path();
+        const bool bTemp = Path.extension() == TempExtension && Path.stem().string().find(std::string(EntryExtension) + ".") != std::string::npos;
+        if (!bTemp && Path.extension() != EntryExtension)
+        {
+            continue;
+        }
+        std::error_code EntryError;
+        const uint64_t Bytes = It->file_size(EntryError);
+        const std::filesystem::file_time_type Time = It->last_write_time(EntryError);
+        if (EntryError)
+        {
+            continue;
+        }
+        if (!bTemp)
+        {
+            Entries.push_back(FEntry{ Path, Time, Bytes });
+            TotalBytes += Bytes;
+        }
+        else if (Time >= StaleBefore || !std::filesystem::remove(Path, EntryError))
+        {
+            // A store still being written, or a stale one that would not go: it only counts against the budget
+            TotalBytes += Bytes;
+        }
+    }
+    if (TotalBytes <= MaxBytes)
+    {
+        return;
+    }
+
+    // Oldest first. Entries another process still has mapped may refuse to go, the next pass retries them.
+    std::sort(Entries.begin(), Entries.end(), [](const FEntry& A, const FEntry& B) { return A.Time < B.Time; });
+    for (const FEntry& Entry : Entries)
+    {
+        if (TotalBytes <= MaxBytes)
+        {
+            break;
+        }
+        std::error_code RemoveError;
+        if (std::filesystem::remove(Entry.Path, RemoveError))
+        {
+            TotalBytes -= Entry.Bytes;
+        }
+    }
+}
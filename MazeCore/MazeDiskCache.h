@@ -0,0 +1,72 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTypes.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class FMazeThreadPool;
+
+// Bump whenever a generator's output for the same parameters changes, so stale entries stop matching
+constexpr uint32_t MazeCacheGeneratorVersion = 2;
+
+// Everything that decides the generated walls. GeneratorId tells the generation paths apart (the actor uses its
+// carver mode), since each of them lays out a different maze for the same seeds.
+struct FMazeCacheKey
+{
+    FMazeParams Params;
+    uint32_t GeneratorId = 0;
+
+    uint64_t GetHash() const;
+};
+
+// Content-addressed cache of generated mazes on local disk, one baked maze file per key named after its hash.
+// Lookups map the file and copy the walls out; stores are written on the pool and renamed into place, so readers
+// never see half a file. Once the directory holds more than MaxBytes, the least recently used entries
+// (by file modification time, refreshed on every hit) are deleted; temp files count towards the budget and are
+// deleted once they are old enough that their store must have died. Several processes may share one directory.
+class FMazeDiskCache
+{
+public:
+    FMazeDiskCache(std::string InDirectory, uint64_t InMaxBytes, FMazeThreadPool& InPool);
+
+    // Does not wait for pending stores, they finish on the pool
+    ~FMazeDiskCache() = default;
+
+    FMazeDiskCache(const FMazeDiskCache&) = delete;
+    FMazeDiskCache& operator=(const FMazeDiskCache&) = delete;
+
+    // True and OutGrid filled when a valid entry for Key exists
+    bool TryLoad(const FMazeCacheKey& Key, FMazeBitGrid& OutGrid) const;
+
+    // Queues the write of Grid under Key and the eviction pass after it
+    void StoreAsync(const FMazeCacheKey& Key, std::shared_ptr<const FMazeBitGrid> Grid, const FMazeRect& StartRoom);
+
+    // Blocks until every queued store has finished
+    void Flush();
+
+    std::string GetPath(const FMazeCacheKey& Key) const;
+
+private:
+    // Outlives the cache while store tasks hold it
+    struct FShared
+    {
+        std::string Directory;
+        uint64_t MaxBytes = 0;
+        std::atomic<uint64_t> NextTempId{ 0 };
+
+        std::mutex Mutex;
+        std::condition_variable StoresChanged;
+        int32_t NumPendingStores = 0;
+
+        void Evict();
+    };
+
+    std::shared_ptr<FShared> Shared;
+    FMazeThreadPool& Pool;
+};
@@ -0,0 +1,326 @@
+#include "MazeEllerGenerator.h"
+#include "MazeRandom.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace
+{
+    // Probability test with 24 bits of precision
+    bool Chance(FMazeSplitMix64& Rng, float Probability)
+    {
+        return (Rng.Next() >> 40) < uint64_t(Probability * float(1 << 24));
+    }
+
+    // Floyd's sampling: Count distinct values in [0, Range) using O(Count) memory
+    std::vector<int32_t> SampleDistinct(FMazeSplitMix64& Rng, int32_t Range, int32_t Count)
+    {
+        std::vector<int32_t> Samples;
+        Count = std::min(std::max(Count, 0), Range);
+        for (int32_t j = Range - Count; j < Range; ++j)
+        {
+            const int32_t t = int32_t(Rng.NextBelow(uint32_t(j + 1)));
+            Samples.push_back(std::find(Samples.begin(), Samples.end(), t) == Samples.end() ? t : j);
+        }
+        return Samples;
+    }
+
+    bool ContainsSorted(const std::vector<int32_t>& Values, int32_t Value)
+    {
+        return std::binary_search(Values.begin(), Values.end(), Value);
+    }
+}
+
+FMazePbmRowSink::~FMazePbmRowSink()
+{
+    EndMaze();
+}
+
+void FMazePbmRowSink::BeginMaze(int32_t Width, int32_t Height)
+{
+    File = std::fopen(Path.c_str(), "wb");
+    bOk = File != nullptr && std::fprintf(File, "P4\n%d %d\n", Width, Height) > 0;
+    RowWidth = Width;
+    RowBytes.resize((size_t(Width) + 7) / 8);
+}
+
+void FMazePbmRowSink::WriteRow(int32_t /*Y*/, const uint64_t* WallBits)
+{
+    if (!File)
+    {
+        return;
+    }
+
+    // PBM packs the first pixel into the most significant bit of each byte
+    for (size_t b = 0; b < RowBytes.size(); ++b)
+    {
+        uint8_t Byte = uint8_t(WallBits[b / 8] >> ((b % 8) * 8));
+        Byte = uint8_t((Byte * 0x0202020202ull & 0x010884422010ull) % 1023);
+        RowBytes[b] = Byte;
+    }
+    bOk = bOk && std::fwrite(RowBytes.data(), 1, RowBytes.size(), File) == RowBytes.size();
+}
+
+void FMazePbmRowSink::EndMaze()
+{
+    if (File)
+    {
+        bOk = std::fclose(File) == 0 && bOk;
+        File = nullptr;
+    }
+}
+
+void FMazeGridRowSink::BeginMaze(int32_t Width, int32_t Height)
+{
+    Grid.Init(Width, Height);
+    RowWidth = Width;
+}
+
+void FMazeGridRowSink::WriteRow(int32_t Y, const uint64_t* WallBits)
+{
+    for (int32_t w = 0; w * 64 < RowWidth; ++w)
+    {
+        uint64_t Open = ~WallBits[w];
+        if (RowWidth - w * 64 < 64)
+        {
+            Open &= (uint64_t(1) << (RowWidth - w * 64)) - 1;
+        }
+        while (Open)
+        {
+            Grid.ClearWall(w * 64 + std::countr_zero(Open), Y);
+            Open &= Open - 1;
+        }
+    }
+}
+
+void FMazeEllerGenerator::Generate(const FMazeParams& Params, int32_t Height, const FMazeEllerSettings& Settings, IMazeRowSink& Sink)
+{
+    MAZE_TRACE_SCOPE("MazeEller.Generate");
+    const int32_t W = std::max(Params.MazeSize, 0);
+    const int32_t H = Height > 0 ? Height : W;
+    Sink.BeginMaze(W, H);
+
+    const int32_t LW = GetLatticeSize(W);
+    const int32_t LH = GetLatticeSize(H);
+    std::vector<uint64_t> Row((size_t(W) + 63) / 64);
+
+    auto SetRowWalls = [&Row]() { std::fill(Row.begin(), Row.end(), ~uint64_t(0)); };
+    auto ClearCell = [&Row](int32_t X) { Row[X >> 6] &= ~(uint64_t(1) << (X & 63)); };
+
+    // Start room in the middle of the (possibly very tall) maze
+    const FMazeRect Room = AlignRoomToLattice(FMazeRect{ W / 2 - Params.StartSize / 2, H / 2 - Params.StartSize / 2, Params.StartSize, Params.StartSize }, W, H);
+    const bool bHasRoom = !Room.IsEmpty();
+    const int32_t RoomI0 = (Room.X - 1) / 2;
+    const int32_t RoomI1 = (Room.X + Room.Width - 2) / 2;
+    const int32_t RoomJ0 = (Room.Y - 1) / 2;
+    const int32_t RoomJ1 = (Room.Y + Room.Height - 2) / 2;
+
+    auto EmitRow = [&](int32_t Y)
+    {
+        if (bHasRoom && Y >= Room.Y && Y < Room.Y + Room.Height)
+        {
+            for (int32_t x = Room.X; x < Room.X + Room.Width; ++x)
+            {
+                ClearCell(x);
+            }
+        }
+        Sink.WriteRow(Y, Row.data());
+    };
+
+    // Pick the exits up front: top and bottom by lattice column, left and right by lattice row
+    const uint64_t Seed = Params.GetCombinedSeed();
+    FMazeSplitMix64 ExitRng(MixMazeSeed(Seed, ~uint64_t(0)));
+    std::vector<int32_t> TopExits, LeftExits, BottomExits, RightExits;
+    for (int32_t Exit : SampleDistinct(ExitRng, 2 * LW + 2 * LH, Params.NumExits))
+    {
+        if (Exit < LW)
+        {
+            TopExits.push_back(Exit);
+        }
+        else if (Exit < LW + LH)
+        {
+            LeftExits.push_back(Exit - LW);
+        }
+        else if (Exit < 2 * LW + LH)
+        {
+            BottomExits.push_back(Exit - LW - LH);
+        }
+        else
+        {
+            RightExits.push_back(Exit - 2 * LW - LH);
+        }
+    }
+    std::sort(LeftExits.begin(), LeftExits.end());
+    std::sort(RightExits.begin(), RightExits.end());
+
+    if (H > 0)
+    {
+        SetRowWalls();
+        for (int32_t i : TopExits)
+        {
+            ClearCell(2 * i + 1);
+        }
+        EmitRow(0);
+    }
+
+    // Set bookkeeping for the current lattice row, all indexed by column.
+    // A set's label is the first column of the row that belongs to it, so fresh cells can use their own column.
+    std::vector<uint32_t> Label(LW), Parent(LW), Count(LW), Chosen(LW);
+    std::vector<uint8_t> Down(LW), HasDown(LW), EnteredRoom(LW);
+    std::vector<int32_t> FirstColumn(LW);
+    for (int32_t i = 0; i < LW; ++i)
+    {
+        Label[i] = uint32_t(i);
+    }
+
+    auto Find = [&Parent](uint32_t Node)
+    {
+        while (Parent[Node] != Node)
+        {
+            Parent[Node] = Parent[Parent[Node]];
+            Node = Parent[Node];
+        }
+        return Node;
+    };
+    auto Union = [&Parent, &Find](uint32_t A, uint32_t B)
+    {
+        A = Find(A);
+        B = Find(B);
+        Parent[std::max(A, B)] = std::min(A, B);
+    };
+
+    FMazeSplitMix64 Rng(Seed);
+    for (int32_t j = 0; j < LH; ++j)
+    {
+        const bool bLastRow = j == LH - 1;
+        const bool bRoomRow = bHasRoom && j >= RoomJ0 && j <= RoomJ1;
+        auto IsRoomColumn = [&](int32_t i) { return i >= RoomI0 && i <= RoomI1; };
+
+        for (int32_t i = 0; i < LW; ++i)
+        {
+            Parent[i] = Label[i];
+        }
+
+        // The start room is a single set; the room overlay opens the cells inside it
+        if (bRoomRow)
+        {
+            for (int32_t i = RoomI0; i < RoomI1; ++i)
+            {
+                Union(uint32_t(i), uint32_t(i + 1));
+            }
+        }
+
+        // Horizontal passages, the last row joins everything that is still apart
+        SetRowWalls();
+        for (int32_t i = 0; i < LW; ++i)
+        {
+            ClearCell(2 * i + 1);
+        }
+        for (int32_t i = 0; i + 1 < LW; ++i)
+        {
+            if (bRoomRow && IsRoomColumn(i) && IsRoomColumn(i + 1))
+            {
+                continue;
+            }
+            if (Find(uint32_t(i)) != Find(uint32_t(i + 1)) && (bLastRow || Chance(Rng, Settings.JoinChance)))
+            {
+                Union(uint32_t(i), uint32_t(i + 1));
+                ClearCell(2 * i + 2);
+            }
+        }
+        if (ContainsSorted(LeftExits, j))
+        {
+            ClearCell(0);
+        }
+        if (ContainsSorted(RightExits, j))
+        {
+            for (int32_t x = 2 * LW; x < W; ++x)
+            {
+                ClearCell(x);
+            }
+        }
+        EmitRow(2 * j + 1);
+
+        if (bLastRow)
+        {
+            break;
+        }
+
+        // Vertical passages: every set continues down at least once. A set may enter the start room only
+        // once, since the room merges everything that enters it.
+        const bool bAboveRoom = bHasRoom && j + 1 == RoomJ0;
+        const bool bInsideRoom = bRoomRow && j < RoomJ1;
+        std::fill(Count.begin(), Count.end(), 0);
+        std::fill(HasDown.begin(), HasDown.end(), 0);
+        std::fill(EnteredRoom.begin(), EnteredRoom.end(), 0);
+
+        for (int32_t i = 0; i < LW; ++i)
+        {
+            const uint32_t Root = Find(uint32_t(i));
+            if (bInsideRoom && IsRoomColumn(i))
+            {
+                Down[i] = 1;
+            }
+            else if (bAboveRoom && IsRoomColumn(i))
+            {
+                Down[i] = !EnteredRoom[Root] && Chance(Rng, Settings.DownChance);
+                EnteredRoom[Root] |= Down[i];
+            }
+            else
+            {
+                Down[i] = Chance(Rng, Settings.DownChance);
+            }
+            HasDown[Root] |= Down[i];
+
+            // Reservoir sample one member per set in case none went down
+            if (Rng.NextBelow(++Count[Root]) == 0)
+            {
+                Chosen[Root] = uint32_t(i);
+            }
+        }
+
+        SetRowWalls();
+        std::fill(FirstColumn.begin(), FirstColumn.end(), -1);
+        for (int32_t i = 0; i < LW; ++i)
+        {
+            const uint32_t Root = Find(uint32_t(i));
+            if (!HasDown[Root])
+            {
+                Down[Chosen[Root]] = 1;
+                HasDown[Root] = 1;
+            }
+        }
+        for (int32_t i = 0; i < LW; ++i)
+        {
+            if (Down[i])
+            {
+                const uint32_t Root = Find(uint32_t(i));
+                if (FirstColumn[Root] < 0)
+                {
+                    FirstColumn[Root] = i;
+                }
+                Label[i] = uint32_t(FirstColumn[Root]);
+                ClearCell(2 * i + 1);
+            }
+            else
+            {
+                Label[i] = uint32_t(i);
+            }
+        }
+        EmitRow(2 * j + 2);
+    }
+
+    // Bottom perimeter, plus the extra wall row of an even height maze
+    for (int32_t y = std::max(2 * LH, 1); y < H; ++y)
+    {
+        SetRowWalls();
+        for (int32_t i : BottomExits)
+        {
+            ClearCell(2 * i + 1);
+        }
+        EmitRow(y);
+    }
+
+    Sink.EndMaze();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Receives a maze one grid row at a time, top to bottom.
+// Row bits are packed 64 cells per word, bit (X % 64) of word (X / 64) is cell X, 1 = wall.
+class IMazeRowSink
+{
+public:
+    virtual ~IMazeRowSink() = default;
+
+    virtual void BeginMaze(int32_t /*Width*/, int32_t /*Height*/) {}
+    virtual void WriteRow(int32_t Y, const uint64_t* WallBits) = 0;
+    virtual void EndMaze() {}
+};
+
+// Writes rows as a binary PBM (P4) image, walls are black
+class FMazePbmRowSink : public IMazeRowSink
+{
+public:
+    explicit FMazePbmRowSink(const std::string& InPath) : Path(InPath) {}
+    virtual ~FMazePbmRowSink() override;
+
+    bool IsOk() const { return bOk; }
+
+    virtual void BeginMaze(int32_t Width, int32_t Height) override;
+    virtual void WriteRow(int32_t Y, const uint64_t* WallBits) override;
+    virtual void EndMaze() override;
+
+private:
+    std::string Path;
+    FILE* File = nullptr;
+    int32_t RowWidth = 0;
+    std::vector<uint8_t> RowBytes;
+    bool bOk = true;
+};
+
+// Copies rows into a grid, for mazes that do fit in memory
+class FMazeGridRowSink : public IMazeRowSink
+{
+public:
+    explicit FMazeGridRowSink(FMazeBitGrid& InGrid) : Grid(InGrid) {}
+
+    virtual void BeginMaze(int32_t Width, int32_t Height) override;
+    virtual void WriteRow(int32_t Y, const uint64_t* WallBits) override;
+
+private:
+    FMazeBitGrid& Grid;
+    int32_t RowWidth = 0;
+};
+
+struct FMazeEllerSettings
+{
+    // Chance of joining two neighbouring cells that belong to different sets
+    float JoinChance = 0.5f;
+
+    // Chance of an extra passage down from a set that already has one
+    float DownChance = 0.5f;
+};
+
+// Eller's algorithm: builds a perfect maze row by row while keeping only O(width) state, so the
+// maze can be far taller than what fits in memory. Honours the central start room and NumExits.
+class FMazeEllerGenerator
+{
+public:
+    // Height <= 0 generates a square MazeSize x MazeSize maze
+    void Generate(const FMazeParams& Params, int32_t Height, const FMazeEllerSettings& Settings, IMazeRowSink& Sink);
+};
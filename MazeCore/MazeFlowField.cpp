@@ -0,0 +1,326 @@
+#include "MazeFlowField.h"
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    // Frontiers smaller than this are cheaper to expand on one thread than to hand out
+    constexpr size_t ParallelFrontier = 4096;
+    constexpr size_t CellsPerChunk = 1024;
+
+    // Bytes of packed directions per parallel block of the direction pass
+    constexpr size_t DirectionBytesPerBlock = 16384;
+
+    // Rows per task when reading precomputed distances
+    constexpr int32_t RowsPerBand = 64;
+
+    constexpr int32_t OffsetX[4] = { 0, 1, 0, -1 };
+    constexpr int32_t OffsetY[4] = { -1, 0, 1, 0 };
+
+    // Set bit Index, returns false if it was already set. Only parallel expansion pays for the atomics; there the
+    // early-out has to be an atomic load too, other workers set bits of the same word.
+    bool TryClaim(std::vector<uint64_t>& Bits, size_t Index, bool bAtomic)
+    {
+        const uint64_t Mask = uint64_t(1) << (Index % 64);
+        uint64_t& Word = Bits[Index / 64];
+        if (bAtomic)
+        {
+            std::atomic_ref<uint64_t> AtomicWord(Word);
+            if (AtomicWord.load(std::memory_order_relaxed) & Mask)
+            {
+                return false;
+            }
+            return (AtomicWord.fetch_or(Mask, std::memory_order_relaxed) & Mask) == 0;
+        }
+        if (Word & Mask)
+        {
+            return false;
+        }
+        Word |= Mask;
+        return true;
+    }
+}
+
+void FMazeFlowField::SetDistance(size_t Index, uint32_t Distance)
+{
+    if (bWideDistances)
+    {
+        Distances32[Index] = Distance;
+    }
+    else
+    {
+        Distances16[Index] = uint16_t(Distance);
+    }
+}
+
+void FMazeFlowField::ResetStorage(int32_t InWidth, int32_t InHeight)
+{
+    Width = InWidth;
+    Height = InHeight;
+    Stride = size_t(Width) + 2;
+    MaxDistance = 0;
+
+    const size_t NumCells = Stride * (size_t(Height) + 2);
+
+    // No path can be longer than the number of cells, so 16 bits are enough below 64K cells
+    bWideDistances = NumCells >= Unreachable16;
+    Distances16.clear();
+    Distances32.clear();
+    if (bWideDistances)
+    {
+        Distances32.assign(NumCells, Unreachable);
+    }
+    else
+    {
+        Distances16.assign(NumCells, Unreachable16);
+    }
+    Directions.assign((NumCells + 3) / 4, 0);
+}
+
+void FMazeFlowField::Build(const FMazeBitGrid& Grid, const std::vector<FMazeCell>& Sources, FMazeThreadPool* Pool)
+{
+    MAZE_TRACE_SCOPE("MazeFlowField.Build");
+    ResetStorage(Grid.GetWidth(), Grid.GetHeight());
+    if (Width == 0 || Height == 0)
+    {
+        return;
+    }
+    const size_t NumCells = NumStoredCells();
+
+    // Walls, the padding and claimed cells all share one bitset, so expanding a cell is a single test per neighbour
+    std::vector<uint64_t> Blocked((NumCells + 63) / 64, ~uint64_t(0));
+    for (int32_t y = 0; y < Height; ++y)
+    {
+        for (int32_t x = 0; x < Width; ++x)
+        {
+            if (!Grid.IsWall(x, y))
+            {
+                const size_t Index = GetIndex(x, y);
+                Blocked[Index / 64] &= ~(uint64_t(1) << (Index % 64));
+            }
+        }
+    }
+
+    std::vector<uint32_t> Frontier;
+    for (const FMazeCell& Source : Sources)
+    {
+        if (Source.X < 0 || Source.X >= Width || Source.Y < 0 || Source.Y >= Height)
+        {
+            continue;
+        }
+        const size_t Index = GetIndex(Source.X, Source.Y);
+        if (TryClaim(Blocked, Index, false))
+        {
+            SetDistance(Index, 0);
+            Frontier.push_back(uint32_t(Index));
+        }
+    }
+
+    const size_t Offsets[4] = { size_t(0) - Stride, 1, Stride, size_t(0) - 1 };
+
+    // Expand Cells into Out, claiming each open neighbour exactly once
+    auto Expand = [this, &Blocked, &Offsets](const uint32_t* Cells, size_t Num, uint32_t Distance, bool bAtomic, std::vector<uint32_t>& Out)
+    {
+        for (size_t i = 0; i < Num; ++i)
+        {
+            for (size_t Offset : Offsets)
+            {
+                const size_t Index = Cells[i] + Offset;
+                if (TryClaim(Blocked, Index, bAtomic))
+                {
+                    SetDistance(Index, Distance);
+                    Out.push_back(uint32_t(Index));
+                }
+            }
+        }
+    };
+
+    std::vector<uint32_t> Next;
+    std::vector<std::vector<uint32_t>> ChunkNext;
+    uint32_t Distance = 0;
+    while (!Frontier.empty())
+    {
+        ++Distance;
+        Next.clear();
+
+        if (Pool && Frontier.size() >= ParallelFrontier)
+        {
+            // Claims race between chunks, but a cell's distance is the same whoever wins it
+            const int32_t NumChunks = int32_t((Frontier.size() + CellsPerChunk - 1) / CellsPerChunk);
+            ChunkNext.resize(size_t(NumChunks));
+            Pool->ParallelFor(NumChunks, [&](int32_t Chunk)
+            {
+                const size_t Begin = size_t(Chunk) * CellsPerChunk;
+                const size_t End = std::min(Begin + CellsPerChunk, Frontier.size());
+                ChunkNext[Chunk].clear();
+                Expand(Frontier.data() + Begin, End - Begin, Distance, true, ChunkNext[Chunk]);
+            });
+            for (int32_t Chunk = 0; Chunk < NumChunks; ++Chunk)
+            {
+                Next.insert(Next.end(), ChunkNext[Chunk].begin(), ChunkNext[Chunk].end());
+            }
+        }
+        else
+        {
+            Expand(Frontier.data(), Frontier.size(), Distance, false, Next);
+        }
+
+        if (!Next.empty())
+        {
+            MaxDistance = Distance;
+        }
+        Frontier.swap(Next);
+    }
+
+    BuildDirections(Pool);
+}
+
+void FMazeFlowField::InitFromDistances(int32_t InWidth, int32_t InHeight, const std::function<void(int32_t, uint32_t*)>& ReadRow, FMazeThreadPool* Pool)
+{
+    MAZE_TRACE_SCOPE("MazeFlowField.InitFromDistances");
+    ResetStorage(InWidth, InHeight);
+    if (Width == 0 || Height == 0)
+    {
+        return;
+    }
+
+    const int32_t NumBands = (Height + RowsPerBand - 1) / RowsPerBand;
+    std::vector<uint32_t> BandMax(size_t(NumBands), 0);
+    auto ReadBand = [this, &ReadRow, &BandMax](int32_t Band)
+    {
+        std::vector<uint32_t> Row(Width);
+        const int32_t EndY = std::min(Height, (Band + 1) * RowsPerBand);
+        for (int32_t y = Band * RowsPerBand; y < EndY; ++y)
+        {
+            ReadRow(y, Row.data());
+            for (int32_t x = 0; x < Width; ++x)
+            {
+                if (Row[x] != Unreachable)
+                {
+                    SetDistance(GetIndex(x, y), Row[x]);
+                    BandMax[Band] = std::max(BandMax[Band], Row[x]);
+                }
+            }
+        }
+    };
+    if (Pool && NumBands > 1)
+    {
+        Pool->ParallelFor(NumBands, ReadBand);
+    }
+    else
+    {
+        for (int32_t Band = 0; Band < NumBands; ++Band)
+        {
+            ReadBand(Band);
+        }
+    }
+    MaxDistance = *std::max_element(BandMax.begin(), BandMax.end());
+
+    BuildDirections(Pool);
+}
+
+void FMazeFlowField::BuildDirections(FMazeThreadPool* Pool)
+{
+    const size_t Offsets[4] = { size_t(0) - Stride, 1, Stride, size_t(0) - 1 };
+
+    // Directions are derived from the finished distances rather than from whoever claimed a cell,
+    // which keeps them deterministic: the first neighbour in N, E, S, W order that is one step closer.
+    auto PackBlock = [this, &Offsets](size_t Byte0, size_t Byte1)
+    {
+        for (size_t Byte = Byte0; Byte < Byte1; ++Byte)
+        {
+            uint8_t Packed = 0;
+            for (size_t Sub = 0; Sub < 4; ++Sub)
+            {
+                const size_t Index = Byte * 4 + Sub;
+                const uint32_t Here = Index < NumStoredCells() ? GetStoredDistance(Index) : Unreachable;
+                if (Here == 0 || Here == Unreachable)
+                {
+                    continue;
+                }
+                // Reachable cells are never on the padding, so every neighbour index is in range
+                for (uint8_t d = 0; d < 4; ++d)
+                {
+                    if (GetStoredDistance(Index + Offsets[d]) == Here - 1)
+                    {
+                        Packed |= uint8_t(d << (Sub * 2));
+                        break;
+                    }
+                }
+            }
+            Directions[Byte] = Packed;
+        }
+    };
+
+    const size_t NumBlocks = (Directions.size() + DirectionBytesPerBlock - 1) / DirectionBytesPerBlock;
+    auto PackBlockIndex = [&](int32_t Block)
+    {
+        const size_t Byte0 = size_t(Block) * DirectionBytesPerBlock;
+        PackBlock(Byte0, std::min(Byte0 + DirectionBytesPerBlock, Directions.size()));
+    };
+    if (Pool && NumBlocks > 1)
+    {
+        Pool->ParallelFor(int32_t(NumBlocks), PackBlockIndex);
+    }
+    else
+    {
+        for (size_t Block = 0; Block < NumBlocks; ++Block)
+        {
+            PackBlockIndex(int32_t(Block));
+        }
+    }
+}
+
+FMazeCell FMazeFlowField::GetNextStep(int32_t X, int32_t Y) const
+{
+    const uint32_t Distance = GetDistance(X, Y);
+    if (Distance == 0 || Distance == Unreachable)
+    {
+        return FMazeCell{ X, Y };
+    }
+    const int32_t d = int32_t(GetDirection(X, Y));
+    return FMazeCell{ X + OffsetX[d], Y + OffsetY[d] };
+}
+
+std::vector<FMazeCell> GetMazeRoomCells(const FMazeBitGrid& Grid, const FMazeRect& Room)
+{
+    std::vector<FMazeCell> Cells;
+    const int32_t X0 = std::max(Room.X, 0);
+    const int32_t Y0 = std::max(Room.Y, 0);
+    const int32_t X1 = std::min(Room.X + Room.Width, Grid.GetWidth());
+    const int32_t Y1 = std::min(Room.Y + Room.Height, Grid.GetHeight());
+    for (int32_t y = Y0; y < Y1; ++y)
+    {
+        for (int32_t x = X0; x < X1; ++x)
+        {
+            if (!Grid.IsWall(x, y))
+            {
+                Cells.push_back(FMazeCell{ x, y });
+            }
+        }
+    }
+    return Cells;
+}
+
+std::vector<FMazeCell> GetMazeExitCells(const FMazeBitGrid& Grid)
+{
+    std::vector<FMazeCell> Cells;
+    const int32_t W = Grid.GetWidth();
+    const int32_t H = Grid.GetHeight();
+    for (int32_t y = 0; y < H; ++y)
+    {
+        // Interior rows only touch the perimeter in their first and last cell
+        const int32_t Step = (y == 0 || y == H - 1) ? 1 : std::max(W - 1, 1);
+        for (int32_t x = 0; x < W; x += Step)
+        {
+            if (!Grid.IsWall(x, y))
+            {
+                Cells.push_back(FMazeCell{ x, y });
+            }
+        }
+    }
+    return Cells;
+}
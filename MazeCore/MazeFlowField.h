@@ -0,0 +1,98 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class FMazeThreadPool;
+
+// Direction of the next step towards the nearest source, two bits per cell
+enum class EMazeFlowDirection : uint8_t
+{
+    North,  // Y - 1
+    East,   // X + 1
+    South,  // Y + 1
+    West    // X - 1
+};
+
+// Breadth-first distance and next step from every open cell to the nearest of a set of source cells.
+// Distances are stored in 16 bits when the maze is small enough and 32 bits otherwise; directions are packed
+// four cells per byte. Every lookup is O(1), so agents can follow the field instead of searching.
+class FMazeFlowField
+{
+public:
+    static constexpr uint32_t Unreachable = ~uint32_t(0);
+
+    // Breadth-first search from Sources over the open cells of Grid. Large frontiers are expanded in parallel
+    // with atomic claims on a visited bitset; the result does not depend on scheduling.
+    void Build(const FMazeBitGrid& Grid, const std::vector<FMazeCell>& Sources, FMazeThreadPool* Pool = nullptr);
+
+    // Field from distances worked out before, such as the exit distances of a baked maze, without a search.
+    // ReadRow(Y, OutRow) fills the Width distances of row Y, Unreachable for walls; bands of rows are read on Pool.
+    void InitFromDistances(int32_t InWidth, int32_t InHeight, const std::function<void(int32_t, uint32_t*)>& ReadRow, FMazeThreadPool* Pool = nullptr);
+
+    int32_t GetWidth() const { return Width; }
+    int32_t GetHeight() const { return Height; }
+    bool IsEmpty() const { return Width == 0 || Height == 0; }
+
+    // Steps to the nearest source, Unreachable for walls and cut-off cells
+    uint32_t GetDistance(int32_t X, int32_t Y) const { return GetStoredDistance(GetIndex(X, Y)); }
+
+    bool IsReachable(int32_t X, int32_t Y) const { return GetDistance(X, Y) != Unreachable; }
+
+    // Only meaningful for reachable cells that are not sources themselves
+    EMazeFlowDirection GetDirection(int32_t X, int32_t Y) const
+    {
+        const size_t Index = GetIndex(X, Y);
+        return EMazeFlowDirection((Directions[Index / 4] >> ((Index % 4) * 2)) & 3);
+    }
+
+    // Neighbour to move to, or the cell itself for sources and unreachable cells
+    FMazeCell GetNextStep(int32_t X, int32_t Y) const;
+
+    // Largest finite distance
+    uint32_t GetMaxDistance() const { return MaxDistance; }
+
+    size_t GetAllocatedBytes() const { return Distances16.capacity() * sizeof(uint16_t) + Distances32.capacity() * sizeof(uint32_t) + Directions.capacity(); }
+
+private:
+    static constexpr uint16_t Unreachable16 = 0xFFFF;
+
+    // Storage is padded by one unreachable cell on every side, so neighbours never need a bounds check
+    size_t GetIndex(int32_t X, int32_t Y) const { return size_t(Y + 1) * Stride + size_t(X + 1); }
+    size_t NumStoredCells() const { return bWideDistances ? Distances32.size() : Distances16.size(); }
+    uint32_t GetStoredDistance(size_t Index) const
+    {
+        if (bWideDistances)
+        {
+            return Distances32[Index];
+        }
+        return Distances16[Index] == Unreachable16 ? Unreachable : Distances16[Index];
+    }
+    void SetDistance(size_t Index, uint32_t Distance);
+
+    // Everything unreachable, sized for InWidth x InHeight
+    void ResetStorage(int32_t InWidth, int32_t InHeight);
+
+    // Packs the direction of every cell from the finished distances
+    void BuildDirections(FMazeThreadPool* Pool);
+
+    int32_t Width = 0;
+    int32_t Height = 0;
+    size_t Stride = 0;
+    bool bWideDistances = false;
+    uint32_t MaxDistance = 0;
+
+    std::vector<uint16_t> Distances16;
+    std::vector<uint32_t> Distances32;
+    std::vector<uint8_t> Directions;
+};
+
+// Open cells of the start room, the usual source for a "towards the centre" field
+std::vector<FMazeCell> GetMazeRoomCells(const FMazeBitGrid& Grid, const FMazeRect& Room);
+
+// Open perimeter cells, i.e. the exits
+std::vector<FMazeCell> GetMazeExitCells(const FMazeBitGrid& Grid);
@@ -0,0 +1,564 @@
+#include "MazeInstanceBuilder.h"
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <bit>
+#include <numeric>
+
+namespace
+{
+    // Rows handed to one task; small enough to balance, big enough to amortise the dispatch
+    constexpr int32_t RowsPerBand = 64;
+
+    // Merging bands are taller since rectangles are cut at band edges
+    constexpr int32_t MergeRowsPerBand = 256;
+
+    bool IsWallBit(const uint64_t* Row, int32_t X)
+    {
+        const uint32_t Bit = uint32_t(X + FMazeBitGrid::GuardCells);
+        return (Row[Bit / FMazeBitGrid::BitsPerWord] >> (Bit % FMazeBitGrid::BitsPerWord)) & 1;
+    }
+
+    // Horizontal span of a row that is still open while the rows below repeat it
+    struct FOpenSpan
+    {
+        int32_t X0;
+        int32_t X1;
+        int32_t Y0;
+    };
+
+    // Greedy merge of the cells [X0, X1) x [Y0, Y1); nothing crosses the block edges so blocks can run in parallel
+    void MergeWallBlock(const FMazeWallPlane& Grid, int32_t X0, int32_t X1, int32_t Y0, int32_t Y1, std::vector<FMazeRect>& OutRects)
+    {
+        const int32_t Width = X1 - X0;
+        const size_t RowWords = (size_t(Width) + 63) / 64;
+
+        // Length of the vertical wall run through each cell, clamped; only compared against horizontal runs
+        std::vector<uint16_t> VerticalRun(size_t(Y1 - Y0) * Width);
+        for (int32_t y = Y0; y < Y1; ++y)
+        {
+            const uint64_t* Row = Grid.GetWallRow(y);
+            uint16_t* Run = &VerticalRun[size_t(y - Y0) * Width];
+            const uint16_t* Above = y > Y0 ? Run - Width : nullptr;
+            for (int32_t x = 0; x < Width; ++x)
+            {
+                Run[x] = IsWallBit(Row, X0 + x) ? uint16_t(Above ? std::min(Above[x] + 1, 0xFFFF) : 1) : 0;
+            }
+        }
+        for (int32_t y = Y1 - 2; y >= Y0; --y)
+        {
+            uint16_t* Run = &VerticalRun[size_t(y - Y0) * Width];
+            const uint16_t* Below = Run + Width;
+            for (int32_t x = 0; x < Width; ++x)
+            {
+                if (Run[x] && Below[x])
+                {
+                    Run[x] = Below[x];
+                }
+            }
+        }
+
+        std::vector<uint64_t> PrevVertical(RowWords, 0), CurVertical(RowWords, 0);
+        std::vector<int32_t> VerticalStart(Width, 0);
+        std::vector<FOpenSpan> OpenSpans, RowSpans;
+
+        auto CloseVertical = [&](int32_t Y)
+        {
+            for (size_t w = 0; w < RowWords; ++w)
+            {
+                uint64_t Closed = PrevVertical[w] & ~CurVertical[w];
+                while (Closed)
+                {
+                    const int32_t X = int32_t(w * 64) + std::countr_zero(Closed);
+                    OutRects.push_back(FMazeRect{ X0 + X, VerticalStart[X], 1, Y - VerticalStart[X] });
+                    Closed &= Closed - 1;
+                }
+            }
+        };
+
+        for (int32_t y = Y0; y < Y1; ++y)
+        {
+            const uint64_t* Row = Grid.GetWallRow(y);
+            const uint16_t* Run = &VerticalRun[size_t(y - Y0) * Width];
+            std::fill(CurVertical.begin(), CurVertical.end(), 0);
+            RowSpans.clear();
+
+            // Split every horizontal run into cells that prefer to go vertical and spans that stay horizontal
+            int32_t x = 0;
+            while (x < Width)
+            {
+                if (!IsWallBit(Row, X0 + x))
+                {
+                    ++x;
+                    continue;
+                }
+                int32_t RunEnd = x;
+                while (RunEnd < Width && IsWallBit(Row, X0 + RunEnd))
+                {
+                    ++RunEnd;
+                }
+
+                const int32_t Length = RunEnd - x;
+                int32_t SpanStart = -1;
+                for (int32_t i = x; i <= RunEnd; ++i)
+                {
+                    const bool bVertical = i < RunEnd && Run[i] > Length;
+                    if (bVertical)
+                    {
+                        CurVertical[size_t(i) / 64] |= uint64_t(1) << (i % 64);
+                    }
+                    if (i < RunEnd && !bVertical)
+                    {
+                        SpanStart = SpanStart < 0 ? i : SpanStart;
+                    }
+                    else if (SpanStart >= 0)
+                    {
+                        RowSpans.push_back(FOpenSpan{ SpanStart, i, y });
+                        SpanStart = -1;
+                    }
+                }
+                x = RunEnd;
+            }
+
+            // Vertical columns: open where they start, emit where they stop
+            CloseVertical(y);
+            for (size_t w = 0; w < RowWords; ++w)
+            {
+                uint64_t Started = CurVertical[w] & ~PrevVertical[w];
+                while (Started)
+                {
+                    VerticalStart[w * 64 + std::countr_zero(Started)] = y;
+                    Started &= Started - 1;
+                }
+            }
+            PrevVertical.swap(CurVertical);
+
+            // Horizontal spans: both lists are sorted by X0, a span repeating exactly keeps growing downwards
+            size_t Open = 0;
+            for (FOpenSpan& Span : RowSpans)
+            {
+                while (Open < OpenSpans.size() && OpenSpans[Open].X0 < Span.X0)
+                {
+                    const FOpenSpan& Done = OpenSpans[Open++];
+                    OutRects.push_back(FMazeRect{ X0 + Done.X0, Done.Y0, Done.X1 - Done.X0, y - Done.Y0 });
+                }
+                if (Open < OpenSpans.size() && OpenSpans[Open].X0 == Span.X0)
+                {
+                    const FOpenSpan& Done = OpenSpans[Open++];
+                    if (Done.X1 == Span.X1)
+                    {
+                        Span.Y0 = Done.Y0;
+                    }
+                    else
+                    {
+                        OutRects.push_back(FMazeRect{ X0 + Done.X0, Done.Y0, Done.X1 - Done.X0, y - Done.Y0 });
+                    }
+                }
+            }
+            for (; Open < OpenSpans.size(); ++Open)
+            {
+                const FOpenSpan& Done = OpenSpans[Open];
+                OutRects.push_back(FMazeRect{ X0 + Done.X0, Done.Y0, Done.X1 - Done.X0, y - Done.Y0 });
+            }
+            OpenSpans.swap(RowSpans);
+        }
+
+        std::fill(CurVertical.begin(), CurVertical.end(), 0);
+        CloseVertical(Y1);
+        for (const FOpenSpan& Done : OpenSpans)
+        {
+            OutRects.push_back(FMazeRect{ X0 + Done.X0, Done.Y0, Done.X1 - Done.X0, Y1 - Done.Y0 });
+        }
+    }
+
+    // Calls Emit(X, Y) for every wall cell of [X0, X1) x [Y0, Y1), row by row
+    template <typename TEmit>
+    void ForEachWallInBlock(const FMazeWallPlane& Grid, int32_t X0, int32_t X1, int32_t Y0, int32_t Y1, TEmit&& Emit)
+    {
+        const uint32_t FirstBit = FMazeBitGrid::GuardCells + uint32_t(X0);
+        const uint32_t LastBit = FMazeBitGrid::GuardCells + uint32_t(X1);
+        const uint32_t FirstWord = FirstBit / FMazeBitGrid::BitsPerWord;
+        const uint32_t EndWord = (LastBit + FMazeBitGrid::BitsPerWord - 1) / FMazeBitGrid::BitsPerWord;
+
+        for (int32_t y = Y0; y < Y1; ++y)
+        {
+            const uint64_t* Row = Grid.GetWallRow(y);
+            for (uint32_t w = FirstWord; w < EndWord; ++w)
+            {
+                uint64_t Bits = Row[w];
+                if (w == FirstWord)
+                {
+                    Bits &= ~uint64_t(0) << (FirstBit % FMazeBitGrid::BitsPerWord);
+                }
+                if (w == EndWord - 1 && LastBit % FMazeBitGrid::BitsPerWord != 0)
+                {
+                    Bits &= (uint64_t(1) << (LastBit % FMazeBitGrid::BitsPerWord)) - 1;
+                }
+
+                // One iteration per wall, skipping open cells a word at a time
+                const int32_t WordX = int32_t(w * FMazeBitGrid::BitsPerWord) - FMazeBitGrid::GuardCells;
+                while (Bits)
+                {
+                    Emit(WordX + std::countr_zero(Bits), y);
+                    Bits &= Bits - 1;
+                }
+            }
+        }
+    }
+
+    FMazeInstanceBox MakeWallBox(const FMazeRect& Rect, const FMazeInstanceLayout& Layout)
+    {
+        FMazeInstanceBox Box;
+        Box.Location.X = (float(Rect.X + Layout.OriginX) + 0.5f * float(Rect.Width - 1)) * Layout.Spacing;
+        Box.Location.Y = (float(Rect.Y + Layout.OriginY) + 0.5f * float(Rect.Height - 1)) * Layout.Spacing;
+        Box.Location.Z = Layout.Z;
+        Box.ScaleX = float(Rect.Width);
+        Box.ScaleY = float(Rect.Height);
+        return Box;
+    }
+
+    // Refills one chunk from the walls inside its cells
+    void BuildChunk(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, bool bMerge, FMazeInstanceChunk& Chunk)
+    {
+        const FMazeRect& Cells = Chunk.Cells;
+        Chunk.Boxes.clear();
+        Chunk.MinX = Chunk.MinY = 0.0f;
+        Chunk.MaxX = Chunk.MaxY = -1.0f;
+
+        int32_t MinX = Cells.X + Cells.Width;
+        int32_t MinY = Cells.Y + Cells.Height;
+        int32_t MaxX = Cells.X - 1;
+        int32_t MaxY = Cells.Y - 1;
+        auto AddRect = [&Layout, &Chunk, &MinX, &MinY, &MaxX, &MaxY](const FMazeRect& Rect)
+        {
+            Chunk.Boxes.push_back(MakeWallBox(Rect, Layout));
+            MinX = std::min(MinX, Rect.X);
+            MinY = std::min(MinY, Rect.Y);
+            MaxX = std::max(MaxX, Rect.X + Rect.Width - 1);
+            MaxY = std::max(MaxY, Rect.Y + Rect.Height - 1);
+        };
+
+        if (bMerge)
+        {
+            std::vector<FMazeRect> Rects;
+            MergeWallBlock(Grid, Cells.X, Cells.X + Cells.Width, Cells.Y, Cells.Y + Cells.Height, Rects);
+            Chunk.Boxes.reserve(Rects.size());
+            for (const FMazeRect& Rect : Rects)
+            {
+                AddRect(Rect);
+            }
+        }
+        else
+        {
+            ForEachWallInBlock(Grid, Cells.X, Cells.X + Cells.Width, Cells.Y, Cells.Y + Cells.Height, [&AddRect](int32_t X, int32_t Y)
+            {
+                AddRect(FMazeRect{ X, Y, 1, 1 });
+            });
+        }
+
+        // Every box is one cell per unit of scale, centred on its cells
+        if (!Chunk.Boxes.empty())
+        {
+            Chunk.MinX = (float(MinX + Layout.OriginX) - 0.5f) * Layout.Spacing;
+            Chunk.MinY = (float(MinY + Layout.OriginY) - 0.5f) * Layout.Spacing;
+            Chunk.MaxX = (float(MaxX + Layout.OriginX) + 0.5f) * Layout.Spacing;
+            Chunk.MaxY = (float(MaxY + Layout.OriginY) + 0.5f) * Layout.Spacing;
+        }
+    }
+
+    // Write the walls of rows [Y0, Y1) starting at Out, returns one past the last location written
+    FMazeInstanceLocation* EmitWallRows(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, int32_t Y0, int32_t Y1, FMazeInstanceLocation* Out)
+    {
+        ForEachWallInBlock(Grid, 0, Grid.GetWidth(), Y0, Y1, [&Layout, &Out](int32_t X, int32_t Y)
+        {
+            *Out++ = FMazeInstanceLocation{ float(X + Layout.OriginX) * Layout.Spacing, float(Y + Layout.OriginY) * Layout.Spacing, Layout.Z };
+        });
+        return Out;
+    }
+}
+
+void FMazeInstanceBuilder::BuildWallLocations(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, std::vector<FMazeInstanceLocation>& OutLocations) const
+{
+    MAZE_TRACE_SCOPE("MazeInstances.BuildWallLocations");
+    OutLocations.clear();
+    if (Grid.IsEmpty())
+    {
+        return;
+    }
+
+    const int32_t Height = Grid.GetHeight();
+    const int32_t NumBands = (Height + RowsPerBand - 1) / RowsPerBand;
+
+    // Count per band first so every band knows where its output starts and can be filled independently
+    std::vector<int64_t> BandOffsets(size_t(NumBands) + 1, 0);
+    auto CountBand = [&Grid, &BandOffsets, Height](int32_t Band)
+    {
+        int64_t Count = 0;
+        for (int32_t y = Band * RowsPerBand; y < std::min((Band + 1) * RowsPerBand, Height); ++y)
+        {
+            Count += Grid.CountWallsInRow(y);
+        }
+        BandOffsets[size_t(Band) + 1] = Count;
+    };
+    auto FillBand = [&Grid, &Layout, &BandOffsets, &OutLocations, Height](int32_t Band)
+    {
+        EmitWallRows(Grid, Layout, Band * RowsPerBand, std::min((Band + 1) * RowsPerBand, Height), OutLocations.data() + BandOffsets[Band]);
+    };
+
+    if (Pool && NumBands > 1)
+    {
+        Pool->ParallelFor(NumBands, CountBand);
+    }
+    else
+    {
+        for (int32_t Band = 0; Band < NumBands; ++Band)
+        {
+            CountBand(Band);
+        }
+    }
+
+    for (int32_t Band = 0; Band < NumBands; ++Band)
+    {
+        BandOffsets[size_t(Band) + 1] += BandOffsets[Band];
+    }
+    OutLocations.resize(size_t(BandOffsets[NumBands]));
+
+    if (Pool && NumBands > 1)
+    {
+        Pool->ParallelFor(NumBands, FillBand);
+    }
+    else
+    {
+        for (int32_t Band = 0; Band < NumBands; ++Band)
+        {
+            FillBand(Band);
+        }
+    }
+}
+
+void FMazeInstanceBuilder::BuildMergedWallRects(const FMazeWallPlane& Grid, std::vector<FMazeRect>& OutRects, FMazeWallMergeStats* OutStats) const
+{
+    OutRects.clear();
+    const int32_t Height = Grid.GetHeight();
+    const int32_t NumBands = Grid.IsEmpty() ? 0 : (Height + MergeRowsPerBand - 1) / MergeRowsPerBand;
+
+    std::vector<std::vector<FMazeRect>> BandRects(NumBands);
+    auto MergeBand = [&Grid, &BandRects, Height](int32_t Band)
+    {
+        MergeWallBlock(Grid, 0, Grid.GetWidth(), Band * MergeRowsPerBand, std::min((Band + 1) * MergeRowsPerBand, Height), BandRects[Band]);
+    };
+
+    if (Pool && NumBands > 1)
+    {
+        Pool->ParallelFor(NumBands, MergeBand);
+    }
+    else
+    {
+        for (int32_t Band = 0; Band < NumBands; ++Band)
+        {
+            MergeBand(Band);
+        }
+    }
+
+    for (const std::vector<FMazeRect>& Rects : BandRects)
+    {
+        OutRects.insert(OutRects.end(), Rects.begin(), Rects.end());
+    }
+
+    if (OutStats)
+    {
+        OutStats->WallCells = Grid.CountWalls();
+        OutStats->Instances = int64_t(OutRects.size());
+    }
+}
+
+void FMazeInstanceBuilder::BuildMergedWallBoxes(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, std::vector<FMazeInstanceBox>& OutBoxes, FMazeWallMergeStats* OutStats) const
+{
+    MAZE_TRACE_SCOPE("MazeInstances.BuildMergedWallBoxes");
+    std::vector<FMazeRect> Rects;
+    BuildMergedWallRects(Grid, Rects, OutStats);
+
+    OutBoxes.resize(Rects.size());
+    for (size_t i = 0; i < Rects.size(); ++i)
+    {
+        OutBoxes[i] = MakeWallBox(Rects[i], Layout);
+    }
+}
+
+void FMazeInstanceChunkGrid::Init(int32_t Width, int32_t Height, int32_t InChunkCells)
+{
+    ChunkCells = std::max(InChunkCells, 1);
+    NumChunksX = (Width + ChunkCells - 1) / ChunkCells;
+    NumChunksY = (Height + ChunkCells - 1) / ChunkCells;
+    Chunks.assign(size_t(NumChunksX) * NumChunksY, FMazeInstanceChunk());
+    for (int32_t CY = 0; CY < NumChunksY; ++CY)
+    {
+        for (int32_t CX = 0; CX < NumChunksX; ++CX)
+        {
+            const int32_t X = CX * ChunkCells;
+            const int32_t Y = CY * ChunkCells;
+            Chunks[size_t(CY) * NumChunksX + CX].Cells = FMazeRect{ X, Y, std::min(ChunkCells, Width - X), std::min(ChunkCells, Height - Y) };
+        }
+    }
+}
+
+void FMazeInstanceChunkGrid::GetOverlappingChunks(const FMazeRect& Rect, std::vector<int32_t>& OutIndices) const
+{
+    OutIndices.clear();
+    if (Rect.IsEmpty() || ChunkCells <= 0)
+    {
+        return;
+    }
+
+    const int32_t CX0 = std::max(Rect.X, 0) / ChunkCells;
+    const int32_t CY0 = std::max(Rect.Y, 0) / ChunkCells;
+    const int32_t CX1 = std::min((Rect.X + Rect.Width - 1) / ChunkCells, NumChunksX - 1);
+    const int32_t CY1 = std::min((Rect.Y + Rect.Height - 1) / ChunkCells, NumChunksY - 1);
+    for (int32_t CY = CY0; CY <= CY1; ++CY)
+    {
+        for (int32_t CX = CX0; CX <= CX1; ++CX)
+        {
+            OutIndices.push_back(CY * NumChunksX + CX);
+        }
+    }
+}
+
+void FMazeWallInstanceSet::Init(const FMazeWallPlane& Grid, const FMazeRect& InCells)
+{
+    Cells = InCells;
+    InstanceOf.assign(size_t(Cells.Width) * Cells.Height, -1);
+    InstanceCells.clear();
+    ForEachWallInBlock(Grid, Cells.X, Cells.X + Cells.Width, Cells.Y, Cells.Y + Cells.Height, [this](int32_t X, int32_t Y)
+    {
+        InstanceOf[size_t(Y - Cells.Y) * Cells.Width + (X - Cells.X)] = int32_t(InstanceCells.size());
+        InstanceCells.push_back(FMazeCell{ X, Y });
+    });
+}
+
+void FMazeWallInstanceSet::Reset()
+{
+    Cells = FMazeRect();
+    std::vector<int32_t>().swap(InstanceOf);
+    std::vector<FMazeCell>().swap(InstanceCells);
+}
+
+void FMazeWallInstanceSet::ApplyChange(const std::vector<FMazeCell>& Opened, const std::vector<FMazeCell>& Closed, FMazeInstanceEdits& OutEdits)
+{
+    OutEdits.Updates.clear();
+    OutEdits.Adds.clear();
+    OutEdits.NewNum = GetNum();
+
+    auto GetSlot = [this](const FMazeCell& Cell) -> int32_t*
+    {
+        return Cells.Contains(Cell.X, Cell.Y) ? &InstanceOf[size_t(Cell.Y - Cells.Y) * Cells.Width + (Cell.X - Cells.X)] : nullptr;
+    };
+
+    std::vector<int32_t> Freed;
+    for (const FMazeCell& Cell : Opened)
+    {
+        int32_t* Slot = GetSlot(Cell);
+        if (Slot && *Slot >= 0)
+        {
+            Freed.push_back(*Slot);
+            *Slot = -1;
+        }
+    }
+
+    // A new wall takes over a freed instance, or goes on the end once none is left
+    for (const FMazeCell& Cell : Closed)
+    {
+        int32_t* Slot = GetSlot(Cell);
+        if (!Slot || *Slot >= 0)
+        {
+            continue;
+        }
+        if (!Freed.empty())
+        {
+            *Slot = Freed.back();
+            Freed.pop_back();
+            InstanceCells[*Slot] = Cell;
+            OutEdits.Updates.push_back({ *Slot, Cell });
+        }
+        else
+        {
+            *Slot = GetNum();
+            InstanceCells.push_back(Cell);
+            OutEdits.Adds.push_back(Cell);
+        }
+    }
+    if (Freed.empty())
+    {
+        return;
+    }
+
+    // More walls went than came: the last instances move into the holes below the new count and the tail goes
+    const int32_t NewNum = GetNum() - int32_t(Freed.size());
+    std::sort(Freed.begin(), Freed.end());
+    size_t NextFreed = std::lower_bound(Freed.begin(), Freed.end(), NewNum) - Freed.begin();
+    size_t NextHole = 0;
+    for (int32_t Index = NewNum; Index < GetNum(); ++Index)
+    {
+        if (NextFreed < Freed.size() && Freed[NextFreed] == Index)
+        {
+            ++NextFreed;
+            continue;
+        }
+        const int32_t Hole = Freed[NextHole++];
+        const FMazeCell Cell = InstanceCells[Index];
+        InstanceCells[Hole] = Cell;
+        *GetSlot(Cell) = Hole;
+        OutEdits.Updates.push_back({ Hole, Cell });
+    }
+    InstanceCells.resize(NewNum);
+    OutEdits.NewNum = NewNum;
+}
+
+void FMazeInstanceBuilder::BuildWallChunks(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, int32_t ChunkCells, bool bMerge, FMazeInstanceChunkGrid& OutChunks, FMazeWallMergeStats* OutStats) const
+{
+    MAZE_TRACE_SCOPE("MazeInstances.BuildWallChunks");
+    OutChunks.Init(Grid.GetWidth(), Grid.GetHeight(), ChunkCells);
+    std::vector<int32_t> Indices(OutChunks.Chunks.size());
+    std::iota(Indices.begin(), Indices.end(), 0);
+    RebuildWallChunks(Grid, Layout, bMerge, Indices, OutChunks);
+
+    if (OutStats)
+    {
+        OutStats->WallCells = Grid.CountWalls();
+        OutStats->Instances = 0;
+        for (const FMazeInstanceChunk& Chunk : OutChunks.Chunks)
+        {
+            OutStats->Instances += int64_t(Chunk.Boxes.size());
+        }
+    }
+}
+
+void FMazeInstanceBuilder::RebuildWallChunks(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, bool bMerge, const std::vector<int32_t>& ChunkIndices, FMazeInstanceChunkGrid& InOutChunks) const
+{
+    auto Rebuild = [&Grid, &Layout, &ChunkIndices, &InOutChunks, bMerge](int32_t i)
+    {
+        BuildChunk(Grid, Layout, bMerge, InOutChunks.Chunks[ChunkIndices[i]]);
+    };
+
+    const int32_t NumChunks = int32_t(ChunkIndices.size());
+    if (Pool && NumChunks > 1)
+    {
+        Pool->ParallelFor(NumChunks, Rebuild);
+    }
+    else
+    {
+        for (int32_t i = 0; i < NumChunks; ++i)
+        {
+            Rebuild(i);
+        }
+    }
+}
+
+FMazeInstanceLayout FMazeInstanceBuilder::GetCenteredLayout(const FMazeWallPlane& Grid, float Spacing)
+{
+    FMazeInstanceLayout Layout;
+    Layout.Spacing = Spacing;
+    Layout.OriginX = -(Grid.GetWidth() / 2);
+    Layout.OriginY = -(Grid.GetHeight() / 2);
+    return Layout;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+class FMazeThreadPool;
+
+// Position of one wall instance, relative to the maze actor
+struct FMazeInstanceLocation
+{
+    float X = 0.0f;
+    float Y = 0.0f;
+    float Z = 0.0f;
+};
+
+// Maps cell (X, Y) to ((X + OriginX) * Spacing, (Y + OriginY) * Spacing, Z)
+struct FMazeInstanceLayout
+{
+    float Spacing = 100.0f;
+    int32_t OriginX = 0;
+    int32_t OriginY = 0;
+    float Z = 0.0f;
+};
+
+// Merged wall block: centre location and the number of cells it spans on each axis (used as the instance scale)
+struct FMazeInstanceBox
+{
+    FMazeInstanceLocation Location;
+    float ScaleX = 1.0f;
+    float ScaleY = 1.0f;
+};
+
+// Outcome of wall merging, Instances / WallCells is what is left of the per-cell instance count
+struct FMazeWallMergeStats
+{
+    int64_t WallCells = 0;
+    int64_t Instances = 0;
+
+    double GetReduction() const { return WallCells > 0 ? 1.0 - double(Instances) / double(WallCells) : 0.0; }
+};
+
+// Walls of one square block of the grid, the unit a renderer culls and an update rebuilds. Per-cell walls are
+// boxes of scale 1, merged walls never cross the chunk's edges.
+struct FMazeInstanceChunk
+{
+    FMazeRect Cells;
+    std::vector<FMazeInstanceBox> Boxes;
+
+    // Footprint of the boxes in layout space; MinX > MaxX while the chunk has no walls
+    float MinX = 0.0f;
+    float MinY = 0.0f;
+    float MaxX = -1.0f;
+    float MaxY = -1.0f;
+
+    bool IsEmpty() const { return Boxes.empty(); }
+};
+
+// A grid cut into ChunkCells x ChunkCells chunks, row-major; the last row and column may be smaller
+struct FMazeInstanceChunkGrid
+{
+    int32_t ChunkCells = 0;
+    int32_t NumChunksX = 0;
+    int32_t NumChunksY = 0;
+    std::vector<FMazeInstanceChunk> Chunks;
+
+    // Sets the cells of every chunk of a Width x Height grid, leaving them without walls
+    void Init(int32_t Width, int32_t Height, int32_t InChunkCells);
+
+    int32_t GetChunkIndex(int32_t CellX, int32_t CellY) const { return (CellY / ChunkCells) * NumChunksX + CellX / ChunkCells; }
+
+    // Chunks overlapping Rect (grid cells), row-major
+    void GetOverlappingChunks(const FMazeRect& Rect, std::vector<int32_t>& OutIndices) const;
+};
+
+// Edits that bring a per-cell wall component up to date: move instance Index onto Cell for every update, remove
+// the instances from NewNum up from the end, then append Adds. Nothing is removed from the middle, which would
+// renumber every instance after it.
+struct FMazeInstanceEdits
+{
+    struct FUpdate
+    {
+        int32_t Index;
+        FMazeCell Cell;
+    };
+
+    std::vector<FUpdate> Updates;
+    int32_t NewNum = 0;
+    std::vector<FMazeCell> Adds;
+};
+
+// Which instance of a per-cell wall component stands on which cell of a rectangle, so that a few changed walls
+// become a few instance edits rather than a rebuild. The component must hold one instance per wall cell.
+class FMazeWallInstanceSet
+{
+public:
+    // Instances of the walls of Cells in row-major order, as BuildWallChunks lays out unmerged chunks
+    void Init(const FMazeWallPlane& Grid, const FMazeRect& InCells);
+    void Reset();
+
+    bool IsValid() const { return !Cells.IsEmpty(); }
+    int32_t GetNum() const { return int32_t(InstanceCells.size()); }
+
+    // Opened cells lose their wall and closed cells gain one, cells outside the rectangle are skipped. Freed
+    // instances are reused for the new walls first, the rest are filled from the end of the list.
+    void ApplyChange(const std::vector<FMazeCell>& Opened, const std::vector<FMazeCell>& Closed, FMazeInstanceEdits& OutEdits);
+
+private:
+    FMazeRect Cells;
+
+    // Instance of every cell of Cells, -1 for open cells, and the cell of every instance
+    std::vector<int32_t> InstanceOf;
+    std::vector<FMazeCell> InstanceCells;
+};
+
+// Turns the wall plane of a finished grid into instance locations in one pass, so the engine side
+// can submit them with a single batched call instead of one AddInstance per cell.
+class FMazeInstanceBuilder
+{
+public:
+    // Pool == nullptr builds on the calling thread
+    explicit FMazeInstanceBuilder(FMazeThreadPool* InPool = nullptr) : Pool(InPool) {}
+
+    // Locations of every wall cell in row-major order (row by row, X ascending within a row)
+    void BuildWallLocations(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, std::vector<FMazeInstanceLocation>& OutLocations) const;
+
+    // Greedy merge of wall cells into non-overlapping rectangles. Each cell goes to the longer of its horizontal and
+    // vertical run, runs are then grown into rectangles over identical spans in the rows below.
+    void BuildMergedWallRects(const FMazeWallPlane& Grid, std::vector<FMazeRect>& OutRects, FMazeWallMergeStats* OutStats = nullptr) const;
+
+    // Merged rectangles as scaled instances; assumes the wall mesh is one cell wide with its pivot at the centre
+    void BuildMergedWallBoxes(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, std::vector<FMazeInstanceBox>& OutBoxes, FMazeWallMergeStats* OutStats = nullptr) const;
+
+    // Walls cut into chunks of ChunkCells x ChunkCells cells, built in parallel; OutStats counts over all chunks
+    void BuildWallChunks(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, int32_t ChunkCells, bool bMerge, FMazeInstanceChunkGrid& OutChunks, FMazeWallMergeStats* OutStats = nullptr) const;
+
+    // Rebuilds only the listed chunks after the walls inside them changed; Grid must have the size they were built for
+    void RebuildWallChunks(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, bool bMerge, const std::vector<int32_t>& ChunkIndices, FMazeInstanceChunkGrid& InOutChunks) const;
+
+    // Layout that centres the grid on the actor, matching the original per-cell placement
+    static FMazeInstanceLayout GetCenteredLayout(const FMazeWallPlane& Grid, float Spacing);
+
+private:
+    FMazeThreadPool* Pool;
+};
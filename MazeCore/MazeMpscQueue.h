@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Unbounded multi-producer / single-consumer queue (Vyukov's intrusive list with a stub node).
+// Push is wait-free and may be called from any thread; Pop must only be called from the one consumer thread.
+// T must be default constructible, the stub carries an empty value.
+template <typename T>
+class TMazeMpscQueue
+{
+public:
+    TMazeMpscQueue()
+    {
+        FNode* Stub = new FNode();
+        Head.store(Stub, std::memory_order_relaxed);
+        Tail = Stub;
+    }
+
+    ~TMazeMpscQueue()
+    {
+        while (Tail)
+        {
+            FNode* Next = Tail->Next.load(std::memory_order_relaxed);
+            delete Tail;
+            Tail = Next;
+        }
+    }
+
+    TMazeMpscQueue(const TMazeMpscQueue&) = delete;
+    TMazeMpscQueue& operator=(const TMazeMpscQueue&) = delete;
+
+    void Push(T Value)
+    {
+        FNode* Node = new FNode();
+        Node->Value = std::move(Value);
+        FNode* Prev = Head.exchange(Node, std::memory_order_acq_rel);
+        Prev->Next.store(Node, std::memory_order_release);
+    }
+
+    // False when empty. A push that is halfway through may not be visible yet; it shows up on a later call.
+    bool Pop(T& OutValue)
+    {
+        FNode* Next = Tail->Next.load(std::memory_order_acquire);
+        if (!Next)
+        {
+            return false;
+        }
+        OutValue = std::move(Next->Value);
+        delete Tail;
+        Tail = Next;
+        return true;
+    }
+
+private:
+    struct FNode
+    {
+        std::atomic<FNode*> Next{ nullptr };
+        T Value{};
+    };
+
+    std::atomic<FNode*> Head;
+    FNode* Tail;
+};
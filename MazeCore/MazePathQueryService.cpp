@@ -0,0 +1,225 @@
+#include "MazePathQueryService.h"
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+// Search state of one task: a bit and a packed 2-bit direction per cell, like FMazeFlowField, so a scratch costs
+// 3/8 of a byte per cell. Only the visited bits have to be clean between searches, and they are cleared through
+// the queue, which lists exactly the cells that were set.
+struct FMazePathSearchScratch
+{
+    std::vector<uint64_t> Visited;
+    // Direction of the next step towards the goal, four cells a byte
+    std::vector<uint8_t> Towards;
+    std::vector<uint32_t> Queue;
+    // Cell indices of the group's starts, sorted and unique
+    std::vector<uint32_t> Wanted;
+};
+
+namespace
+{
+    constexpr int32_t OffsetX[4] = { 0, 1, 0, -1 };
+    constexpr int32_t OffsetY[4] = { -1, 0, 1, 0 };
+
+    // A queue that grew past this for one far-reaching search is not kept for the next one
+    constexpr size_t RetainedQueueEntries = size_t(1) << 20;
+
+    using FSearchScratch = FMazePathSearchScratch;
+
+    void BeginSearch(FSearchScratch& Scratch, size_t NumCells)
+    {
+        if (Scratch.Visited.size() != (NumCells + 63) / 64)
+        {
+            Scratch.Visited.assign((NumCells + 63) / 64, 0);
+            Scratch.Towards.resize((NumCells + 3) / 4);
+        }
+        Scratch.Queue.clear();
+        Scratch.Wanted.clear();
+    }
+
+    void EndSearch(FSearchScratch& Scratch)
+    {
+        for (uint32_t Index : Scratch.Queue)
+        {
+            Scratch.Visited[Index / 64] = 0;
+        }
+        if (Scratch.Queue.capacity() > RetainedQueueEntries)
+        {
+            std::vector<uint32_t>().swap(Scratch.Queue);
+        }
+    }
+
+    bool IsVisited(const FSearchScratch& Scratch, uint32_t Index)
+    {
+        return (Scratch.Visited[Index / 64] >> (Index % 64)) & 1;
+    }
+
+    void Visit(FSearchScratch& Scratch, uint32_t Index, int32_t Towards)
+    {
+        Scratch.Visited[Index / 64] |= uint64_t(1) << (Index % 64);
+        uint8_t& Packed = Scratch.Towards[Index / 4];
+        const int32_t Shift = int32_t(Index % 4) * 2;
+        Packed = uint8_t((Packed & ~(3 << Shift)) | Towards << Shift);
+        Scratch.Queue.push_back(Index);
+    }
+
+    int32_t GetTowards(const FSearchScratch& Scratch, uint32_t Index)
+    {
+        return (Scratch.Towards[Index / 4] >> (Index % 4 * 2)) & 3;
+    }
+
+    bool IsWanted(const FSearchScratch& Scratch, uint32_t Index)
+    {
+        return std::binary_search(Scratch.Wanted.begin(), Scratch.Wanted.end(), Index);
+    }
+
+    bool IsOpen(const FMazeBitGrid& Grid, const FMazeCell& Cell)
+    {
+        return Cell.X >= 0 && Cell.X < Grid.GetWidth() && Cell.Y >= 0 && Cell.Y < Grid.GetHeight() && !Grid.IsWall(Cell.X, Cell.Y);
+    }
+
+    // One search from the shared goal, expanded only until every start of the group has been reached
+    std::vector<FMazePathResult> SolveGoalGroup(const FMazeBitGrid& Grid, const std::vector<FMazePathRequest>& Requests, FSearchScratch& Scratch)
+    {
+        std::vector<FMazePathResult> Results(Requests.size());
+        for (size_t i = 0; i < Requests.size(); ++i)
+        {
+            Results[i].Id = Requests[i].Id;
+        }
+
+        const FMazeCell Goal = Requests[0].Goal;
+        if (!IsOpen(Grid, Goal))
+        {
+            return Results;
+        }
+
+        const int32_t Width = Grid.GetWidth();
+        BeginSearch(Scratch, size_t(Width) * Grid.GetHeight());
+        auto GetIndex = [Width](const FMazeCell& Cell) { return uint32_t(Cell.Y) * uint32_t(Width) + uint32_t(Cell.X); };
+
+        for (const FMazePathRequest& Request : Requests)
+        {
+            if (IsOpen(Grid, Request.Start))
+            {
+                Scratch.Wanted.push_back(GetIndex(Request.Start));
+            }
+        }
+        std::sort(Scratch.Wanted.begin(), Scratch.Wanted.end());
+        Scratch.Wanted.erase(std::unique(Scratch.Wanted.begin(), Scratch.Wanted.end()), Scratch.Wanted.end());
+
+        const uint32_t GoalIndex = GetIndex(Goal);
+        Visit(Scratch, GoalIndex, 0);
+        int64_t Remaining = int64_t(Scratch.Wanted.size()) - int64_t(IsWanted(Scratch, GoalIndex));
+
+        for (size_t Head = 0; Head < Scratch.Queue.size() && Remaining > 0; ++Head)
+        {
+            const uint32_t Index = Scratch.Queue[Head];
+            const int32_t X = int32_t(Index % uint32_t(Width));
+            const int32_t Y = int32_t(Index / uint32_t(Width));
+            for (int32_t d = 0; d < 4; ++d)
+            {
+                // Guard cells are walls, so this also keeps the search inside the grid
+                if (Grid.IsWall(X + OffsetX[d], Y + OffsetY[d]))
+                {
+                    continue;
+                }
+                const uint32_t Next = GetIndex(FMazeCell{ X + OffsetX[d], Y + OffsetY[d] });
+                if (IsVisited(Scratch, Next))
+                {
+                    continue;
+                }
+                Visit(Scratch, Next, (d + 2) & 3);
+                Remaining -= IsWanted(Scratch, Next);
+            }
+        }
+
+        for (size_t i = 0; i < Requests.size(); ++i)
+        {
+            FMazeCell Cell = Requests[i].Start;
+            if (!IsOpen(Grid, Cell) || !IsVisited(Scratch, GetIndex(Cell)))
+            {
+                continue;
+            }
+
+            std::vector<FMazeCell>& Path = Results[i].Path;
+            Path.push_back(Cell);
+            while (Cell.X != Goal.X || Cell.Y != Goal.Y)
+            {
+                const int32_t d = GetTowards(Scratch, GetIndex(Cell));
+                Cell.X += OffsetX[d];
+                Cell.Y += OffsetY[d];
+                Path.push_back(Cell);
+            }
+            Results[i].bFound = true;
+        }
+        EndSearch(Scratch);
+        return Results;
+    }
+}
+
+FMazePathQueryService::FShared::~FShared() = default;
+
+FMazePathQueryService::FMazePathQueryService(std::shared_ptr<const FMazeBitGrid> InGrid, FMazeThreadPool& InPool)
+    : Shared(std::make_shared<FShared>()), Pool(InPool)
+{
+    Shared->Grid = std::move(InGrid);
+}
+
+void FMazePathQueryService::SubmitBatch(std::vector<FMazePathRequest> Requests)
+{
+    NumPending += int64_t(Requests.size());
+
+    std::unordered_map<uint64_t, std::vector<FMazePathRequest>> Groups;
+    for (FMazePathRequest& Request : Requests)
+    {
+        const uint64_t Key = uint64_t(uint32_t(Request.Goal.X)) << 32 | uint32_t(Request.Goal.Y);
+        Groups[Key].push_back(Request);
+    }
+
+    for (auto& Group : Groups)
+    {
+        Pool.Submit([Shared = Shared, GroupRequests = std::move(Group.second)]()
+        {
+            MAZE_TRACE_SCOPE("MazePathQuery.SolveGoalGroup");
+            std::unique_ptr<FSearchScratch> Scratch;
+            {
+                std::lock_guard<std::mutex> Lock(Shared->ScratchMutex);
+                if (!Shared->FreeScratch.empty())
+                {
+                    Scratch = std::move(Shared->FreeScratch.back());
+                    Shared->FreeScratch.pop_back();
+                }
+            }
+            if (!Scratch)
+            {
+                Scratch = std::make_unique<FSearchScratch>();
+            }
+
+            std::vector<FMazePathResult> Results = SolveGoalGroup(*Shared->Grid, GroupRequests, *Scratch);
+            {
+                std::lock_guard<std::mutex> Lock(Shared->ScratchMutex);
+                Shared->FreeScratch.push_back(std::move(Scratch));
+            }
+            Shared->Completed.Push(std::move(Results));
+        });
+    }
+}
+
+bool FMazePathQueryService::PollResult(FMazePathResult& OutResult)
+{
+    while (NextReady == Ready.size())
+    {
+        Ready.clear();
+        NextReady = 0;
+        if (!Shared->Completed.Pop(Ready))
+        {
+            return false;
+        }
+    }
+
+    OutResult = std::move(Ready[NextReady++]);
+    --NumPending;
+    return true;
+}
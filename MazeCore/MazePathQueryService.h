@@ -0,0 +1,78 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeMpscQueue.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class FMazeThreadPool;
+struct FMazePathSearchScratch;
+
+struct FMazePathRequest
+{
+    uint64_t Id = 0;
+    FMazeCell Start;
+    FMazeCell Goal;
+};
+
+// Path is every cell from Start to Goal inclusive, empty when bFound is false
+struct FMazePathResult
+{
+    uint64_t Id = 0;
+    bool bFound = false;
+    std::vector<FMazeCell> Path;
+};
+
+// Answers batches of path requests against one finished grid without blocking the caller.
+// Requests of a batch are grouped by goal and each group is one task on the pool: a single breadth-first search
+// from the goal, stopped once every start of the group has been reached, serves all of them. Search scratch is
+// owned by the service, a visited bit and a 2-bit direction per cell: tasks borrow it and hand it back, and it is
+// freed along with the grid once the service and its last task are gone. Results come back through a lock-free queue that the owning thread drains.
+class FMazePathQueryService
+{
+public:
+    FMazePathQueryService(std::shared_ptr<const FMazeBitGrid> InGrid, FMazeThreadPool& InPool);
+
+    // Destruction never waits: tasks still running keep the grid and the queue alive and their results are dropped
+    ~FMazePathQueryService() = default;
+
+    FMazePathQueryService(const FMazePathQueryService&) = delete;
+    FMazePathQueryService& operator=(const FMazePathQueryService&) = delete;
+
+    // Groups the batch by goal and queues one task per goal; does no searching itself
+    void SubmitBatch(std::vector<FMazePathRequest> Requests);
+
+    // Owning thread only. False once every finished result has been handed out.
+    bool PollResult(FMazePathResult& OutResult);
+
+    // Requests submitted whose results have not been polled yet
+    int64_t GetNumPending() const { return NumPending; }
+
+    const FMazeBitGrid& GetGrid() const { return *Shared->Grid; }
+
+private:
+    // Outlives the service while tasks hold it
+    struct FShared
+    {
+        std::shared_ptr<const FMazeBitGrid> Grid;
+        TMazeMpscQueue<std::vector<FMazePathResult>> Completed;
+
+        // Scratch of tasks that have finished, at most one per task that ever ran at the same time
+        std::mutex ScratchMutex;
+        std::vector<std::unique_ptr<FMazePathSearchScratch>> FreeScratch;
+
+        ~FShared();
+    };
+
+    std::shared_ptr<FShared> Shared;
+    FMazeThreadPool& Pool;
+
+    // Consumer side
+    std::vector<FMazePathResult> Ready;
+    size_t NextReady = 0;
+    int64_t NumPending = 0;
+};
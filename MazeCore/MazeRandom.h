@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// SplitMix64, cheap to seed per tile or chunk and good enough for shuffles
+struct FMazeSplitMix64
+{
+    uint64_t State;
+
+    explicit FMazeSplitMix64(uint64_t Seed) : State(Seed) {}
+
+    uint64_t Next()
+    {
+        uint64_t Z = (State += 0x9E3779B97F4A7C15ull);
+        Z = (Z ^ (Z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        Z = (Z ^ (Z >> 27)) * 0x94D049BB133111EBull;
+        return Z ^ (Z >> 31);
+    }
+
+    // Uniform value in [0, Bound)
+    uint32_t NextBelow(uint32_t Bound) { return uint32_t(((Next() >> 32) * Bound) >> 32); }
+};
+
+// xoshiro256**, the per-carver stream: a few cycles per draw and a 2^256 period.
+// Streams are split with Jump(), which skips 2^128 draws, so parallel workers never overlap.
+struct FMazeXoshiro256
+{
+    uint64_t State[4];
+
+    FMazeXoshiro256() : FMazeXoshiro256(0) {}
+
+    // The state is expanded from the seed with SplitMix64, so nearby seeds still give unrelated streams
+    explicit FMazeXoshiro256(uint64_t Seed)
+    {
+        FMazeSplitMix64 Expander(Seed);
+        for (uint64_t& Word : State)
+        {
+            Word = Expander.Next();
+        }
+    }
+
+    // Stream StreamIndex of a seed, e.g. one per carver or worker; the same pair always gives the same stream
+    static FMazeXoshiro256 ForStream(uint64_t Seed, uint32_t StreamIndex)
+    {
+        FMazeXoshiro256 Stream(Seed);
+        for (uint32_t i = 0; i < StreamIndex; ++i)
+        {
+            Stream.Jump();
+        }
+        return Stream;
+    }
+
+    uint64_t Next()
+    {
+        const uint64_t Result = RotateLeft(State[1] * 5, 7) * 9;
+        const uint64_t T = State[1] << 17;
+        State[2] ^= State[0];
+        State[3] ^= State[1];
+        State[1] ^= State[2];
+        State[0] ^= State[3];
+        State[2] ^= T;
+        State[3] = RotateLeft(State[3], 45);
+        return Result;
+    }
+
+    // Uniform value in [0, Bound)
+    uint32_t NextBelow(uint32_t Bound) { return uint32_t(((Next() >> 32) * Bound) >> 32); }
+
+    // Advance by 2^128 draws
+    void Jump()
+    {
+        static constexpr uint64_t JumpPolynomial[4] = { 0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull, 0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull };
+
+        uint64_t Jumped[4] = {};
+        for (uint64_t Word : JumpPolynomial)
+        {
+            for (int32_t Bit = 0; Bit < 64; ++Bit)
+            {
+                if (Word & (uint64_t(1) << Bit))
+                {
+                    for (int32_t i = 0; i < 4; ++i)
+                    {
+                        Jumped[i] ^= State[i];
+                    }
+                }
+                Next();
+            }
+        }
+        for (int32_t i = 0; i < 4; ++i)
+        {
+            State[i] = Jumped[i];
+        }
+    }
+
+    // Copy of this stream for another worker, this stream moves on to the next non-overlapping block
+    FMazeXoshiro256 Split()
+    {
+        const FMazeXoshiro256 Child = *this;
+        Jump();
+        return Child;
+    }
+
+private:
+    static uint64_t RotateLeft(uint64_t Value, int32_t Shift) { return (Value << Shift) | (Value >> (64 - Shift)); }
+};
+
+// Derive an independent seed from a base seed and a salt (tile index, chunk key, ...)
+inline uint64_t MixMazeSeed(uint64_t Seed, uint64_t Salt)
+{
+    return FMazeSplitMix64(Seed ^ (Salt * 0xD1B54A32D192ED03ull)).Next();
+}
+
+template <typename T, typename RngType>
+void ShuffleMazeItems(std::vector<T>& Items, RngType& Rng)
+{
+    for (size_t i = Items.size(); i > 1; --i)
+    {
+        std::swap(Items[i - 1], Items[Rng.NextBelow(uint32_t(i))]);
+    }
+}
@@ -0,0 +1,176 @@
+#include "MazeRegionRegenerator.h"
+#include "MazeRandom.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+    // Lattice cells of one parity inside a rectangle: (X0 + 2 * I, Y0 + 2 * J)
+    struct FRegionLattice
+    {
+        int32_t X0 = 0;
+        int32_t Y0 = 0;
+        int32_t NumX = 0;
+        int32_t NumY = 0;
+
+        FRegionLattice(const FMazeRect& Cells, int32_t ParityX, int32_t ParityY)
+        {
+            X0 = Cells.X + ((Cells.X & 1) != ParityX ? 1 : 0);
+            Y0 = Cells.Y + ((Cells.Y & 1) != ParityY ? 1 : 0);
+            NumX = std::max(0, (Cells.X + Cells.Width - X0 + 1) / 2);
+            NumY = std::max(0, (Cells.Y + Cells.Height - Y0 + 1) / 2);
+        }
+
+        int32_t GetNumCells() const { return NumX * NumY; }
+        int32_t GetX(int32_t Node) const { return X0 + 2 * (Node % NumX); }
+        int32_t GetY(int32_t Node) const { return Y0 + 2 * (Node / NumX); }
+
+        // Edge = 2 * Node for the passage to the right of Node, 2 * Node + 1 for the one below it
+        int32_t GetOtherNode(uint32_t Edge) const { return int32_t(Edge >> 1) + ((Edge & 1) ? NumX : 1); }
+        FMazeCell GetPassage(uint32_t Edge) const
+        {
+            const int32_t Node = int32_t(Edge >> 1);
+            return (Edge & 1) ? FMazeCell{ GetX(Node), GetY(Node) + 1 } : FMazeCell{ GetX(Node) + 1, GetY(Node) };
+        }
+    };
+
+    // An open lattice cell that is part of the corridor structure: off the border, with its four diagonal pillars
+    // standing. Room cells and cells of a lattice with the other parity fail this.
+    bool IsFreeCell(const FMazeBitGrid& Grid, int32_t X, int32_t Y)
+    {
+        return X >= 1 && Y >= 1 && X < Grid.GetWidth() - 1 && Y < Grid.GetHeight() - 1 && !Grid.IsWall(X, Y)
+            && Grid.IsWall(X - 1, Y - 1) && Grid.IsWall(X + 1, Y - 1) && Grid.IsWall(X - 1, Y + 1) && Grid.IsWall(X + 1, Y + 1);
+    }
+
+    bool IsCellBefore(const FMazeCell& A, const FMazeCell& B)
+    {
+        return A.Y != B.Y ? A.Y < B.Y : A.X < B.X;
+    }
+}
+
+int32_t FMazeRegionRegenerator::Find(int32_t Node)
+{
+    while (Parents[Node] != Node)
+    {
+        Parents[Node] = Parents[Parents[Node]];
+        Node = Parents[Node];
+    }
+    return Node;
+}
+
+bool FMazeRegionRegenerator::Regenerate(FMazeBitGrid& Grid, const FMazeRect& Region, uint64_t Seed, FMazeRegionChange& OutChange)
+{
+    MAZE_TRACE_SCOPE("MazeRegion.Regenerate");
+    OutChange.Opened.clear();
+    OutChange.Closed.clear();
+
+    const int32_t X0 = std::max(Region.X, 0);
+    const int32_t Y0 = std::max(Region.Y, 0);
+    const int32_t X1 = std::min(Region.X + Region.Width, Grid.GetWidth());
+    const int32_t Y1 = std::min(Region.Y + Region.Height, Grid.GetHeight());
+    OutChange.Cells = FMazeRect{ X0, Y0, std::max(X1 - X0, 0), std::max(Y1 - Y0, 0) };
+    if (OutChange.Cells.IsEmpty())
+    {
+        return false;
+    }
+
+    // Parity with the most free cells; ties go to the odd lattice the generators share
+    FRegionLattice Lattice(OutChange.Cells, 1, 1);
+    int32_t BestCount = 0;
+    for (const int32_t Parity : { 3, 0, 1, 2 })
+    {
+        const FRegionLattice Candidate(OutChange.Cells, Parity & 1, Parity >> 1);
+        int32_t Count = 0;
+        for (int32_t Node = 0; Node < Candidate.GetNumCells(); ++Node)
+        {
+            Count += IsFreeCell(Grid, Candidate.GetX(Node), Candidate.GetY(Node)) ? 1 : 0;
+        }
+        if (Count > BestCount)
+        {
+            BestCount = Count;
+            Lattice = Candidate;
+        }
+    }
+    if (BestCount == 0)
+    {
+        return false;
+    }
+
+    const int32_t NumCells = Lattice.GetNumCells();
+    FreeCells.resize(NumCells);
+    for (int32_t Node = 0; Node < NumCells; ++Node)
+    {
+        FreeCells[Node] = IsFreeCell(Grid, Lattice.GetX(Node), Lattice.GetY(Node)) ? 1 : 0;
+    }
+
+    // Passages between two free cells, the only cells that can change
+    Edges.clear();
+    for (int32_t Node = 0; Node < NumCells; ++Node)
+    {
+        if (!FreeCells[Node])
+        {
+            continue;
+        }
+        if (Node % Lattice.NumX + 1 < Lattice.NumX && FreeCells[Node + 1])
+        {
+            Edges.push_back(uint32_t(Node) * 2);
+        }
+        if (Node / Lattice.NumX + 1 < Lattice.NumY && FreeCells[Node + Lattice.NumX])
+        {
+            Edges.push_back(uint32_t(Node) * 2 + 1);
+        }
+    }
+
+    // Pieces connected inside the region as the maze stands
+    Parents.resize(NumCells);
+    std::iota(Parents.begin(), Parents.end(), 0);
+    for (const uint32_t Edge : Edges)
+    {
+        const FMazeCell Passage = Lattice.GetPassage(Edge);
+        if (!Grid.IsWall(Passage.X, Passage.Y))
+        {
+            Parents[Find(int32_t(Edge >> 1))] = Find(Lattice.GetOtherNode(Edge));
+        }
+    }
+
+    // Passages between two pieces stay walls, the pieces are already joined somewhere outside
+    Edges.erase(std::remove_if(Edges.begin(), Edges.end(), [this, &Lattice](uint32_t Edge)
+    {
+        return Find(int32_t(Edge >> 1)) != Find(Lattice.GetOtherNode(Edge));
+    }), Edges.end());
+
+    // Randomized Kruskal over what is left spans every piece on its own
+    FMazeXoshiro256 Rng = FMazeXoshiro256::ForStream(Seed, 0);
+    ShuffleMazeItems(Edges, Rng);
+    std::iota(Parents.begin(), Parents.end(), 0);
+    for (const uint32_t Edge : Edges)
+    {
+        const int32_t A = Find(int32_t(Edge >> 1));
+        const int32_t B = Find(Lattice.GetOtherNode(Edge));
+        const bool bOpen = A != B;
+        if (bOpen)
+        {
+            Parents[A] = B;
+        }
+
+        const FMazeCell Passage = Lattice.GetPassage(Edge);
+        const bool bWasOpen = !Grid.IsWall(Passage.X, Passage.Y);
+        if (bOpen && !bWasOpen)
+        {
+            Grid.Carve(Passage.X, Passage.Y);
+            OutChange.Opened.push_back(Passage);
+        }
+        else if (!bOpen && bWasOpen)
+        {
+            Grid.SetWall(Passage.X, Passage.Y);
+            OutChange.Closed.push_back(Passage);
+        }
+    }
+
+    std::sort(OutChange.Opened.begin(), OutChange.Opened.end(), IsCellBefore);
+    std::sort(OutChange.Closed.begin(), OutChange.Closed.end(), IsCellBefore);
+    MAZE_TRACE_COUNT(StepsTaken, int64_t(Edges.size()));
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+// What one regional regeneration wrote
+struct FMazeRegionChange
+{
+    // Region clipped to the grid, no cell outside it was touched
+    FMazeRect Cells;
+
+    // Walls that were opened and cells that became walls, row-major
+    std::vector<FMazeCell> Opened;
+    std::vector<FMazeCell> Closed;
+
+    bool IsEmpty() const { return Opened.empty() && Closed.empty(); }
+};
+
+// Re-carves a rectangle of a finished maze in place, for mazes that shift while they are played.
+// Inside the rectangle, the corridor lattice splits into pieces that are connected without leaving it. Each
+// piece is re-carved as a random spanning tree of its own cells, and every passage crossing the rectangle's edge
+// is kept. Seen from outside, each piece is still one connected blob with the same openings, so a perfect maze
+// stays perfect and the rest of the maze stays reachable, without looking at a single cell outside the rectangle.
+// The lattice parity is picked per call (the one with the most cells to work with), and lattice cells next to an
+// open pillar, like those of the start room, are left alone. Corridor mazes (tiled, Borůvka, Eller) are re-carved
+// throughout. The open four-carver mazes (the backtrackers and the Prim, Kruskal and Wilson wedges) only fit the
+// lattice in patches: those patches are re-carved and the rest is kept, so how much changes depends on the carver
+// and the rectangle, and can be nothing. Their loops and reachability are kept all the same.
+class FMazeRegionRegenerator
+{
+public:
+    // False if nothing in Region could be re-carved; OutChange lists every cell written either way
+    bool Regenerate(FMazeBitGrid& Grid, const FMazeRect& Region, uint64_t Seed, FMazeRegionChange& OutChange);
+
+private:
+    int32_t Find(int32_t Node);
+
+    // Scratch kept between calls, sized by the region's lattice cells
+    std::vector<uint8_t> FreeCells;
+    std::vector<int32_t> Parents;
+    std::vector<uint32_t> Edges;
+};
@@ -0,0 +1,248 @@
+#include "MazeSteppedGenerator.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Check the clock only every few steps, a single step is far cheaper than reading it
+    constexpr int32_t StepsPerClockCheck = 64;
+
+    constexpr int32_t StepX[4] = { 1, -1, 0, 0 };
+    constexpr int32_t StepY[4] = { 0, 0, 1, -1 };
+
+    int32_t GetCarverSeed(const FMazeParams& Params, int32_t CarverId)
+    {
+        switch (CarverId)
+        {
+        case 0: return Params.NorthSeed;
+        case 1: return Params.SouthSeed;
+        case 2: return Params.EastSeed;
+        default: return Params.WestSeed;
+        }
+    }
+}
+
+void FMazeSteppedGenerator::Begin(const FMazeParams& InParams)
+{
+    MAZE_TRACE_SCOPE("MazeStepped.Begin");
+    Params = InParams;
+    Grid.Init(Params.MazeSize, Params.MazeSize);
+    Revealed.clear();
+    StepsTaken = 0;
+    NextCarver = 0;
+    NumActive = 0;
+    bDone = Grid.IsEmpty();
+
+    const FMazeRect Room = GetStartRoom(Params);
+    Grid.ClearRect(Room.X, Room.Y, Room.Width, Room.Height);
+
+    // The perimeter is claimed up front so carvers stay inside it and only exits ever open it
+    const int32_t Width = Grid.GetWidth();
+    const int32_t Height = Grid.GetHeight();
+    Grid.SetPerimeterWalls();
+    for (int32_t x = 0; x < Width; ++x)
+    {
+        Grid.MarkVisited(x, 0);
+        Grid.MarkVisited(x, Height - 1);
+    }
+    for (int32_t y = 0; y < Height; ++y)
+    {
+        Grid.MarkVisited(0, y);
+        Grid.MarkVisited(Width - 1, y);
+    }
+
+    // Same starting points as the threaded generator: one cell outside each side of the room
+    const int32_t Center = Params.MazeSize / 2;
+    const FCell Starts[NumCarvers] = {
+        { Center, Room.Y - 1 },
+        { Center, Room.Y + Room.Height },
+        { Room.X + Room.Width, Center },
+        { Room.X - 1, Center },
+    };
+
+    for (int64_t& Count : UnvisitedByParity)
+    {
+        Count = 0;
+    }
+    for (int32_t y = 1; y < Height - 1; ++y)
+    {
+        for (int32_t x = 1; x < Width - 1; ++x)
+        {
+            UnvisitedByParity[GetParity(x, y)] += !Grid.IsVisited(x, y);
+        }
+    }
+
+    StackArena.Reserve(NumCarvers, GetMazeCellStackBound(Width, Height));
+    for (int32_t i = 0; i < NumCarvers; ++i)
+    {
+        FCarver& Carver = Carvers[i];
+        Carver.Stack = StackArena.GetStack(i);
+        Carver.Rng = FMazeXoshiro256::ForStream(uint32_t(GetCarverSeed(Params, i)), uint32_t(i));
+
+        const FCell Start = Starts[i];
+        if (Start.X <= 0 || Start.Y <= 0 || Start.X >= Width - 1 || Start.Y >= Height - 1 || Grid.IsVisited(Start.X, Start.Y))
+        {
+            continue;
+        }
+
+        OpenCell(Start.X, Start.Y, i);
+        Carver.Stack.Push(FMazeCell{ Start.X, Start.Y });
+        ++NumActive;
+    }
+}
+
+int32_t FMazeSteppedGenerator::Step(int32_t MaxSteps)
+{
+    int32_t Steps = 0;
+    int32_t Backtracks = 0;
+    while (Steps < MaxSteps && !bDone)
+    {
+        if (NumActive == 0)
+        {
+            CreateExits();
+            bDone = true;
+            break;
+        }
+
+        // Round robin over the carvers that still have cells to backtrack through
+        FCarver& Carver = Carvers[NextCarver];
+        const int32_t CarverId = NextCarver;
+        NextCarver = (NextCarver + 1) % NumCarvers;
+        if (Carver.Stack.IsEmpty())
+        {
+            continue;
+        }
+
+        Backtracks += StepCarver(Carver, CarverId) ? 0 : 1;
+        if (Carver.Stack.IsEmpty())
+        {
+            --NumActive;
+        }
+        ++StepsTaken;
+        ++Steps;
+    }
+
+    MAZE_TRACE_COUNT(StepsTaken, Steps);
+    MAZE_TRACE_COUNT(Backtracks, Backtracks);
+    MAZE_TRACE_COUNT(NeighborChecks, 4 * Steps);
+    return Steps;
+}
+
+int32_t FMazeSteppedGenerator::StepFor(std::chrono::microseconds Budget)
+{
+    MAZE_TRACE_SCOPE("MazeStepped.StepFor");
+    const auto Deadline = std::chrono::steady_clock::now() + Budget;
+
+    int32_t Steps = 0;
+    while (!bDone)
+    {
+        Steps += Step(StepsPerClockCheck);
+        if (std::chrono::steady_clock::now() >= Deadline)
+        {
+            break;
+        }
+    }
+    return Steps;
+}
+
+float FMazeSteppedGenerator::GetProgress() const
+{
+    if (bDone)
+    {
+        return 1.0f;
+    }
+
+    // Each unvisited cell a carver can still target costs at most a push and a pop, each stacked cell one more pop
+    int64_t RemainingSteps = 1;
+    bool bParityActive[4] = {};
+    for (const FCarver& Carver : Carvers)
+    {
+        if (!Carver.Stack.IsEmpty())
+        {
+            const FMazeCell Bottom = Carver.Stack.Bottom();
+            RemainingSteps += int64_t(Carver.Stack.GetNum());
+            bParityActive[GetParity(Bottom.X, Bottom.Y)] = true;
+        }
+    }
+    for (int32_t Parity = 0; Parity < 4; ++Parity)
+    {
+        RemainingSteps += bParityActive[Parity] ? 2 * UnvisitedByParity[Parity] : 0;
+    }
+    return float(double(StepsTaken) / double(StepsTaken + RemainingSteps));
+}
+
+void FMazeSteppedGenerator::ConsumeRevealed(std::vector<FMazeRevealedCell>& OutCells)
+{
+    OutCells.clear();
+    OutCells.swap(Revealed);
+}
+
+bool FMazeSteppedGenerator::StepCarver(FCarver& Carver, int32_t CarverId)
+{
+    const FMazeCell Current = Carver.Stack.Top();
+
+    int32_t Candidates[4];
+    int32_t NumCandidates = 0;
+    for (int32_t d = 0; d < 4; ++d)
+    {
+        if (!Grid.IsVisited(Current.X + StepX[d] * 2, Current.Y + StepY[d] * 2))
+        {
+            Candidates[NumCandidates++] = d;
+        }
+    }
+
+    if (NumCandidates == 0)
+    {
+        Carver.Stack.Pop();
+        return false;
+    }
+
+    const int32_t d = Candidates[Carver.Rng.NextBelow(uint32_t(NumCandidates))];
+    const FMazeCell Next{ Current.X + StepX[d] * 2, Current.Y + StepY[d] * 2 };
+    OpenCell(Current.X + StepX[d], Current.Y + StepY[d], CarverId);
+    OpenCell(Next.X, Next.Y, CarverId);
+    Carver.Stack.Push(Next);
+    return true;
+}
+
+void FMazeSteppedGenerator::OpenCell(int32_t X, int32_t Y, int32_t CarverId)
+{
+    if (Grid.IsWall(X, Y))
+    {
+        Revealed.push_back(FMazeRevealedCell{ X, Y, CarverId });
+    }
+    if (!Grid.IsVisited(X, Y))
+    {
+        --UnvisitedByParity[GetParity(X, Y)];
+    }
+    Grid.Carve(X, Y);
+}
+
+void FMazeSteppedGenerator::CreateExits()
+{
+    MAZE_TRACE_SCOPE("MazeStepped.CreateExits");
+    const int32_t Width = Grid.GetWidth();
+    const int32_t Height = Grid.GetHeight();
+
+    std::vector<FCell> PotentialExits;
+    for (int32_t x = 1; x < Width - 1; ++x)
+    {
+        PotentialExits.push_back(FCell{ x, 0 });
+        PotentialExits.push_back(FCell{ x, Height - 1 });
+    }
+    for (int32_t y = 1; y < Height - 1; ++y)
+    {
+        PotentialExits.push_back(FCell{ 0, y });
+        PotentialExits.push_back(FCell{ Width - 1, y });
+    }
+
+    FMazeSplitMix64 Rng(Params.GetCombinedSeed());
+    ShuffleMazeItems(PotentialExits, Rng);
+
+    const int32_t NumExits = std::min<int32_t>(std::max(Params.NumExits, 0), int32_t(PotentialExits.size()));
+    for (int32_t i = 0; i < NumExits; ++i)
+    {
+        OpenCell(PotentialExits[i].X, PotentialExits[i].Y, ExitCarverId);
+    }
+}
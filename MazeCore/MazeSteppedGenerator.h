@@ -0,0 +1,86 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeCarverArena.h"
+#include "MazeRandom.h"
+#include "MazeTypes.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Cell opened by the stepped generator, tagged with the carver that opened it
+struct FMazeRevealedCell
+{
+    int32_t X = 0;
+    int32_t Y = 0;
+    int32_t CarverId = 0;
+};
+
+// Resumable version of the four-carver round-robin generation. Nothing runs until Step or StepFor is
+// called, so generation can be spread over frames on the game thread with a fixed budget.
+// Cells are published as they open, which lets the caller reveal the maze while it is being carved.
+class FMazeSteppedGenerator
+{
+public:
+    // Carver ids follow the AlgIds of the actors: N, S, E, W
+    static constexpr int32_t NumCarvers = 4;
+
+    // Id reported for exits opened in the perimeter once carving is over
+    static constexpr int32_t ExitCarverId = NumCarvers;
+
+    // Reset to a solid grid with the start room open and the carvers placed around it
+    void Begin(const FMazeParams& Params);
+
+    // Advance by at most MaxSteps carver moves, returns the number actually taken
+    int32_t Step(int32_t MaxSteps);
+
+    // Advance until the budget is spent or generation is done, returns the number of steps taken
+    int32_t StepFor(std::chrono::microseconds Budget);
+
+    bool IsDone() const { return bDone; }
+
+    // Steps taken against an upper bound of the steps left, so it only moves forward; 1 once done
+    float GetProgress() const;
+
+    // Cells opened since the previous call, in the order they were opened
+    void ConsumeRevealed(std::vector<FMazeRevealedCell>& OutCells);
+
+    const FMazeBitGrid& GetGrid() const { return Grid; }
+
+private:
+    struct FCell
+    {
+        int32_t X;
+        int32_t Y;
+    };
+
+    struct FCarver
+    {
+        FMazeCellStack Stack;
+        FMazeXoshiro256 Rng;
+    };
+
+    // One move of one carver: carve towards a random unvisited neighbour or backtrack (returns false)
+    bool StepCarver(FCarver& Carver, int32_t CarverId);
+    void OpenCell(int32_t X, int32_t Y, int32_t CarverId);
+    static int32_t GetParity(int32_t X, int32_t Y) { return (X & 1) | (Y & 1) << 1; }
+    void CreateExits();
+
+    FMazeParams Params;
+    FMazeBitGrid Grid;
+    FCarver Carvers[NumCarvers];
+    int32_t NextCarver = 0;
+
+    // Backing memory of the carver stacks, grown by Begin and reused by every Begin after it
+    FMazeCarverArena StackArena;
+    int32_t NumActive = 0;
+
+    int64_t StepsTaken = 0;
+
+    // Unvisited cells per coordinate parity, carvers move two cells at a time so each only targets its own parity
+    int64_t UnvisitedByParity[4] = {};
+    bool bDone = true;
+
+    std::vector<FMazeRevealedCell> Revealed;
+};
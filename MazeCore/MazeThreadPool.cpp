@@ -0,0 +1,197 @@
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+    // Lets Submit tell its own workers apart from outside threads
+    thread_local const FMazeThreadPool* CurrentPool = nullptr;
+    thread_local int32_t CurrentWorker = -1;
+
+    // Shared between the caller of ParallelFor and the helper tasks it posts
+    struct FParallelForState
+    {
+        const std::function<void(int32_t)>* Body = nullptr;
+        int32_t Count = 0;
+        std::atomic<int32_t> NextIndex{ 0 };
+        std::atomic<int32_t> NumDone{ 0 };
+        std::mutex DoneMutex;
+        std::condition_variable DoneChanged;
+
+        // Claim and run indices until none are left
+        void Drain()
+        {
+            for (int32_t Index = NextIndex.fetch_add(1); Index < Count; Index = NextIndex.fetch_add(1))
+            {
+                (*Body)(Index);
+                if (NumDone.fetch_add(1) + 1 == Count)
+                {
+                    std::lock_guard<std::mutex> Lock(DoneMutex);
+                    DoneChanged.notify_all();
+                }
+            }
+        }
+    };
+}
+
+FMazeThreadPool::FMazeThreadPool(int32_t NumThreads)
+{
+    if (NumThreads <= 0)
+    {
+        NumThreads = std::max(int32_t(std::thread::hardware_concurrency()), 1);
+    }
+
+    // Every queue exists before the first worker can look for work
+    NumWorkers = NumThreads;
+    for (int32_t i = 0; i <= NumThreads; ++i)
+    {
+        Queues.push_back(std::make_unique<FTaskQueue>());
+    }
+
+    Workers.reserve(NumThreads);
+    for (int32_t i = 0; i < NumThreads; ++i)
+    {
+        Workers.emplace_back([this, i]() { WorkerLoop(i); });
+    }
+}
+
+FMazeThreadPool::~FMazeThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+        bStopping = true;
+    }
+    TasksChanged.notify_all();
+
+    for (std::thread& Worker : Workers)
+    {
+        Worker.join();
+    }
+}
+
+void FMazeThreadPool::Submit(std::function<void()> Task)
+{
+    const int32_t QueueIndex = CurrentPool == this ? CurrentWorker : GetNumThreads();
+    {
+        // Only thieves and the injection queue's producers meet here, contention shows up as lock wait
+        FTaskQueue& Queue = *Queues[QueueIndex];
+        std::unique_lock<std::mutex> Lock(Queue.Mutex, std::defer_lock);
+        LockMazeTraced(Lock);
+        Queue.Tasks.push_back(std::move(Task));
+    }
+
+    // Pairs with the sleeper's increment of NumSleeping before it checks NumQueued: one of the two sees the other
+    NumQueued.fetch_add(1);
+    if (NumSleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+        TasksChanged.notify_one();
+    }
+}
+
+void FMazeThreadPool::ParallelFor(int32_t Count, const std::function<void(int32_t)>& Body)
+{
+    if (Count <= 0)
+    {
+        return;
+    }
+    if (Count == 1 || Workers.empty())
+    {
+        for (int32_t Index = 0; Index < Count; ++Index)
+        {
+            Body(Index);
+        }
+        return;
+    }
+
+    auto State = std::make_shared<FParallelForState>();
+    State->Body = &Body;
+    State->Count = Count;
+
+    // Helpers that start after every index has been claimed return straight away
+    const int32_t NumHelpers = std::min(Count - 1, GetNumThreads());
+    for (int32_t i = 0; i < NumHelpers; ++i)
+    {
+        Submit([State]() { State->Drain(); });
+    }
+
+    State->Drain();
+
+    std::unique_lock<std::mutex> Lock(State->DoneMutex);
+    State->DoneChanged.wait(Lock, [&State]() { return State->NumDone.load() == State->Count; });
+}
+
+FMazeThreadPool& FMazeThreadPool::GetShared()
+{
+    static FMazeThreadPool SharedPool;
+    return SharedPool;
+}
+
+bool FMazeThreadPool::TryPopTask(int32_t WorkerIndex, std::function<void()>& OutTask)
+{
+    const int32_t NumThreads = GetNumThreads();
+    auto PopFrom = [this, &OutTask](int32_t QueueIndex, bool bNewest)
+    {
+        FTaskQueue& Queue = *Queues[QueueIndex];
+        std::unique_lock<std::mutex> Lock(Queue.Mutex, std::defer_lock);
+        LockMazeTraced(Lock);
+        if (Queue.Tasks.empty())
+        {
+            return false;
+        }
+        if (bNewest)
+        {
+            OutTask = std::move(Queue.Tasks.back());
+            Queue.Tasks.pop_back();
+        }
+        else
+        {
+            OutTask = std::move(Queue.Tasks.front());
+            Queue.Tasks.pop_front();
+        }
+        NumQueued.fetch_sub(1);
+        return true;
+    };
+
+    if (PopFrom(WorkerIndex, true) || PopFrom(NumThreads, false))
+    {
+        return true;
+    }
+    for (int32_t Offset = 1; Offset < NumThreads; ++Offset)
+    {
+        if (PopFrom((WorkerIndex + Offset) % NumThreads, false))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FMazeThreadPool::WorkerLoop(int32_t WorkerIndex)
+{
+    CurrentPool = this;
+    CurrentWorker = WorkerIndex;
+
+    for (;;)
+    {
+        std::function<void()> Task;
+        if (TryPopTask(WorkerIndex, Task))
+        {
+            Task();
+            continue;
+        }
+
+        // Queued tasks are still run after the destructor asks the workers to stop
+        std::unique_lock<std::mutex> Lock(SleepMutex);
+        NumSleeping.fetch_add(1);
+        TasksChanged.wait(Lock, [this]() { return bStopping || NumQueued.load() > 0; });
+        NumSleeping.fetch_sub(1);
+        if (bStopping && NumQueued.load() == 0)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent work-stealing worker pool used by the engine-independent generators.
+// Every worker owns a deque: tasks submitted from a worker go to its own deque and run newest first, tasks from
+// other threads go to a shared injection queue, and idle workers steal the oldest tasks of the others.
+// ParallelFor lets the calling thread take part in the work, so it is safe to call from inside a pool task.
+class FMazeThreadPool
+{
+public:
+    // NumThreads <= 0 uses one worker per hardware thread
+    explicit FMazeThreadPool(int32_t NumThreads = 0);
+    ~FMazeThreadPool();
+
+    FMazeThreadPool(const FMazeThreadPool&) = delete;
+    FMazeThreadPool& operator=(const FMazeThreadPool&) = delete;
+
+    int32_t GetNumThreads() const { return NumWorkers; }
+
+    // Queue a task to run on a worker thread; no ordering between tasks is guaranteed
+    void Submit(std::function<void()> Task);
+
+    // Run Body(Index) for every Index in [0, Count) and return once all of them have finished
+    void ParallelFor(int32_t Count, const std::function<void(int32_t)>& Body);
+
+    // Pool shared by everything that does not bring its own
+    static FMazeThreadPool& GetShared();
+
+private:
+    struct FTaskQueue
+    {
+        std::mutex Mutex;
+        std::deque<std::function<void()>> Tasks;
+    };
+
+    void WorkerLoop(int32_t WorkerIndex);
+
+    // Own deque from the back, then the injection queue, then the front of the other workers' deques
+    bool TryPopTask(int32_t WorkerIndex, std::function<void()>& OutTask);
+
+    // Fixed before the first worker starts, workers read it while Workers is still being filled
+    int32_t NumWorkers = 0;
+    std::vector<std::thread> Workers;
+
+    // One per worker, plus the injection queue at index GetNumThreads()
+    std::vector<std::unique_ptr<FTaskQueue>> Queues;
+    std::atomic<int64_t> NumQueued{ 0 };
+
+    // Idle workers sleep here; submitters only take the lock when someone is asleep
+    std::mutex SleepMutex;
+    std::condition_variable TasksChanged;
+    std::atomic<int32_t> NumSleeping{ 0 };
+    bool bStopping = false;
+};
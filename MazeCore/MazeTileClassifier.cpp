@@ -0,0 +1,219 @@
+#include "MazeTileClassifier.h"
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace
+{
+    constexpr int32_t RowsPerBand = 64;
+
+    // Clockwise quarter turn: north -> east -> south -> west -> north
+    constexpr uint8_t RotateMask(uint8_t Mask)
+    {
+        return uint8_t(((Mask << 1) | (Mask >> 3)) & 0xF);
+    }
+
+    constexpr std::array<FMazeTileShape, 16> BuildShapeTable()
+    {
+        struct FBase
+        {
+            EMazeTileType Type;
+            uint8_t Mask;
+        };
+        constexpr FBase Bases[] = {
+            { EMazeTileType::DeadEnd, MazeTileNorth },
+            { EMazeTileType::Straight, MazeTileNorth | MazeTileSouth },
+            { EMazeTileType::Corner, MazeTileNorth | MazeTileEast },
+            { EMazeTileType::Junction, MazeTileNorth | MazeTileEast | MazeTileSouth },
+            { EMazeTileType::Intersection, MazeTileNorth | MazeTileEast | MazeTileSouth | MazeTileWest },
+        };
+
+        std::array<FMazeTileShape, 16> Table{};
+        std::array<bool, 16> bFilled{};
+        for (const FBase& Base : Bases)
+        {
+            uint8_t Mask = Base.Mask;
+            for (uint8_t Rotation = 0; Rotation < 4; ++Rotation)
+            {
+                // Symmetric shapes repeat, keep the smallest rotation
+                if (!bFilled[Mask])
+                {
+                    Table[Mask] = FMazeTileShape{ Base.Type, Rotation };
+                    bFilled[Mask] = true;
+                }
+                Mask = RotateMask(Mask);
+            }
+        }
+        return Table;
+    }
+
+    constexpr std::array<FMazeTileShape, 16> ShapeTable = BuildShapeTable();
+
+    // Open cells of word W of a row; guard and padding bits are walls, so they never show up as open
+    uint64_t OpenWord(const uint64_t* Row, int32_t W, int32_t WordsPerRow)
+    {
+        return W >= 0 && W < WordsPerRow ? ~Row[W] : 0;
+    }
+
+    int64_t CountPathCells(const FMazeWallPlane& Grid, int32_t Y0, int32_t Y1)
+    {
+        int64_t Count = 0;
+        for (int32_t y = Y0; y < Y1; ++y)
+        {
+            Count += Grid.GetWidth() - Grid.CountWallsInRow(y);
+        }
+        return Count;
+    }
+
+    // Classify rows [Y0, Y1), calling Emit(X, Y, Shape) for each path cell in row-major order
+    template <typename EmitFunc>
+    void ClassifyRows(const FMazeWallPlane& Grid, int32_t Y0, int32_t Y1, EmitFunc&& Emit)
+    {
+        const int32_t WordsPerRow = Grid.GetWordsPerRow();
+        for (int32_t y = Y0; y < Y1; ++y)
+        {
+            // Guard rows make the rows above the first and below the last valid
+            const uint64_t* Above = Grid.GetWallRow(y - 1);
+            const uint64_t* Row = Grid.GetWallRow(y);
+            const uint64_t* Below = Grid.GetWallRow(y + 1);
+
+            for (int32_t w = 0; w < WordsPerRow; ++w)
+            {
+                const uint64_t Open = OpenWord(Row, w, WordsPerRow);
+                if (!Open)
+                {
+                    continue;
+                }
+
+                // Bit i of each plane: is the neighbour of cell i in that direction open
+                const uint64_t North = OpenWord(Above, w, WordsPerRow);
+                const uint64_t South = OpenWord(Below, w, WordsPerRow);
+                const uint64_t East = (Open >> 1) | (OpenWord(Row, w + 1, WordsPerRow) << 63);
+                const uint64_t West = (Open << 1) | (OpenWord(Row, w - 1, WordsPerRow) >> 63);
+
+                const int32_t WordX = w * FMazeBitGrid::BitsPerWord - FMazeBitGrid::GuardCells;
+                uint64_t Cells = Open;
+                while (Cells)
+                {
+                    const int32_t Bit = std::countr_zero(Cells);
+                    const uint32_t Mask = uint32_t((North >> Bit) & 1) | uint32_t((East >> Bit) & 1) << 1 | uint32_t((South >> Bit) & 1) << 2 | uint32_t((West >> Bit) & 1) << 3;
+                    Emit(WordX + Bit, y, ShapeTable[Mask]);
+                    Cells &= Cells - 1;
+                }
+            }
+        }
+    }
+
+    // Split rows into bands, count each band's output, then let every band fill its own slice
+    template <typename CountFunc, typename ResizeFunc, typename FillFunc>
+    void RunBands(FMazeThreadPool* Pool, int32_t Height, CountFunc&& Count, ResizeFunc&& Resize, FillFunc&& Fill)
+    {
+        const int32_t NumBands = (Height + RowsPerBand - 1) / RowsPerBand;
+        std::vector<int64_t> Offsets(size_t(NumBands) + 1, 0);
+
+        auto CountBand = [&](int32_t Band) { Offsets[size_t(Band) + 1] = Count(Band * RowsPerBand, std::min((Band + 1) * RowsPerBand, Height)); };
+        auto FillBand = [&](int32_t Band) { Fill(Band * RowsPerBand, std::min((Band + 1) * RowsPerBand, Height), size_t(Offsets[Band])); };
+
+        if (Pool && NumBands > 1)
+        {
+            Pool->ParallelFor(NumBands, CountBand);
+        }
+        else
+        {
+            for (int32_t Band = 0; Band < NumBands; ++Band)
+            {
+                CountBand(Band);
+            }
+        }
+
+        for (int32_t Band = 0; Band < NumBands; ++Band)
+        {
+            Offsets[size_t(Band) + 1] += Offsets[Band];
+        }
+        Resize(size_t(Offsets[NumBands]));
+
+        if (Pool && NumBands > 1)
+        {
+            Pool->ParallelFor(NumBands, FillBand);
+        }
+        else
+        {
+            for (int32_t Band = 0; Band < NumBands; ++Band)
+            {
+                FillBand(Band);
+            }
+        }
+    }
+}
+
+FMazeTileShape GetMazeTileShape(uint8_t NeighbourMask)
+{
+    return ShapeTable[NeighbourMask & 0xF];
+}
+
+uint8_t GetMazeTileMask(const FMazeWallPlane& Grid, int32_t X, int32_t Y)
+{
+    return uint8_t(!Grid.IsWall(X, Y - 1) * MazeTileNorth | !Grid.IsWall(X + 1, Y) * MazeTileEast | !Grid.IsWall(X, Y + 1) * MazeTileSouth | !Grid.IsWall(X - 1, Y) * MazeTileWest);
+}
+
+void FMazeTileClassifier::Classify(const FMazeWallPlane& Grid, FMazeTileArrays& OutTiles) const
+{
+    MAZE_TRACE_SCOPE("MazeTiles.Classify");
+    OutTiles = FMazeTileArrays();
+    if (Grid.IsEmpty())
+    {
+        return;
+    }
+
+    RunBands(Pool, Grid.GetHeight(),
+        [&Grid](int32_t Y0, int32_t Y1) { return CountPathCells(Grid, Y0, Y1); },
+        [&OutTiles](size_t Num)
+        {
+            OutTiles.X.resize(Num);
+            OutTiles.Y.resize(Num);
+            OutTiles.Type.resize(Num);
+            OutTiles.Rotation.resize(Num);
+        },
+        [&Grid, &OutTiles](int32_t Y0, int32_t Y1, size_t Offset)
+        {
+            ClassifyRows(Grid, Y0, Y1, [&OutTiles, &Offset](int32_t X, int32_t Y, FMazeTileShape Shape)
+            {
+                OutTiles.X[Offset] = X;
+                OutTiles.Y[Offset] = Y;
+                OutTiles.Type[Offset] = Shape.Type;
+                OutTiles.Rotation[Offset] = Shape.Rotation;
+                ++Offset;
+            });
+        });
+}
+
+void FMazeTileClassifier::ClassifyByType(const FMazeWallPlane& Grid, FMazeTileList (&OutLists)[NumMazeTileTypes]) const
+{
+    MAZE_TRACE_SCOPE("MazeTiles.ClassifyByType");
+    FMazeTileArrays Tiles;
+    Classify(Grid, Tiles);
+
+    size_t Counts[NumMazeTileTypes] = {};
+    for (EMazeTileType Type : Tiles.Type)
+    {
+        ++Counts[size_t(Type)];
+    }
+    for (int32_t t = 0; t < NumMazeTileTypes; ++t)
+    {
+        OutLists[t] = FMazeTileList();
+        OutLists[t].X.reserve(Counts[t]);
+        OutLists[t].Y.reserve(Counts[t]);
+        OutLists[t].Rotation.reserve(Counts[t]);
+    }
+
+    for (size_t i = 0; i < Tiles.Num(); ++i)
+    {
+        FMazeTileList& List = OutLists[size_t(Tiles.Type[i])];
+        List.X.push_back(Tiles.X[i]);
+        List.Y.push_back(Tiles.Y[i]);
+        List.Rotation.push_back(Tiles.Rotation[i]);
+    }
+}
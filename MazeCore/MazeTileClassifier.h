@@ -0,0 +1,80 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+
+#include <cstdint>
+#include <vector>
+
+class FMazeThreadPool;
+
+// Same order as ETileType on the actor, so the values cast across directly
+enum class EMazeTileType : uint8_t
+{
+    Straight,
+    Junction,
+    Intersection,
+    Corner,
+    DeadEnd
+};
+
+constexpr int32_t NumMazeTileTypes = 5;
+
+// Open-neighbour mask bits of a path cell
+enum EMazeTileNeighbour : uint8_t
+{
+    MazeTileNorth = 1,  // Y - 1
+    MazeTileEast = 2,   // X + 1
+    MazeTileSouth = 4,  // Y + 1
+    MazeTileWest = 8    // X - 1
+};
+
+// Tile shape plus the number of clockwise quarter turns from its base orientation.
+// Base orientations: DeadEnd opens north, Straight runs north-south, Corner joins north and east,
+// Junction is closed to the west. A path cell with no open neighbour is reported as a DeadEnd.
+struct FMazeTileShape
+{
+    EMazeTileType Type = EMazeTileType::DeadEnd;
+    uint8_t Rotation = 0;
+};
+
+// Lookup from a 4-bit neighbour mask
+FMazeTileShape GetMazeTileShape(uint8_t NeighbourMask);
+
+// Neighbour mask of a single cell, for one-off queries
+uint8_t GetMazeTileMask(const FMazeWallPlane& Grid, int32_t X, int32_t Y);
+
+// Classification of every path cell, structure-of-arrays in row-major order
+struct FMazeTileArrays
+{
+    std::vector<int32_t> X;
+    std::vector<int32_t> Y;
+    std::vector<EMazeTileType> Type;
+    std::vector<uint8_t> Rotation;
+
+    size_t Num() const { return X.size(); }
+};
+
+// Path cells of a single type, ready to feed one instanced mesh
+struct FMazeTileList
+{
+    std::vector<int32_t> X;
+    std::vector<int32_t> Y;
+    std::vector<uint8_t> Rotation;
+};
+
+// Classifies the whole grid at once. Neighbour masks come from the wall bit-plane shifted by one cell in each
+// direction, 64 cells per word operation, and each path cell then costs a single table lookup.
+class FMazeTileClassifier
+{
+public:
+    // Pool == nullptr classifies on the calling thread
+    explicit FMazeTileClassifier(FMazeThreadPool* InPool = nullptr) : Pool(InPool) {}
+
+    void Classify(const FMazeWallPlane& Grid, FMazeTileArrays& OutTiles) const;
+
+    // Same classification split by type, indexed by EMazeTileType
+    void ClassifyByType(const FMazeWallPlane& Grid, FMazeTileList (&OutLists)[NumMazeTileTypes]) const;
+
+private:
+    FMazeThreadPool* Pool;
+};
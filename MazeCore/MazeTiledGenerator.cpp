@@ -0,0 +1,386 @@
+#include "MazeTiledGenerator.h"
+#include "MazeRandom.h"
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t RoomLabel = MazeBlockedLabel;
+
+    constexpr int32_t DirX[4] = { 1, -1, 0, 0 };
+    constexpr int32_t DirY[4] = { 0, 0, 1, -1 };
+
+    // Wall cell that joins the start room to a tile component
+    struct FRoomLink
+    {
+        int32_t WallX;
+        int32_t WallY;
+        uint32_t Label;
+    };
+
+    struct FTile
+    {
+        // Lattice bounds of the tile
+        int32_t I0 = 0;
+        int32_t J0 = 0;
+        int32_t Width = 0;
+        int32_t Height = 0;
+
+        // Local component label of every border cell, RoomLabel for cells inside the start room
+        std::vector<uint32_t> NorthLabels;
+        std::vector<uint32_t> SouthLabels;
+        std::vector<uint32_t> WestLabels;
+        std::vector<uint32_t> EastLabels;
+        std::vector<FRoomLink> RoomLinks;
+
+        uint32_t NumComponents = 0;
+        uint32_t FirstComponent = 0;
+
+        uint32_t GlobalLabel(uint32_t Local) const { return Local == RoomLabel ? RoomLabel : FirstComponent + Local; }
+    };
+
+    struct FUnionFind
+    {
+        std::vector<uint32_t> Parent;
+
+        explicit FUnionFind(uint32_t Count) : Parent(Count)
+        {
+            for (uint32_t i = 0; i < Count; ++i)
+            {
+                Parent[i] = i;
+            }
+        }
+
+        uint32_t Find(uint32_t Node)
+        {
+            while (Parent[Node] != Node)
+            {
+                Parent[Node] = Parent[Parent[Node]];
+                Node = Parent[Node];
+            }
+            return Node;
+        }
+
+        // Returns false if both nodes were already connected
+        bool Union(uint32_t A, uint32_t B)
+        {
+            A = Find(A);
+            B = Find(B);
+            if (A == B)
+            {
+                return false;
+            }
+            Parent[std::max(A, B)] = std::min(A, B);
+            return true;
+        }
+    };
+
+    // Spanning forest of one tile plus the labels needed to stitch it to its neighbours
+    void CarveTile(FTile& Tile, const FMazeRect& Room, uint64_t Seed, FMazeBitGrid& Grid)
+    {
+        const int32_t W = Tile.Width;
+        const int32_t H = Tile.Height;
+
+        // Per worker and reused by every tile it carves, a tile never outgrows TileCells squared
+        thread_local std::vector<uint32_t> Labels;
+        Tile.NumComponents = CarveLatticeForest(Grid, Tile.I0, Tile.J0, W, H, Room, Seed, Labels);
+
+        Tile.NorthLabels.assign(Labels.begin(), Labels.begin() + W);
+        Tile.SouthLabels.assign(Labels.end() - W, Labels.end());
+        Tile.WestLabels.resize(H);
+        Tile.EastLabels.resize(H);
+        for (int32_t ly = 0; ly < H; ++ly)
+        {
+            Tile.WestLabels[ly] = Labels[ly * W];
+            Tile.EastLabels[ly] = Labels[ly * W + W - 1];
+        }
+
+        // Cells right next to the start room become candidates for room entrances
+        if (!Room.IsEmpty())
+        {
+            for (int32_t ly = 0; ly < H; ++ly)
+            {
+                for (int32_t lx = 0; lx < W; ++lx)
+                {
+                    const uint32_t Label = Labels[ly * W + lx];
+                    if (Label == RoomLabel)
+                    {
+                        continue;
+                    }
+
+                    const int32_t gx = 2 * (Tile.I0 + lx) + 1;
+                    const int32_t gy = 2 * (Tile.J0 + ly) + 1;
+                    for (int32_t d = 0; d < 4; ++d)
+                    {
+                        if (Room.Contains(gx + 2 * DirX[d], gy + 2 * DirY[d]))
+                        {
+                            Tile.RoomLinks.push_back({ gx + DirX[d], gy + DirY[d], Label });
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void FMazeTiledGenerator::Generate(const FMazeParams& Params, const FMazeTiledSettings& Settings, FMazeBitGrid& OutGrid)
+{
+    MAZE_TRACE_SCOPE("MazeTiled.Generate");
+    OutGrid.Init(Params.MazeSize, Params.MazeSize);
+
+    const int32_t LatticeSize = GetLatticeSize(Params.MazeSize);
+    const FMazeRect Room = GetLatticeStartRoom(Params);
+    if (!Room.IsEmpty())
+    {
+        OutGrid.ClearRect(Room.X, Room.Y, Room.Width, Room.Height);
+    }
+
+    const int32_t TileCells = std::max(Settings.TileCells, 1);
+    const int32_t TilesPerSide = (LatticeSize + TileCells - 1) / TileCells;
+    const int32_t NumTiles = TilesPerSide * TilesPerSide;
+
+    std::vector<FTile> Tiles(NumTiles);
+    for (int32_t t = 0; t < NumTiles; ++t)
+    {
+        FTile& Tile = Tiles[t];
+        Tile.I0 = (t % TilesPerSide) * TileCells;
+        Tile.J0 = (t / TilesPerSide) * TileCells;
+        Tile.Width = std::min(TileCells, LatticeSize - Tile.I0);
+        Tile.Height = std::min(TileCells, LatticeSize - Tile.J0);
+    }
+
+    // Carve every tile independently
+    const uint64_t BaseSeed = Params.GetCombinedSeed();
+    Pool.ParallelFor(NumTiles, [&Tiles, &Room, &OutGrid, BaseSeed](int32_t t)
+    {
+        MAZE_TRACE_SCOPE("MazeTiled.CarveTile");
+        CarveTile(Tiles[t], Room, MixMazeSeed(BaseSeed, uint64_t(t)), OutGrid);
+    });
+
+    // Stitch components together, the start room is the last node
+    MAZE_TRACE_SCOPE("MazeTiled.Stitch");
+    uint32_t NumComponents = 0;
+    for (FTile& Tile : Tiles)
+    {
+        Tile.FirstComponent = NumComponents;
+        NumComponents += Tile.NumComponents;
+    }
+    const uint32_t RoomNode = NumComponents;
+
+    FUnionFind Sets(NumComponents + 1);
+    FMazeSplitMix64 StitchRng(MixMazeSeed(BaseSeed, uint64_t(NumTiles)));
+
+    auto TryOpen = [&](int32_t WallX, int32_t WallY, uint32_t A, uint32_t B)
+    {
+        const bool bMerged = Sets.Union(A, B);
+        if (bMerged || (!Settings.bPerfect && (StitchRng.Next() >> 40) < uint64_t(Settings.LoopChance * float(1 << 24))))
+        {
+            OutGrid.ClearWall(WallX, WallY);
+        }
+    };
+
+    // Room entrances first, so every tile component touching the room gets its own way in
+    std::vector<FRoomLink> RoomLinks;
+    for (const FTile& Tile : Tiles)
+    {
+        for (const FRoomLink& Link : Tile.RoomLinks)
+        {
+            RoomLinks.push_back({ Link.WallX, Link.WallY, Tile.GlobalLabel(Link.Label) });
+        }
+    }
+    ShuffleMazeItems(RoomLinks, StitchRng);
+    for (const FRoomLink& Link : RoomLinks)
+    {
+        TryOpen(Link.WallX, Link.WallY, Link.Label, RoomNode);
+    }
+
+    // Seam passages between horizontally and vertically adjacent tiles
+    struct FSeamCandidate
+    {
+        int32_t WallX;
+        int32_t WallY;
+        uint32_t A;
+        uint32_t B;
+    };
+    std::vector<FSeamCandidate> Candidates;
+
+    for (int32_t t = 0; t < NumTiles; ++t)
+    {
+        const FTile& Tile = Tiles[t];
+        const int32_t tx = t % TilesPerSide;
+        const int32_t ty = t / TilesPerSide;
+
+        Candidates.clear();
+        if (tx + 1 < TilesPerSide)
+        {
+            const FTile& East = Tiles[t + 1];
+            for (int32_t ly = 0; ly < Tile.Height; ++ly)
+            {
+                if (Tile.EastLabels[ly] != RoomLabel && East.WestLabels[ly] != RoomLabel)
+                {
+                    Candidates.push_back({ 2 * East.I0, 2 * (Tile.J0 + ly) + 1, Tile.GlobalLabel(Tile.EastLabels[ly]), East.GlobalLabel(East.WestLabels[ly]) });
+                }
+            }
+        }
+        if (ty + 1 < TilesPerSide)
+        {
+            const FTile& South = Tiles[t + TilesPerSide];
+            for (int32_t lx = 0; lx < Tile.Width; ++lx)
+            {
+                if (Tile.SouthLabels[lx] != RoomLabel && South.NorthLabels[lx] != RoomLabel)
+                {
+                    Candidates.push_back({ 2 * (Tile.I0 + lx) + 1, 2 * South.J0, Tile.GlobalLabel(Tile.SouthLabels[lx]), South.GlobalLabel(South.NorthLabels[lx]) });
+                }
+            }
+        }
+
+        ShuffleMazeItems(Candidates, StitchRng);
+        for (const FSeamCandidate& Candidate : Candidates)
+        {
+            TryOpen(Candidate.WallX, Candidate.WallY, Candidate.A, Candidate.B);
+        }
+    }
+
+    OutGrid.SetPerimeterWalls();
+    CreateLatticeExits(Params, MixMazeSeed(BaseSeed, ~uint64_t(0)), OutGrid);
+}
+
+uint32_t CarveLatticeForest(FMazeBitGrid& Grid, int32_t I0, int32_t J0, int32_t Width, int32_t Height, const FMazeRect& Blocked, uint64_t Seed, std::vector<uint32_t>& OutLabels)
+{
+    constexpr uint32_t NoLabel = MazeBlockedLabel - 1;
+    const int32_t W = Width;
+    const int32_t H = Height;
+
+    OutLabels.assign(size_t(W) * H, NoLabel);
+    if (!Blocked.IsEmpty())
+    {
+        for (int32_t ly = 0; ly < H; ++ly)
+        {
+            for (int32_t lx = 0; lx < W; ++lx)
+            {
+                if (Blocked.Contains(2 * (I0 + lx) + 1, 2 * (J0 + ly) + 1))
+                {
+                    OutLabels[ly * W + lx] = MazeBlockedLabel;
+                }
+            }
+        }
+    }
+
+    FMazeSplitMix64 Rng(Seed);
+    thread_local std::vector<uint32_t> Stack;
+    Stack.clear();
+    Stack.reserve(OutLabels.size());
+
+    uint32_t NumComponents = 0;
+    int64_t NumSteps = 0;
+    int64_t NumBacktracks = 0;
+    for (uint32_t Root = 0; Root < OutLabels.size(); ++Root)
+    {
+        if (OutLabels[Root] != NoLabel)
+        {
+            continue;
+        }
+
+        const uint32_t Label = NumComponents++;
+        OutLabels[Root] = Label;
+        Grid.ClearWallAtomic(2 * (I0 + int32_t(Root % W)) + 1, 2 * (J0 + int32_t(Root / W)) + 1);
+        Stack.push_back(Root);
+
+        while (!Stack.empty())
+        {
+            ++NumSteps;
+            const uint32_t Current = Stack.back();
+            const int32_t lx = int32_t(Current % W);
+            const int32_t ly = int32_t(Current / W);
+
+            int32_t Candidates[4];
+            uint32_t NumCandidates = 0;
+            for (int32_t d = 0; d < 4; ++d)
+            {
+                const int32_t nx = lx + DirX[d];
+                const int32_t ny = ly + DirY[d];
+                if (nx >= 0 && nx < W && ny >= 0 && ny < H && OutLabels[ny * W + nx] == NoLabel)
+                {
+                    Candidates[NumCandidates++] = d;
+                }
+            }
+
+            if (NumCandidates == 0)
+            {
+                ++NumBacktracks;
+                Stack.pop_back();
+                continue;
+            }
+
+            const int32_t d = Candidates[Rng.NextBelow(NumCandidates)];
+            const uint32_t Next = uint32_t((ly + DirY[d]) * W + lx + DirX[d]);
+            const int32_t gx = 2 * (I0 + lx) + 1;
+            const int32_t gy = 2 * (J0 + ly) + 1;
+
+            // Neighbouring tiles may share grid words, so writes go through atomics
+            Grid.ClearWallAtomic(gx + DirX[d], gy + DirY[d]);
+            Grid.ClearWallAtomic(gx + 2 * DirX[d], gy + 2 * DirY[d]);
+            OutLabels[Next] = Label;
+            Stack.push_back(Next);
+        }
+    }
+
+    MAZE_TRACE_COUNT(StepsTaken, NumSteps);
+    MAZE_TRACE_COUNT(Backtracks, NumBacktracks);
+    MAZE_TRACE_COUNT(NeighborChecks, 4 * NumSteps);
+    return NumComponents;
+}
+
+void CreateLatticeExits(const FMazeParams& Params, uint64_t Seed, FMazeBitGrid& Grid)
+{
+    const int32_t LatticeSize = GetLatticeSize(Params.MazeSize);
+    const int32_t NumCandidates = 4 * LatticeSize;
+    const int32_t NumExits = std::min(std::max(Params.NumExits, 0), NumCandidates);
+    if (NumExits == 0)
+    {
+        return;
+    }
+
+    // Partial Fisher-Yates over the perimeter cells facing a lattice row or column
+    std::vector<int32_t> Order(NumCandidates);
+    for (int32_t i = 0; i < NumCandidates; ++i)
+    {
+        Order[i] = i;
+    }
+
+    FMazeSplitMix64 Rng(Seed);
+    const int32_t Far = Params.MazeSize - 1;
+    const int32_t LastLattice = 2 * LatticeSize - 1;
+    for (int32_t i = 0; i < NumExits; ++i)
+    {
+        std::swap(Order[i], Order[i + Rng.NextBelow(uint32_t(NumCandidates - i))]);
+
+        const int32_t Side = Order[i] / LatticeSize;
+        const int32_t Along = 2 * (Order[i] % LatticeSize) + 1;
+        switch (Side)
+        {
+        case 0:
+            Grid.ClearWall(Along, 0);
+            break;
+        case 1:
+            Grid.ClearWall(0, Along);
+            break;
+        case 2:
+            // An even sized maze leaves a second wall cell between the lattice and the far perimeter
+            for (int32_t y = LastLattice + 1; y <= Far; ++y)
+            {
+                Grid.ClearWall(Along, y);
+            }
+            break;
+        default:
+            for (int32_t x = LastLattice + 1; x <= Far; ++x)
+            {
+                Grid.ClearWall(x, Along);
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeTypes.h"
+
+#include <cstdint>
+#include <vector>
+
+class FMazeThreadPool;
+
+struct FMazeTiledSettings
+{
+    // Tile edge in lattice cells (a tile covers twice as many grid cells)
+    int32_t TileCells = 64;
+
+    // Open exactly one passage per merge so the whole maze stays a spanning tree
+    bool bPerfect = true;
+
+    // Chance that a redundant seam candidate is opened anyway when bPerfect is false
+    float LoopChance = 0.05f;
+};
+
+// Splits the corridor lattice into independent tiles, carves every tile with its own
+// backtracker on a worker pool, then stitches tiles together and to the start room
+// through shuffled seam passages chosen with a union-find over the tile components.
+// Every random decision is seeded from the parameters and the tile index, so the result
+// does not depend on thread scheduling.
+class FMazeTiledGenerator
+{
+public:
+    explicit FMazeTiledGenerator(FMazeThreadPool& InPool) : Pool(InPool) {}
+
+    void Generate(const FMazeParams& Params, const FMazeTiledSettings& Settings, FMazeBitGrid& OutGrid);
+
+private:
+    FMazeThreadPool& Pool;
+};
+
+// Label given to lattice cells inside the blocked rectangle
+constexpr uint32_t MazeBlockedLabel = ~uint32_t(0);
+
+// Carve a spanning forest of the lattice rectangle [I0, I0 + Width) x [J0, J0 + Height) with an iterative
+// backtracker, skipping lattice cells inside Blocked. OutLabels receives the component of every cell
+// (row-major, MazeBlockedLabel for blocked cells); returns the number of components.
+uint32_t CarveLatticeForest(FMazeBitGrid& Grid, int32_t I0, int32_t J0, int32_t Width, int32_t Height, const FMazeRect& Blocked, uint64_t Seed, std::vector<uint32_t>& OutLabels);
+
+// Open NumExits perimeter cells that lead straight into the corridor lattice
+void CreateLatticeExits(const FMazeParams& Params, uint64_t Seed, FMazeBitGrid& Grid);
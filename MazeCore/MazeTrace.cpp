@@ -0,0 +1,219 @@
+#include "MazeTrace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Per thread cap, a runaway scope in a loop should not eat the heap
+    constexpr size_t MaxEventsPerThread = size_t(1) << 20;
+
+    struct FTraceEvent
+    {
+        const char* Name;
+        uint64_t Start;
+        uint64_t End;
+    };
+
+    // Owned jointly by the registry and its thread, so events survive pool threads that exit before the export
+    struct FThreadBuffer
+    {
+        uint32_t ThreadId = 0;
+        std::mutex EventsMutex;
+        std::vector<FTraceEvent> Events;
+        std::atomic<int64_t> Counters[NumMazeTraceCounters] = {};
+    };
+
+    struct FRegistry
+    {
+        std::mutex Mutex;
+        std::vector<std::shared_ptr<FThreadBuffer>> Buffers;
+    };
+
+    FRegistry& GetRegistry()
+    {
+        static FRegistry Registry;
+        return Registry;
+    }
+
+    FThreadBuffer& GetThreadBuffer()
+    {
+        thread_local std::shared_ptr<FThreadBuffer> Buffer;
+        if (!Buffer)
+        {
+            Buffer = std::make_shared<FThreadBuffer>();
+            FRegistry& Registry = GetRegistry();
+            std::lock_guard<std::mutex> Lock(Registry.Mutex);
+            Buffer->ThreadId = uint32_t(Registry.Buffers.size()) + 1;
+            Registry.Buffers.push_back(Buffer);
+        }
+        return *Buffer;
+    }
+
+    const std::chrono::steady_clock::time_point& GetEpoch()
+    {
+        static const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+        return Epoch;
+    }
+
+    void AppendJsonString(std::string& Out, const char* Text)
+    {
+        Out += '"';
+        for (const char* It = Text; *It; ++It)
+        {
+            if (*It == '"' || *It == '\\')
+            {
+                Out += '\\';
+            }
+            Out += *It;
+        }
+        Out += '"';
+    }
+
+    void AppendMicroseconds(std::string& Out, uint64_t Nanoseconds)
+    {
+        char Buffer[32];
+        std::snprintf(Buffer, sizeof(Buffer), "%llu.%03llu", (unsigned long long)(Nanoseconds / 1000), (unsigned long long)(Nanoseconds % 1000));
+        Out += Buffer;
+    }
+}
+
+const char* GetMazeTraceCounterName(EMazeTraceCounter Counter)
+{
+    switch (Counter)
+    {
+    case EMazeTraceCounter::StepsTaken: return "StepsTaken";
+    case EMazeTraceCounter::Backtracks: return "Backtracks";
+    case EMazeTraceCounter::NeighborChecks: return "NeighborChecks";
+    case EMazeTraceCounter::LockWaitNanoseconds: return "LockWaitNanoseconds";
+    case EMazeTraceCounter::InstancesSubmitted: return "InstancesSubmitted";
+    default: return "Unknown";
+    }
+}
+
+uint64_t FMazeTrace::GetNanoseconds()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetEpoch()).count());
+}
+
+void FMazeTrace::AddEvent(const char* Name, uint64_t StartNanoseconds, uint64_t EndNanoseconds)
+{
+    FThreadBuffer& Buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> Lock(Buffer.EventsMutex);
+    if (Buffer.Events.size() < MaxEventsPerThread)
+    {
+        Buffer.Events.push_back(FTraceEvent{ Name, StartNanoseconds, EndNanoseconds });
+    }
+}
+
+void FMazeTrace::AddCount(EMazeTraceCounter Counter, int64_t Amount)
+{
+    GetThreadBuffer().Counters[int32_t(Counter)].fetch_add(Amount, std::memory_order_relaxed);
+}
+
+int64_t FMazeTrace::GetCount(EMazeTraceCounter Counter)
+{
+    FRegistry& Registry = GetRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+    int64_t Total = 0;
+    for (const std::shared_ptr<FThreadBuffer>& Buffer : Registry.Buffers)
+    {
+        Total += Buffer->Counters[int32_t(Counter)].load(std::memory_order_relaxed);
+    }
+    return Total;
+}
+
+int64_t FMazeTrace::GetNumEvents()
+{
+    FRegistry& Registry = GetRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+    int64_t Total = 0;
+    for (const std::shared_ptr<FThreadBuffer>& Buffer : Registry.Buffers)
+    {
+        std::lock_guard<std::mutex> EventsLock(Buffer->EventsMutex);
+        Total += int64_t(Buffer->Events.size());
+    }
+    return Total;
+}
+
+void FMazeTrace::Reset()
+{
+    FRegistry& Registry = GetRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+    for (const std::shared_ptr<FThreadBuffer>& Buffer : Registry.Buffers)
+    {
+        {
+            std::lock_guard<std::mutex> EventsLock(Buffer->EventsMutex);
+            Buffer->Events.clear();
+        }
+        for (std::atomic<int64_t>& Counter : Buffer->Counters)
+        {
+            Counter.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+std::string FMazeTrace::GetChromeTraceJson()
+{
+    std::string Json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool bFirst = true;
+    uint64_t LastTime = 0;
+    int64_t Totals[NumMazeTraceCounters] = {};
+
+    FRegistry& Registry = GetRegistry();
+    std::lock_guard<std::mutex> Lock(Registry.Mutex);
+    for (const std::shared_ptr<FThreadBuffer>& Buffer : Registry.Buffers)
+    {
+        for (int32_t c = 0; c < NumMazeTraceCounters; ++c)
+        {
+            Totals[c] += Buffer->Counters[c].load(std::memory_order_relaxed);
+        }
+
+        std::lock_guard<std::mutex> EventsLock(Buffer->EventsMutex);
+        for (const FTraceEvent& Event : Buffer->Events)
+        {
+            Json += bFirst ? "{\"name\":" : ",{\"name\":";
+            bFirst = false;
+            AppendJsonString(Json, Event.Name);
+            Json += ",\"ph\":\"X\",\"pid\":1,\"tid\":";
+            Json += std::to_string(Buffer->ThreadId);
+            Json += ",\"ts\":";
+            AppendMicroseconds(Json, Event.Start);
+            Json += ",\"dur\":";
+            AppendMicroseconds(Json, Event.End - Event.Start);
+            Json += '}';
+            LastTime = Event.End > LastTime ? Event.End : LastTime;
+        }
+    }
+
+    // Counters are totals, so a single sample at the end of the trace
+    for (int32_t c = 0; c < NumMazeTraceCounters; ++c)
+    {
+        Json += bFirst ? "{\"name\":" : ",{\"name\":";
+        bFirst = false;
+        AppendJsonString(Json, GetMazeTraceCounterName(EMazeTraceCounter(c)));
+        Json += ",\"ph\":\"C\",\"pid\":1,\"ts\":";
+        AppendMicroseconds(Json, LastTime);
+        Json += ",\"args\":{\"value\":";
+        Json += std::to_string(Totals[c]);
+        Json += "}}";
+    }
+    Json += "]}\n";
+    return Json;
+}
+
+bool FMazeTrace::WriteChromeTrace(const std::string& Path)
+{
+    const std::string Json = GetChromeTraceJson();
+    FILE* File = std::fopen(Path.c_str(), "wb");
+    if (!File)
+    {
+        return false;
+    }
+    const bool bWritten = std::fwrite(Json.data(), 1, Json.size(), File) == Json.size();
+    return std::fclose(File) == 0 && bWritten;
+}
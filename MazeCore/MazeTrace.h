@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Hot-path instrumentation for the generation pipeline: scoped phase timers and a handful of counters, collected
+// per thread and exported as a Chrome trace (chrome://tracing, Perfetto).
+// Everything is compiled in only when MAZE_TRACE_ENABLED is 1 (define it for the whole module); otherwise the
+// macros expand to nothing and the queries below report empty results.
+#ifndef MAZE_TRACE_ENABLED
+#define MAZE_TRACE_ENABLED 0
+#endif
+
+enum class EMazeTraceCounter : uint8_t
+{
+    // Carver moves, forward carves and backtracks together
+    StepsTaken,
+    Backtracks,
+    // Candidate cells tested for being unvisited
+    NeighborChecks,
+    // Time spent blocked on contended locks
+    LockWaitNanoseconds,
+    InstancesSubmitted,
+    Count
+};
+
+constexpr int32_t NumMazeTraceCounters = int32_t(EMazeTraceCounter::Count);
+
+const char* GetMazeTraceCounterName(EMazeTraceCounter Counter);
+
+class FMazeTrace
+{
+public:
+    // Monotonic clock shared by every event
+    static uint64_t GetNanoseconds();
+
+    // Name must outlive the trace (string literals)
+    static void AddEvent(const char* Name, uint64_t StartNanoseconds, uint64_t EndNanoseconds);
+
+    // Lock-free, goes to the calling thread's own slot
+    static void AddCount(EMazeTraceCounter Counter, int64_t Amount);
+
+    // Sum over every thread since the last Reset
+    static int64_t GetCount(EMazeTraceCounter Counter);
+
+    static int64_t GetNumEvents();
+
+    // Drops events and zeroes counters. Threads may keep recording while this runs.
+    static void Reset();
+
+    // Complete events per thread plus one counter sample per counter; false if the file cannot be written
+    static bool WriteChromeTrace(const std::string& Path);
+    static std::string GetChromeTraceJson();
+};
+
+// Records one complete event from construction to destruction
+class FMazeTraceScope
+{
+public:
+    explicit FMazeTraceScope(const char* InName) : Name(InName), Start(FMazeTrace::GetNanoseconds()) {}
+    ~FMazeTraceScope() { FMazeTrace::AddEvent(Name, Start, FMazeTrace::GetNanoseconds()); }
+
+    FMazeTraceScope(const FMazeTraceScope&) = delete;
+    FMazeTraceScope& operator=(const FMazeTraceScope&) = delete;
+
+private:
+    const char* Name;
+    uint64_t Start;
+};
+
+// Locks Lock (std::unique_lock or anything with try_lock/lock). A failed try_lock means contention, and only then
+// is the wait timed and added to LockWaitNanoseconds.
+template <typename LockType>
+void LockMazeTraced(LockType& Lock)
+{
+#if MAZE_TRACE_ENABLED
+    if (Lock.try_lock())
+    {
+        return;
+    }
+    const uint64_t Start = FMazeTrace::GetNanoseconds();
+    Lock.lock();
+    FMazeTrace::AddCount(EMazeTraceCounter::LockWaitNanoseconds, int64_t(FMazeTrace::GetNanoseconds() - Start));
+#else
+    Lock.lock();
+#endif
+}
+
+#define MAZE_TRACE_CONCAT_INNER(A, B) A##B
+#define MAZE_TRACE_CONCAT(A, B) MAZE_TRACE_CONCAT_INNER(A, B)
+
+#if MAZE_TRACE_ENABLED
+#define MAZE_TRACE_SCOPE(Name) const FMazeTraceScope MAZE_TRACE_CONCAT(MazeTraceScope, __LINE__)(Name)
+#define MAZE_TRACE_COUNT(Counter, Amount) FMazeTrace::AddCount(EMazeTraceCounter::Counter, int64_t(Amount))
+#else
+#define MAZE_TRACE_SCOPE(Name) ((void)0)
+#define MAZE_TRACE_COUNT(Counter, Amount) ((void)0)
+#endif
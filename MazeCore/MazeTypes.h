@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Generation parameters, mirroring the properties exposed on AMaze_Runner_Maze
+struct FMazeParams
+{
+    int32_t MazeSize = 20;
+    int32_t StartSize = 10;
+    int32_t NumExits = 1;
+    int32_t NorthSeed = 0;
+    int32_t SouthSeed = 1;
+    int32_t EastSeed = 2;
+    int32_t WestSeed = 3;
+
+    // Seed used for decisions that are not owned by a single carver (exits, stitching)
+    uint64_t GetCombinedSeed() const
+    {
+        return (uint64_t(uint32_t(NorthSeed)) << 32 | uint32_t(SouthSeed)) ^ (uint64_t(uint32_t(EastSeed)) << 16) ^ (uint64_t(uint32_t(WestSeed)) << 48);
+    }
+};
+
+// Single grid cell
+struct FMazeCell
+{
+    int32_t X = 0;
+    int32_t Y = 0;
+};
+
+// Axis aligned rectangle of cells, [X, X + Width) x [Y, Y + Height)
+struct FMazeRect
+{
+    int32_t X = 0;
+    int32_t Y = 0;
+    int32_t Width = 0;
+    int32_t Height = 0;
+
+    bool Contains(int32_t InX, int32_t InY) const { return InX >= X && InX < X + Width && InY >= Y && InY < Y + Height; }
+    bool IsEmpty() const { return Width <= 0 || Height <= 0; }
+};
+
+// Corridor lattice: cells with odd coordinates are rooms of the maze, the cells between them are walls or passages.
+// Lattice cell (I, J) sits at grid cell (2 * I + 1, 2 * J + 1).
+inline int32_t GetLatticeSize(int32_t MazeSize)
+{
+    return std::max((MazeSize - 1) / 2, 0);
+}
+
+// Central starting area as placed by GenerateMaze
+inline FMazeRect GetStartRoom(const FMazeParams& Params)
+{
+    const int32_t Center = Params.MazeSize / 2;
+    const int32_t Start = Center - Params.StartSize / 2;
+    return FMazeRect{ Start, Start, Params.StartSize, Params.StartSize };
+}
+
+// Room grown by at most one cell per side so that it begins and ends on odd coordinates of a Width x Height maze.
+// Corridors then meet it through a single wall cell, which keeps lattice based generators perfect.
+inline FMazeRect AlignRoomToLattice(const FMazeRect& Room, int32_t Width, int32_t Height)
+{
+    if (Room.IsEmpty() || Width < 3 || Height < 3)
+    {
+        return FMazeRect();
+    }
+
+    const int32_t LastX = 2 * GetLatticeSize(Width) - 1;
+    const int32_t LastY = 2 * GetLatticeSize(Height) - 1;
+    const int32_t X0 = std::max(Room.X % 2 != 0 ? Room.X : Room.X - 1, 1);
+    const int32_t Y0 = std::max(Room.Y % 2 != 0 ? Room.Y : Room.Y - 1, 1);
+    const int32_t X1 = std::min((Room.X + Room.Width) % 2 != 0 ? Room.X + Room.Width : Room.X + Room.Width - 1, LastX);
+    const int32_t Y1 = std::min((Room.Y + Room.Height) % 2 != 0 ? Room.Y + Room.Height : Room.Y + Room.Height - 1, LastY);
+    if (X1 < X0 || Y1 < Y0)
+    {
+        return FMazeRect();
+    }
+    return FMazeRect{ X0, Y0, X1 - X0 + 1, Y1 - Y0 + 1 };
+}
+
+// Start room aligned to the corridor lattice
+inline FMazeRect GetLatticeStartRoom(const FMazeParams& Params)
+{
+    return AlignRoomToLattice(GetStartRoom(Params), Params.MazeSize, Params.MazeSize);
+}
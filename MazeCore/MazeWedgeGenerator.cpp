@@ -0,0 +1,145 @@
+#include "MazeWedgeGenerator.h"
+#include "MazeRandom.h"
+#include "MazeThreadPool.h"
+#include "MazeTrace.h"
+
+#include <algorithm>
+#include <variant>
+#include <vector>
+
+namespace
+{
+    bool IsStopped(const std::atomic<bool>* StopFlag)
+    {
+        return StopFlag && StopFlag->load(std::memory_order_relaxed);
+    }
+
+    // Up to StepsPerTurn steps, false once the carver has finished
+    bool StepCarver(TMazeCarver<FMazeWedgeRegion>& Carver, int32_t StepsPerTurn)
+    {
+        // The step loop is instantiated per algorithm, nothing is dispatched inside it
+        return std::visit([StepsPerTurn](auto& Algorithm)
+        {
+            for (int32_t Step = 0; Step < StepsPerTurn; ++Step)
+            {
+                if (!Algorithm.Step())
+                {
+                    return false;
+                }
+            }
+            return true;
+        }, Carver);
+    }
+
+    void CreateExits(const FMazeParams& Params, FMazeBitGrid& Grid)
+    {
+        MAZE_TRACE_SCOPE("MazeWedge.CreateExits");
+        const int32_t Size = Params.MazeSize;
+        std::vector<FMazeCell> PotentialExits;
+        for (int32_t x = 1; x < Size - 1; ++x)
+        {
+            PotentialExits.push_back(FMazeCell{ x, 0 });
+            PotentialExits.push_back(FMazeCell{ x, Size - 1 });
+        }
+        for (int32_t y = 1; y < Size - 1; ++y)
+        {
+            PotentialExits.push_back(FMazeCell{ 0, y });
+            PotentialExits.push_back(FMazeCell{ Size - 1, y });
+        }
+
+        const int32_t NumExits = std::min<int32_t>(std::max(Params.NumExits, 0), int32_t(PotentialExits.size()));
+        for (int32_t i = 0; i < NumExits; ++i)
+        {
+            Grid.ClearWall(PotentialExits[i].X, PotentialExits[i].Y);
+        }
+    }
+}
+
+bool FMazeWedgeGenerator::Generate(const FMazeParams& Params, const FMazeWedgeSettings& Settings, FMazeCarverArena& Arena, FMazeBitGrid& OutGrid, const std::atomic<bool>* StopFlag)
+{
+    MAZE_TRACE_SCOPE("MazeWedge.Generate");
+    const int32_t Size = Params.MazeSize;
+    const FMazeRect Room = GetStartRoom(Params);
+    {
+        MAZE_TRACE_SCOPE("MazeWedge.InitGrid");
+        OutGrid.Init(Size, Size);
+        OutGrid.ClearRect(Room.X, Room.Y, Room.Width, Room.Height);
+    }
+
+    // Each carver starts just outside its side of the start room, opened so it is connected to the room
+    const FMazeCell Starts[NumCarvers] = {
+        { Size / 2, Room.Y - 1 },
+        { Size / 2, Room.Y + Room.Height },
+        { Room.X + Room.Width, Size / 2 },
+        { Room.X - 1, Size / 2 },
+    };
+    const int32_t Seeds[NumCarvers] = { Params.NorthSeed, Params.SouthSeed, Params.EastSeed, Params.WestSeed };
+
+    // Every slice fits the largest wedge
+    size_t StackBound = 0;
+    for (int32_t Carver = 0; Carver < NumCarvers; ++Carver)
+    {
+        const FMazeRect Bounds = FMazeWedgeRegion{ Size, Size, Carver }.GetBounds();
+        StackBound = std::max(StackBound, GetMazeCellStackBound(Bounds.Width, Bounds.Height));
+    }
+    Arena.Reserve(NumCarvers, StackBound);
+
+    // One persistent stream per carver, seeded from that carver's seed and its index
+    std::vector<TMazeCarver<FMazeWedgeRegion>> Carvers;
+    Carvers.reserve(NumCarvers);
+    for (int32_t Carver = 0; Carver < NumCarvers; ++Carver)
+    {
+        OutGrid.Carve(Starts[Carver].X, Starts[Carver].Y);
+        const FMazeXoshiro256 Rng = FMazeXoshiro256::ForStream(uint32_t(Seeds[Carver]), uint32_t(Carver));
+        Carvers.push_back(MakeMazeCarver(Settings.Algorithms[Carver], OutGrid, FMazeWedgeRegion{ Size, Size, Carver }, Starts[Carver], Rng, Arena.GetStack(Carver)));
+    }
+
+    const int32_t StepsPerTurn = std::max(Settings.StepsPerTurn, 1);
+    {
+        MAZE_TRACE_SCOPE("MazeWedge.Carve");
+        if (Settings.Mode == EMazeWedgeMode::Concurrent)
+        {
+            auto RunCarver = [&Carvers, StopFlag, StepsPerTurn](int32_t Carver)
+            {
+                while (!IsStopped(StopFlag) && StepCarver(Carvers[Carver], StepsPerTurn))
+                {
+                }
+            };
+            if (Pool)
+            {
+                Pool->ParallelFor(NumCarvers, RunCarver);
+            }
+            else
+            {
+                for (int32_t Carver = 0; Carver < NumCarvers; ++Carver)
+                {
+                    RunCarver(Carver);
+                }
+            }
+        }
+        else
+        {
+            // Disjoint wedges make the interleaving irrelevant to the result, so turns can be a batch of steps
+            bool bAnyActive = true;
+            while (bAnyActive && !IsStopped(StopFlag))
+            {
+                bAnyActive = false;
+                for (TMazeCarver<FMazeWedgeRegion>& Carver : Carvers)
+                {
+                    bAnyActive |= StepCarver(Carver, StepsPerTurn);
+                }
+            }
+        }
+    }
+    if (IsStopped(StopFlag))
+    {
+        return false;
+    }
+
+    {
+        MAZE_TRACE_SCOPE("MazeWedge.CreatePerimeterWall");
+        OutGrid.SetPerimeterWalls();
+    }
+    CreateExits(Params, OutGrid);
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "MazeBitGrid.h"
+#include "MazeCarverArena.h"
+#include "MazeCarverPolicies.h"
+#include "MazeTypes.h"
+
+#include <atomic>
+#include <cstdint>
+
+class FMazeThreadPool;
+
+// How the four wedge carvers share the grid. Each carver only ever writes its own wedge, so both carve the same maze.
+enum class EMazeWedgeMode : uint8_t
+{
+    // Carvers take turns on the calling thread, a batch of steps per turn
+    RoundRobin,
+    // Each carver runs to completion as its own task on the pool
+    Concurrent
+};
+
+struct FMazeWedgeSettings
+{
+    // Algorithm of each carver: north, south, east, west
+    EMazeCarverAlgorithm Algorithms[4] = {};
+
+    EMazeWedgeMode Mode = EMazeWedgeMode::RoundRobin;
+
+    // Carver steps per turn in RoundRobin, and between checks of the stop flag in both modes
+    int32_t StepsPerTurn = 256;
+};
+
+// The threaded actor's default maze: a central start room with four carvers starting just outside its sides, each
+// carving the wedge of the grid on its side (FMazeWedgeRegion) from its own seed, then the perimeter and the exits.
+// Exits are the first NumExits perimeter cells in scan order (top and bottom row pairs, then the side columns),
+// as the actor has always opened them. Backtracker stacks are slices of the caller's arena, sized for the largest
+// wedge, so a caller that keeps its arena generates again at the same size without allocating for them.
+class FMazeWedgeGenerator
+{
+public:
+    // Pool == nullptr runs Concurrent carvers one after another on the calling thread
+    explicit FMazeWedgeGenerator(FMazeThreadPool* InPool = nullptr) : Pool(InPool) {}
+
+    // False if StopFlag was raised, the grid may then be half carved
+    bool Generate(const FMazeParams& Params, const FMazeWedgeSettings& Settings, FMazeCarverArena& Arena, FMazeBitGrid& OutGrid, const std::atomic<bool>* StopFlag = nullptr);
+
+    static constexpr int32_t NumCarvers = 4;
+
+private:
+    FMazeThreadPool* Pool;
+};
@@ -0,0 +1,211 @@
+// Bakes mazes into the binary format read by FMazeBakedMaze, and inspects baked files.
+//
+// Build: c++ -std=c++20 -O2 -pthread -I.. MazeBake.cpp ../*.cpp -o MazeBake
+// Usage: MazeBake --out file [--size N] [--start N] [--exits N] [--seeds N,S,E,W] [--generator tiled|backtracker|boruvka|wedge]
+//                 [--algorithms N,S,E,W] [--repair] [--tiles] [--distances]
+//        --generator wedge bakes what the threaded actor generates in RoundRobin / Concurrent mode for the same seeds;
+//        --algorithms picks its carver per direction (backtracker, prim, kruskal, wilson), backtracker by default.
+//        --repair joins disconnected parts like the actor does with bRepairConnectivity (its default).
+//        MazeBake --inspect file
+
+#include "MazeBacktrackerGenerator.h"
+#include "MazeBakedMaze.h"
+#include "MazeBoruvkaGenerator.h"
+#include "MazeConnectivity.h"
+#include "MazeThreadPool.h"
+#include "MazeTiledGenerator.h"
+#include "MazeWedgeGenerator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+    double SecondsSince(std::chrono::steady_clock::time_point Start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+    }
+
+    bool ParseAlgorithm(const std::string& Name, EMazeCarverAlgorithm& OutAlgorithm)
+    {
+        const struct
+        {
+            const char* Name;
+            EMazeCarverAlgorithm Algorithm;
+        } Algorithms[] = {
+            { "backtracker", EMazeCarverAlgorithm::Backtracker },
+            { "prim", EMazeCarverAlgorithm::Prim },
+            { "kruskal", EMazeCarverAlgorithm::Kruskal },
+            { "wilson", EMazeCarverAlgorithm::Wilson },
+        };
+        for (const auto& Entry : Algorithms)
+        {
+            if (Name == Entry.Name)
+            {
+                OutAlgorithm = Entry.Algorithm;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Comma separated, one per carver in N, S, E, W order
+    bool ParseAlgorithms(const char* List, FMazeWedgeSettings& OutSettings)
+    {
+        std::string Rest = List;
+        for (int32_t Carver = 0; Carver < FMazeWedgeGenerator::NumCarvers; ++Carver)
+        {
+            const size_t Comma = Rest.find(',');
+            if (!ParseAlgorithm(Rest.substr(0, Comma), OutSettings.Algorithms[Carver]) || (Comma == std::string::npos) != (Carver == FMazeWedgeGenerator::NumCarvers - 1))
+            {
+                return false;
+            }
+            Rest = Comma == std::string::npos ? std::string() : Rest.substr(Comma + 1);
+        }
+        return true;
+    }
+
+    int Bake(const FMazeParams& Params, const std::string& Generator, const FMazeWedgeSettings& Wedge, bool bRepair, const FMazeBakeOptions& Options, const std::string& Path)
+    {
+        FMazeThreadPool& Pool = FMazeThreadPool::GetShared();
+        FMazeBitGrid Grid;
+        FMazeRect StartRoom = GetStartRoom(Params);
+
+        const auto Start = std::chrono::steady_clock::now();
+        if (Generator == "backtracker")
+        {
+            FMazeBacktrackerGenerator().Generate(Params, Grid);
+        }
+        else if (Generator == "wedge")
+        {
+            FMazeCarverArena Arena;
+            FMazeWedgeGenerator(&Pool).Generate(Params, Wedge, Arena, Grid);
+        }
+        else if (Generator == "boruvka")
+        {
+            FMazeBoruvkaGenerator(Pool).Generate(Params, Grid);
+            StartRoom = GetLatticeStartRoom(Params);
+        }
+        else
+        {
+            FMazeTiledGenerator(Pool).Generate(Params, FMazeTiledSettings(), Grid);
+            StartRoom = GetLatticeStartRoom(Params);
+        }
+        if (bRepair)
+        {
+            FMazeConnectivityReport Report;
+            FMazeConnectivityValidator(&Pool).Repair(Grid, StartRoom, Report);
+        }
+        const double GenerateSeconds = SecondsSince(Start);
+
+        const auto WriteStart = std::chrono::steady_clock::now();
+        if (!WriteMazeBakedFile(Path, Params, StartRoom, Grid, Options, &Pool))
+        {
+            std::fprintf(stderr, "Could not write %s\n", Path.c_str());
+            return 1;
+        }
+        std::printf("{\"baked\":\"%s\",\"generator\":\"%s\",\"size\":%d,\"generate_seconds\":%.6f,\"write_seconds\":%.6f}\n",
+            Path.c_str(), Generator.c_str(), Params.MazeSize, GenerateSeconds, SecondsSince(WriteStart));
+        return 0;
+    }
+
+    int Inspect(const std::string& Path)
+    {
+        const auto Start = std::chrono::steady_clock::now();
+        FMazeBakedMaze Baked;
+        if (!Baked.Open(Path))
+        {
+            std::fprintf(stderr, "Could not load %s: %s\n", Path.c_str(), Baked.GetError());
+            return 1;
+        }
+        const double OpenSeconds = SecondsSince(Start);
+
+        const FMazeBakedHeader& Header = Baked.GetHeader();
+        std::printf("{\"file\":\"%s\",\"version\":%u,\"width\":%d,\"height\":%d,\"exits\":%d,\"tiles\":%s,\"distances\":%s,"
+            "\"bytes\":%llu,\"wall_cells\":%lld,\"open_seconds\":%.6f}\n",
+            Path.c_str(), Header.Version, Header.Width, Header.Height, Baked.GetNumExits(), Baked.HasTiles() ? "true" : "false",
+            Baked.HasDistances() ? "true" : "false", (unsigned long long)Header.FileBytes, (long long)Baked.GetWalls().CountWalls(), OpenSeconds);
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    FMazeParams Params;
+    Params.MazeSize = 8193;
+    FMazeBakeOptions Options;
+    std::string Generator = "tiled";
+    FMazeWedgeSettings Wedge;
+    Wedge.Mode = EMazeWedgeMode::Concurrent;
+    bool bRepair = false;
+    std::string OutPath;
+    std::string InspectPath;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool bHasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--tiles") == 0)
+        {
+            Options.bTiles = true;
+        }
+        else if (std::strcmp(argv[i], "--distances") == 0)
+        {
+            Options.bDistances = true;
+        }
+        else if (std::strcmp(argv[i], "--repair") == 0)
+        {
+            bRepair = true;
+        }
+        else if (bHasValue && std::strcmp(argv[i], "--size") == 0)
+        {
+            Params.MazeSize = std::atoi(argv[++i]);
+        }
+        else if (bHasValue && std::strcmp(argv[i], "--start") == 0)
+        {
+            Params.StartSize = std::atoi(argv[++i]);
+        }
+        else if (bHasValue && std::strcmp(argv[i], "--exits") == 0)
+        {
+            Params.NumExits = std::atoi(argv[++i]);
+        }
+        else if (bHasValue && std::strcmp(argv[i], "--seeds") == 0)
+        {
+            std::sscanf(argv[++i], "%d,%d,%d,%d", &Params.NorthSeed, &Params.SouthSeed, &Params.EastSeed, &Params.WestSeed);
+        }
+        else if (bHasValue && std::strcmp(argv[i], "--generator") == 0)
+        {
+            Generator = argv[++i];
+        }
+        else if (bHasValue && std::strcmp(argv[i], "--algorithms") == 0)
+        {
+            if (!ParseAlgorithms(argv[++i], Wedge))
+            {
+                std::fprintf(stderr, "--algorithms takes four of backtracker, prim, kruskal, wilson: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (bHasValue && std::strcmp(argv[i], "--out") == 0)
+        {
+            OutPath = argv[++i];
+        }
+        else if (bHasValue && std::strcmp(argv[i], "--inspect") == 0)
+        {
+            InspectPath = argv[++i];
+        }
+    }
+
+    if (!InspectPath.empty())
+    {
+        return Inspect(InspectPath);
+    }
+    if (OutPath.empty())
+    {
+        std::fprintf(stderr, "Usage: MazeBake --out file [--size N] [--start N] [--exits N] [--seeds N,S,E,W] [--generator tiled|backtracker|boruvka|wedge] [--algorithms N,S,E,W] [--repair] [--tiles] [--distances]\n"
+            "       MazeBake --inspect file\n");
+        return 1;
+    }
+    return Bake(Params, Generator, Wedge, bRepair, Options, OutPath);
+}
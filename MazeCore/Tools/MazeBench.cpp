@@ -0,0 +1,525 @@
+// Headless benchmarks for the MazeCore generators.
+//
+// Build: c++ -std=c++20 -O2 -pthread -I.. MazeBench.cpp ../*.cpp -o MazeBench
+//        (add -DMAZE_TRACE_ENABLED=1 for --trace)
+// Usage: MazeBench [--mode eller|instances|suite|batch] [--width N] [--rows N] [--pbm file]
+//                  [--sizes 20,256,...] [--threads 1,4,...] [--phase-limit N] [--count N] [--trace file.json]
+//
+// The suite runs every generator (backtracker = the actor's sequential CarvePath, stepped = the time-sliced actor's generator,
+// eller, each carver algorithm on the four wedges, tiled and boruvka per thread count) at every size and prints one JSON line per run: cells/second, heap allocations,
+// peak live heap bytes, open cells the start room cannot reach and the time of each phase. Phases after generation (classify, instances) only run up to
+// --phase-limit, their output grows with the maze and gets into the gigabytes past that.
+//
+// Batch mode generates --count mazes cycling through --sizes, once through FMazeBatchGenerator and once one maze
+// after another on the same pool, and prints mazes/second for both per thread count.
+
+#include "MazeBacktrackerGenerator.h"
+#include "MazeBatchGenerator.h"
+#include "MazeBoruvkaGenerator.h"
+#include "MazeConnectivity.h"
+#include "MazeEllerGenerator.h"
+#include "MazeInstanceBuilder.h"
+#include "MazeSteppedGenerator.h"
+#include "MazeThreadPool.h"
+#include "MazeTileClassifier.h"
+#include "MazeTiledGenerator.h"
+#include "MazeTrace.h"
+#include "MazeWedgeGenerator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+// Heap accounting for the suite. Every allocation carries its size in a header so frees can be subtracted. The
+// whole set of global new and delete is replaced (array, nothrow and aligned forms too), so no block is ever freed
+// by a different allocator than the one that made it.
+namespace
+{
+    constexpr size_t AllocHeader = alignof(std::max_align_t);
+
+    std::atomic<int64_t> NumAllocations{ 0 };
+    std::atomic<int64_t> AllocatedBytes{ 0 };
+    std::atomic<int64_t> LiveBytes{ 0 };
+    std::atomic<int64_t> PeakLiveBytes{ 0 };
+
+    // Bytes in front of the block the caller gets; its size is stored in the last AllocHeader of them
+    size_t GetHeaderBytes(size_t Alignment)
+    {
+        return std::max(Alignment, AllocHeader);
+    }
+
+    // nullptr when out of memory
+    void* AllocateCounted(size_t Size, size_t Alignment) noexcept
+    {
+        const size_t Header = GetHeaderBytes(Alignment);
+        void* Block = nullptr;
+        if (Alignment <= AllocHeader)
+        {
+            Block = std::malloc(Size + Header);
+        }
+        else
+        {
+#if defined(_WIN32)
+            Block = _aligned_malloc(Size + Header, Alignment);
+#else
+            Block = std::aligned_alloc(Alignment, (Size + Header + Alignment - 1) / Alignment * Alignment);
+#endif
+        }
+        if (!Block)
+        {
+            return nullptr;
+        }
+        char* Ptr = static_cast<char*>(Block) + Header;
+        *reinterpret_cast<size_t*>(Ptr - AllocHeader) = Size;
+
+        NumAllocations.fetch_add(1, std::memory_order_relaxed);
+        AllocatedBytes.fetch_add(int64_t(Size), std::memory_order_relaxed);
+        const int64_t Live = LiveBytes.fetch_add(int64_t(Size), std::memory_order_relaxed) + int64_t(Size);
+        int64_t Peak = PeakLiveBytes.load(std::memory_order_relaxed);
+        while (Live > Peak && !PeakLiveBytes.compare_exchange_weak(Peak, Live, std::memory_order_relaxed))
+        {
+        }
+        return Ptr;
+    }
+
+    void FreeCounted(void* Ptr, size_t Alignment) noexcept
+    {
+        if (!Ptr)
+        {
+            return;
+        }
+        char* Bytes = static_cast<char*>(Ptr);
+        LiveBytes.fetch_sub(int64_t(*reinterpret_cast<size_t*>(Bytes - AllocHeader)), std::memory_order_relaxed);
+        void* Block = Bytes - GetHeaderBytes(Alignment);
+#if defined(_WIN32)
+        if (Alignment > AllocHeader)
+        {
+            _aligned_free(Block);
+            return;
+        }
+#endif
+        std::free(Block);
+    }
+
+    void* AllocateOrThrow(size_t Size, size_t Alignment)
+    {
+        void* Ptr = AllocateCounted(Size, Alignment);
+        if (!Ptr)
+        {
+            throw std::bad_alloc();
+        }
+        return Ptr;
+    }
+}
+
+void* operator new(size_t Size) { return AllocateOrThrow(Size, AllocHeader); }
+void* operator new[](size_t Size) { return AllocateOrThrow(Size, AllocHeader); }
+void* operator new(size_t Size, const std::nothrow_t&) noexcept { return AllocateCounted(Size, AllocHeader); }
+void* operator new[](size_t Size, const std::nothrow_t&) noexcept { return AllocateCounted(Size, AllocHeader); }
+void* operator new(size_t Size, std::align_val_t Alignment) { return AllocateOrThrow(Size, size_t(Alignment)); }
+void* operator new[](size_t Size, std::align_val_t Alignment) { return AllocateOrThrow(Size, size_t(Alignment)); }
+void* operator new(size_t Size, std::align_val_t Alignment, const std::nothrow_t&) noexcept { return AllocateCounted(Size, size_t(Alignment)); }
+void* operator new[](size_t Size, std::align_val_t Alignment, const std::nothrow_t&) noexcept { return AllocateCounted(Size, size_t(Alignment)); }
+
+void operator delete(void* Ptr) noexcept { FreeCounted(Ptr, AllocHeader); }
+void operator delete[](void* Ptr) noexcept { FreeCounted(Ptr, AllocHeader); }
+void operator delete(void* Ptr, size_t) noexcept { FreeCounted(Ptr, AllocHeader); }
+void operator delete[](void* Ptr, size_t) noexcept { FreeCounted(Ptr, AllocHeader); }
+void operator delete(void* Ptr, const std::nothrow_t&) noexcept { FreeCounted(Ptr, AllocHeader); }
+void operator delete[](void* Ptr, const std::nothrow_t&) noexcept { FreeCounted(Ptr, AllocHeader); }
+void operator delete(void* Ptr, std::align_val_t Alignment) noexcept { FreeCounted(Ptr, size_t(Alignment)); }
+void operator delete[](void* Ptr, std::align_val_t Alignment) noexcept { FreeCounted(Ptr, size_t(Alignment)); }
+void operator delete(void* Ptr, size_t, std::align_val_t Alignment) noexcept { FreeCounted(Ptr, size_t(Alignment)); }
+void operator delete[](void* Ptr, size_t, std::align_val_t Alignment) noexcept { FreeCounted(Ptr, size_t(Alignment)); }
+void operator delete(void* Ptr, std::align_val_t Alignment, const std::nothrow_t&) noexcept { FreeCounted(Ptr, size_t(Alignment)); }
+void operator delete[](void* Ptr, std::align_val_t Alignment, const std::nothrow_t&) noexcept { FreeCounted(Ptr, size_t(Alignment)); }
+
+namespace
+{
+    // Discards rows, so only generation is measured
+    class FNullRowSink : public IMazeRowSink
+    {
+    public:
+        virtual void WriteRow(int32_t /*Y*/, const uint64_t* WallBits) override { LastWord ^= WallBits[0]; }
+        uint64_t LastWord = 0;
+    };
+
+    void RunEllerBenchmark(int32_t Width, int32_t Rows, const std::string& PbmPath)
+    {
+        FMazeParams Params;
+        Params.MazeSize = Width;
+
+        FMazeEllerGenerator Generator;
+        FNullRowSink NullSink;
+        FMazePbmRowSink PbmSink(PbmPath);
+        IMazeRowSink& Sink = PbmPath.empty() ? static_cast<IMazeRowSink&>(NullSink) : PbmSink;
+
+        const auto Start = std::chrono::steady_clock::now();
+        Generator.Generate(Params, Rows, FMazeEllerSettings(), Sink);
+        const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+        std::printf("{\"generator\":\"eller\",\"width\":%d,\"rows\":%d,\"seconds\":%.6f,\"rows_per_second\":%.1f}\n",
+            Width, Rows, Seconds, Rows / Seconds);
+    }
+
+    // Wall instance locations for a Width x Width maze, the buffer the engine submits in one batch
+    void RunInstanceBenchmark(int32_t Width)
+    {
+        FMazeParams Params;
+        Params.MazeSize = Width;
+
+        FMazeBitGrid Grid;
+        FMazeTiledGenerator(FMazeThreadPool::GetShared()).Generate(Params, FMazeTiledSettings(), Grid);
+
+        std::vector<FMazeInstanceLocation> Locations;
+        const FMazeInstanceBuilder Builder(&FMazeThreadPool::GetShared());
+        const auto Start = std::chrono::steady_clock::now();
+        Builder.BuildWallLocations(Grid, FMazeInstanceBuilder::GetCenteredLayout(Grid, 100.0f), Locations);
+        const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+
+        std::printf("{\"generator\":\"instances\",\"width\":%d,\"instances\":%zu,\"seconds\":%.6f,\"instances_per_second\":%.1f}\n",
+            Width, Locations.size(), Seconds, Locations.size() / Seconds);
+
+        std::vector<FMazeInstanceBox> Boxes;
+        FMazeWallMergeStats Stats;
+        const auto MergeStart = std::chrono::steady_clock::now();
+        Builder.BuildMergedWallBoxes(Grid, FMazeInstanceBuilder::GetCenteredLayout(Grid, 100.0f), Boxes, &Stats);
+        const double MergeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - MergeStart).count();
+
+        std::printf("{\"generator\":\"merged_instances\",\"width\":%d,\"wall_cells\":%lld,\"instances\":%lld,\"reduction\":%.4f,\"seconds\":%.6f}\n",
+            Width, (long long)Stats.WallCells, (long long)Stats.Instances, Stats.GetReduction(), MergeSeconds);
+    }
+
+    // Heap counters relative to the start of one run
+    struct FHeapScope
+    {
+        int64_t Allocations0 = NumAllocations.load();
+        int64_t Bytes0 = AllocatedBytes.load();
+        int64_t Live0 = LiveBytes.load();
+
+        FHeapScope() { PeakLiveBytes.store(Live0); }
+
+        int64_t GetAllocations() const { return NumAllocations.load() - Allocations0; }
+        int64_t GetBytes() const { return AllocatedBytes.load() - Bytes0; }
+        int64_t GetPeakBytes() const { return PeakLiveBytes.load() - Live0; }
+    };
+
+    double SecondsSince(std::chrono::steady_clock::time_point Start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+    }
+
+    std::vector<int32_t> ParseList(const char* Text)
+    {
+        std::vector<int32_t> Values;
+        for (const char* It = Text; *It;)
+        {
+            char* End = nullptr;
+            const long Value = std::strtol(It, &End, 10);
+            if (End == It)
+            {
+                break;
+            }
+            if (Value > 0)
+            {
+                Values.push_back(int32_t(Value));
+            }
+            It = *End == ',' ? End + 1 : End;
+        }
+        return Values;
+    }
+
+    struct FSuiteRun
+    {
+        const char* Generator = "";
+        int32_t Size = 0;
+        int32_t Threads = 1;
+        double GenerateSeconds = 0.0;
+        double ValidateSeconds = -1.0;
+        int64_t UnreachableCells = 0;
+        double ClassifySeconds = -1.0;
+        double InstanceSeconds = -1.0;
+    };
+
+    void PrintSuiteRun(const FSuiteRun& Run, const FHeapScope& Heap)
+    {
+        const double Cells = double(Run.Size) * double(Run.Size);
+        std::printf("{\"suite\":\"generation\",\"generator\":\"%s\",\"size\":%d,\"threads\":%d,\"cells_per_second\":%.1f,"
+            "\"allocations\":%lld,\"allocated_bytes\":%lld,\"peak_heap_bytes\":%lld,\"unreachable_cells\":%lld,"
+            "\"phases\":{\"generate\":%.6f,\"validate\":%.6f,\"classify\":%.6f,\"instances\":%.6f}}\n",
+            Run.Generator, Run.Size, Run.Threads, Cells / std::max(Run.GenerateSeconds, 1e-9),
+            (long long)Heap.GetAllocations(), (long long)Heap.GetBytes(), (long long)Heap.GetPeakBytes(), (long long)Run.UnreachableCells,
+            Run.GenerateSeconds, Run.ValidateSeconds, Run.ClassifySeconds, Run.InstanceSeconds);
+        std::fflush(stdout);
+    }
+
+    // Downstream phases every grid goes through in the actors; -1 marks a skipped phase. Validation runs at every
+    // size, its memory follows the open runs rather than the output.
+    void RunGridPhases(const FMazeBitGrid& Grid, const FMazeParams& Params, FMazeThreadPool* Pool, int32_t PhaseLimit, FSuiteRun& Run)
+    {
+        auto Start = std::chrono::steady_clock::now();
+        FMazeConnectivityReport Report;
+        FMazeConnectivityValidator(Pool).Validate(Grid, GetStartRoom(Params), Report);
+        Run.ValidateSeconds = SecondsSince(Start);
+        Run.UnreachableCells = Report.UnreachableCells;
+
+        if (Run.Size > PhaseLimit)
+        {
+            return;
+        }
+
+        Start = std::chrono::steady_clock::now();
+        FMazeTileArrays Tiles;
+        FMazeTileClassifier(Pool).Classify(Grid, Tiles);
+        Run.ClassifySeconds = SecondsSince(Start);
+
+        Start = std::chrono::steady_clock::now();
+        std::vector<FMazeInstanceLocation> Locations;
+        FMazeInstanceBuilder(Pool).BuildWallLocations(Grid, FMazeInstanceBuilder::GetCenteredLayout(Grid, 100.0f), Locations);
+        Run.InstanceSeconds = SecondsSince(Start);
+    }
+
+    void RunSuite(const std::vector<int32_t>& Sizes, const std::vector<int32_t>& ThreadCounts, int32_t PhaseLimit)
+    {
+        FMazeCarverArena WedgeArena;
+        for (int32_t Size : Sizes)
+        {
+            FMazeParams Params;
+            Params.MazeSize = Size;
+            Params.StartSize = std::min(Params.StartSize, std::max(Size / 4, 1));
+
+            {
+                const FHeapScope Heap;
+                FSuiteRun Run{ "backtracker", Size };
+                FMazeBitGrid Grid;
+                const auto Start = std::chrono::steady_clock::now();
+                FMazeBacktrackerGenerator().Generate(Params, Grid);
+                Run.GenerateSeconds = SecondsSince(Start);
+                RunGridPhases(Grid, Params, nullptr, PhaseLimit, Run);
+                PrintSuiteRun(Run, Heap);
+            }
+
+            {
+                // Same batch size the time-sliced actor gets through in a typical frame budget
+                const FHeapScope Heap;
+                FSuiteRun Run{ "stepped", Size };
+                FMazeSteppedGenerator Generator;
+                std::vector<FMazeRevealedCell> Revealed;
+                const auto Start = std::chrono::steady_clock::now();
+                Generator.Begin(Params);
+                while (!Generator.IsDone())
+                {
+                    Generator.Step(4096);
+                    Generator.ConsumeRevealed(Revealed);
+                }
+                Run.GenerateSeconds = SecondsSince(Start);
+                RunGridPhases(Generator.GetGrid(), Params, nullptr, PhaseLimit, Run);
+                PrintSuiteRun(Run, Heap);
+            }
+
+            {
+                const FHeapScope Heap;
+                FSuiteRun Run{ "eller", Size };
+                FNullRowSink Sink;
+                const auto Start = std::chrono::steady_clock::now();
+                FMazeEllerGenerator().Generate(Params, 0, FMazeEllerSettings(), Sink);
+                Run.GenerateSeconds = SecondsSince(Start);
+                PrintSuiteRun(Run, Heap);
+            }
+
+            const struct
+            {
+                const char* Name;
+                EMazeCarverAlgorithm Algorithm;
+            } Carvers[] = {
+                { "wedge-backtracker", EMazeCarverAlgorithm::Backtracker },
+                { "wedge-prim", EMazeCarverAlgorithm::Prim },
+                { "wedge-kruskal", EMazeCarverAlgorithm::Kruskal },
+                { "wedge-wilson", EMazeCarverAlgorithm::Wilson },
+            };
+            for (const auto& Carver : Carvers)
+            {
+                // The threaded actor's Concurrent mode with one algorithm on all four wedges. The arena outlives
+                // the runs like the generation service's do, so only the first run at a size pays for the stacks.
+                FMazeWedgeSettings Settings;
+                std::fill(std::begin(Settings.Algorithms), std::end(Settings.Algorithms), Carver.Algorithm);
+                Settings.Mode = EMazeWedgeMode::Concurrent;
+                // Four carvers, so more threads than that change nothing
+                FMazeThreadPool Pool(std::min(ThreadCounts.back(), 4));
+                const FHeapScope Heap;
+                FSuiteRun Run{ Carver.Name, Size, Pool.GetNumThreads() };
+                FMazeBitGrid Grid;
+                const auto Start = std::chrono::steady_clock::now();
+                FMazeWedgeGenerator(&Pool).Generate(Params, Settings, WedgeArena, Grid);
+                Run.GenerateSeconds = SecondsSince(Start);
+                RunGridPhases(Grid, Params, &Pool, PhaseLimit, Run);
+                PrintSuiteRun(Run, Heap);
+            }
+
+            for (int32_t Threads : ThreadCounts)
+            {
+                FMazeThreadPool Pool(Threads);
+                const FHeapScope Heap;
+                FSuiteRun Run{ "tiled", Size, Threads };
+                FMazeBitGrid Grid;
+                const auto Start = std::chrono::steady_clock::now();
+                FMazeTiledGenerator(Pool).Generate(Params, FMazeTiledSettings(), Grid);
+                Run.GenerateSeconds = SecondsSince(Start);
+                RunGridPhases(Grid, Params, &Pool, PhaseLimit, Run);
+                PrintSuiteRun(Run, Heap);
+            }
+
+            for (int32_t Threads : ThreadCounts)
+            {
+                FMazeThreadPool Pool(Threads);
+                const FHeapScope Heap;
+                FSuiteRun Run{ "boruvka", Size, Threads };
+                FMazeBitGrid Grid;
+                const auto Start = std::chrono::steady_clock::now();
+                FMazeBoruvkaGenerator(Pool).Generate(Params, Grid);
+                Run.GenerateSeconds = SecondsSince(Start);
+                RunGridPhases(Grid, Params, &Pool, PhaseLimit, Run);
+                PrintSuiteRun(Run, Heap);
+            }
+        }
+    }
+
+    void RunBatchBenchmark(const std::vector<int32_t>& Sizes, const std::vector<int32_t>& ThreadCounts, int32_t Count)
+    {
+        std::vector<FMazeParams> Jobs(Count);
+        int64_t TotalCells = 0;
+        for (int32_t i = 0; i < Count; ++i)
+        {
+            FMazeParams& Params = Jobs[i];
+            Params.MazeSize = Sizes[i % Sizes.size()];
+            Params.StartSize = std::min(Params.StartSize, std::max(Params.MazeSize / 4, 1));
+            Params.NorthSeed = i;
+            TotalCells += int64_t(Params.MazeSize) * Params.MazeSize;
+        }
+
+        for (int32_t Threads : ThreadCounts)
+        {
+            FMazeThreadPool Pool(Threads);
+
+            std::atomic<int64_t> WallCells{ 0 };
+            auto Start = std::chrono::steady_clock::now();
+            FMazeBatchGenerator(Pool).Generate(Jobs, FMazeBatchSettings(), [&WallCells](int32_t, const FMazeBitGrid& Grid)
+            {
+                WallCells += Grid.CountWalls();
+            });
+            const double BatchSeconds = SecondsSince(Start);
+
+            Start = std::chrono::steady_clock::now();
+            FMazeBitGrid Grid;
+            for (const FMazeParams& Params : Jobs)
+            {
+                FMazeTiledGenerator(Pool).Generate(Params, FMazeTiledSettings(), Grid);
+            }
+            const double SerialSeconds = SecondsSince(Start);
+
+            std::printf("{\"suite\":\"batch\",\"threads\":%d,\"mazes\":%d,\"cells\":%lld,\"wall_cells\":%lld,"
+                "\"mazes_per_second\":%.1f,\"one_at_a_time_mazes_per_second\":%.1f}\n",
+                Threads, Count, (long long)TotalCells, (long long)WallCells.load(), Count / std::max(BatchSeconds, 1e-9), Count / std::max(SerialSeconds, 1e-9));
+            std::fflush(stdout);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int32_t Width = 4096;
+    int32_t Rows = 100000;
+    std::string PbmPath;
+    std::string Mode = "eller";
+    std::vector<int32_t> Sizes = { 20, 256, 1024, 4096, 16384 };
+    std::vector<int32_t> ThreadCounts = { 1, FMazeThreadPool::GetShared().GetNumThreads() };
+    int32_t PhaseLimit = 4096;
+    int32_t Count = 256;
+    bool bSizesGiven = false;
+    std::string TracePath;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--width") == 0)
+        {
+            Width = std::atoi(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--rows") == 0)
+        {
+            Rows = std::atoi(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--mode") == 0)
+        {
+            Mode = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--pbm") == 0)
+        {
+            PbmPath = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--sizes") == 0)
+        {
+            Sizes = ParseList(argv[i + 1]);
+            bSizesGiven = true;
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0)
+        {
+            ThreadCounts = ParseList(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--phase-limit") == 0)
+        {
+            PhaseLimit = std::atoi(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--count") == 0)
+        {
+            Count = std::max(std::atoi(argv[i + 1]), 1);
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0)
+        {
+            TracePath = argv[i + 1];
+        }
+    }
+
+    if (Mode == "suite")
+    {
+        ThreadCounts.erase(std::unique(ThreadCounts.begin(), ThreadCounts.end()), ThreadCounts.end());
+        RunSuite(Sizes, ThreadCounts, PhaseLimit);
+    }
+    else if (Mode == "batch")
+    {
+        // A matchmaking pool: mostly small mazes with a few large ones
+        if (!bSizesGiven)
+        {
+            Sizes = { 21, 21, 21, 65, 65, 257, 1025 };
+        }
+        ThreadCounts.erase(std::unique(ThreadCounts.begin(), ThreadCounts.end()), ThreadCounts.end());
+        RunBatchBenchmark(Sizes, ThreadCounts, Count);
+    }
+    else if (Mode == "instances")
+    {
+        RunInstanceBenchmark(Width);
+    }
+    else
+    {
+        RunEllerBenchmark(Width, Rows, PbmPath);
+    }
+
+    if (!TracePath.empty())
+    {
+        if (!MAZE_TRACE_ENABLED)
+        {
+            std::fprintf(stderr, "--trace needs a build with -DMAZE_TRACE_ENABLED=1\n");
+        }
+        else if (!FMazeTrace::WriteChromeTrace(TracePath))
+        {
+            std::fprintf(stderr, "Could not write %s\n", TracePath.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
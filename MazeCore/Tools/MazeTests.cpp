@@ -0,0 +1,529 @@
+// Regression checks for the MazeCore generators and file formats. Prints one line per failed check and exits
+// non-zero if there was any, so it can gate a build.
+//
+// Build: c++ -std=c++20 -O2 -pthread -I.. MazeTests.cpp ../*.cpp -o MazeTests
+//        (adding -fsanitize=thread or -fsanitize=address,undefined is worth it after touching the concurrent code)
+// Usage: MazeTests [--scratch dir]
+//
+// - every generator yields a maze whose open cells are all reachable from the start room, and the lattice
+//   generators a perfect one (no loops once the start room is counted as a single cell)
+// - the tiled, Borůvka and batch generators, the flow field and the connectivity labelling give the same result
+//   whatever the number of threads
+// - a baked file reads back exactly what was written, and a corrupted one is rejected
+// - path queries return shortest paths through open cells
+// - the disk cache only hits on an entry written for the same key, and sweeps temp files left by dead stores
+
+#include "MazeBacktrackerGenerator.h"
+#include "MazeBakedMaze.h"
+#include "MazeBatchGenerator.h"
+#include "MazeBoruvkaGenerator.h"
+#include "MazeConnectivity.h"
+#include "MazeDiskCache.h"
+#include "MazeFlowField.h"
+#include "MazePathQueryService.h"
+#include "MazeRegionRegenerator.h"
+#include "MazeSteppedGenerator.h"
+#include "MazeThreadPool.h"
+#include "MazeTileClassifier.h"
+#include "MazeTiledGenerator.h"
+#include "MazeWedgeGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    int32_t NumFailures = 0;
+
+    void Check(bool bPassed, const char* What, int32_t Size)
+    {
+        if (!bPassed)
+        {
+            std::printf("FAILED: %s (size %d)\n", What, Size);
+            ++NumFailures;
+        }
+    }
+
+    FMazeParams MakeParams(int32_t Size, int32_t Seed)
+    {
+        FMazeParams Params;
+        Params.MazeSize = Size;
+        Params.StartSize = std::min(Params.StartSize, std::max(Size / 4, 1));
+        Params.NumExits = 3;
+        Params.NorthSeed = Seed;
+        Params.SouthSeed = Seed * 3 + 1;
+        Params.EastSeed = Seed * 5 + 2;
+        Params.WestSeed = Seed * 7 + 3;
+        return Params;
+    }
+
+    bool SameWalls(const FMazeBitGrid& A, const FMazeBitGrid& B)
+    {
+        if (A.GetWidth() != B.GetWidth() || A.GetHeight() != B.GetHeight())
+        {
+            return false;
+        }
+        for (int32_t y = 0; y < A.GetHeight(); ++y)
+        {
+            if (std::memcmp(A.GetWallRow(y), B.GetWallRow(y), size_t(A.GetWordsPerRow()) * sizeof(uint64_t)) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Open-cell edges that close a loop, with every open cell of Room merged into one node up front
+    int64_t CountLoops(const FMazeBitGrid& Grid, const FMazeRect& Room)
+    {
+        const int32_t Width = Grid.GetWidth();
+        const int32_t Height = Grid.GetHeight();
+        std::vector<int32_t> Parents(size_t(Width) * Height);
+        std::iota(Parents.begin(), Parents.end(), 0);
+        auto Find = [&Parents](int32_t Node)
+        {
+            while (Parents[Node] != Node)
+            {
+                Parents[Node] = Parents[Parents[Node]];
+                Node = Parents[Node];
+            }
+            return Node;
+        };
+
+        int32_t RoomNode = -1;
+        for (int32_t y = 0; y < Height; ++y)
+        {
+            for (int32_t x = 0; x < Width; ++x)
+            {
+                if (!Grid.IsWall(x, y) && Room.Contains(x, y))
+                {
+                    const int32_t Node = y * Width + x;
+                    if (RoomNode < 0)
+                    {
+                        RoomNode = Node;
+                    }
+                    Parents[Node] = RoomNode;
+                }
+            }
+        }
+
+        int64_t Loops = 0;
+        for (int32_t y = 0; y < Height; ++y)
+        {
+            for (int32_t x = 0; x < Width; ++x)
+            {
+                if (Grid.IsWall(x, y))
+                {
+                    continue;
+                }
+                const FMazeCell Neighbors[2] = { { x + 1, y }, { x, y + 1 } };
+                for (const FMazeCell& Next : Neighbors)
+                {
+                    if (Next.X >= Width || Next.Y >= Height || Grid.IsWall(Next.X, Next.Y) || (Room.Contains(x, y) && Room.Contains(Next.X, Next.Y)))
+                    {
+                        continue;
+                    }
+                    const int32_t A = Find(y * Width + x);
+                    const int32_t B = Find(Next.Y * Width + Next.X);
+                    if (A == B)
+                    {
+                        ++Loops;
+                    }
+                    else
+                    {
+                        Parents[B] = A;
+                    }
+                }
+            }
+        }
+        return Loops;
+    }
+
+    // The backtracker places exits like the actor does, on any perimeter cell, so some of them may open onto a
+    // wall; everything else has to be reachable
+    void CheckReachable(const FMazeBitGrid& Grid, const FMazeParams& Params, const FMazeRect& Room, bool bExitsMayBeDead, const char* What)
+    {
+        FMazeConnectivityReport Report;
+        FMazeConnectivityValidator().Validate(Grid, Room, Report);
+        const int64_t Stranded = bExitsMayBeDead ? int64_t(Report.DeadExits.size()) : 0;
+        Check(Report.UnreachableCells == Stranded && (bExitsMayBeDead || Report.DeadExits.empty()), What, Params.MazeSize);
+        Check(Report.NumExits == Params.NumExits, What, Params.MazeSize);
+        Check(bExitsMayBeDead || Report.IsValid(Params.NumExits), What, Params.MazeSize);
+    }
+
+    void TestConnectivity(FMazeThreadPool& Pool)
+    {
+        for (int32_t Size : { 21, 64, 129, 257 })
+        {
+            for (int32_t Seed = 1; Seed <= 3; ++Seed)
+            {
+                // Mazes without exits are valid too
+                FMazeParams Params = MakeParams(Size, Seed);
+                Params.NumExits = Seed - 1;
+                FMazeBitGrid Grid;
+
+                FMazeBacktrackerGenerator().Generate(Params, Grid);
+                CheckReachable(Grid, Params, GetStartRoom(Params), true, "backtracker reaches every cell");
+
+                FMazeSteppedGenerator Stepped;
+                Stepped.Begin(Params);
+                while (!Stepped.IsDone())
+                {
+                    Stepped.Step(1000);
+                }
+                CheckReachable(Stepped.GetGrid(), Params, GetStartRoom(Params), true, "stepped reaches every cell");
+
+                FMazeTiledGenerator(Pool).Generate(Params, FMazeTiledSettings(), Grid);
+                CheckReachable(Grid, Params, GetLatticeStartRoom(Params), false, "tiled reaches every cell and exit");
+                Check(CountLoops(Grid, GetLatticeStartRoom(Params)) == 0, "tiled maze is perfect", Size);
+
+                FMazeBoruvkaGenerator(Pool).Generate(Params, Grid);
+                CheckReachable(Grid, Params, GetLatticeStartRoom(Params), false, "boruvka reaches every cell and exit");
+                Check(CountLoops(Grid, GetLatticeStartRoom(Params)) == 0, "boruvka maze is perfect", Size);
+
+                // A regenerated region keeps the maze perfect and connected
+                FMazeRegionChange Change;
+                FMazeRegionRegenerator().Regenerate(Grid, FMazeRect{ Size / 5, Size / 3, Size / 2, Size / 3 }, uint64_t(Seed), Change);
+                Check(CountLoops(Grid, GetLatticeStartRoom(Params)) == 0, "regenerated region keeps the maze perfect", Size);
+                FMazeConnectivityReport Report;
+                FMazeConnectivityValidator().Validate(Grid, GetLatticeStartRoom(Params), Report);
+                Check(Report.UnreachableCells == 0, "regenerated region keeps the maze connected", Size);
+
+                // The actor's default mode, with every algorithm on every wedge over the four rounds. Exits are
+                // the first perimeter cells and may open onto a wall. RoundRobin has to carve what Concurrent does.
+                FMazeCarverArena Arena;
+                for (int32_t Round = 0; Round < 4; ++Round)
+                {
+                    FMazeWedgeSettings Settings;
+                    for (int32_t Carver = 0; Carver < FMazeWedgeGenerator::NumCarvers; ++Carver)
+                    {
+                        Settings.Algorithms[Carver] = EMazeCarverAlgorithm((Round + Carver) % 4);
+                    }
+                    Settings.Mode = EMazeWedgeMode::Concurrent;
+                    FMazeWedgeGenerator(&Pool).Generate(Params, Settings, Arena, Grid);
+                    CheckReachable(Grid, Params, GetStartRoom(Params), true, "wedge carvers reach every cell");
+
+                    FMazeBitGrid RoundRobin;
+                    Settings.Mode = EMazeWedgeMode::RoundRobin;
+                    Settings.StepsPerTurn = 7;
+                    FMazeWedgeGenerator().Generate(Params, Settings, Arena, RoundRobin);
+                    Check(SameWalls(RoundRobin, Grid), "wedge carver modes carve the same maze", Size);
+                }
+            }
+        }
+    }
+
+    void TestThreadCounts()
+    {
+        FMazeThreadPool Pools[] = { FMazeThreadPool(1), FMazeThreadPool(2), FMazeThreadPool(5) };
+        for (int32_t Size : { 33, 200, 513 })
+        {
+            const FMazeParams Params = MakeParams(Size, Size);
+            FMazeBitGrid TiledReference;
+            FMazeBitGrid BoruvkaReference;
+            FMazeTiledSettings Tiled;
+            Tiled.TileCells = 16;
+            FMazeTiledGenerator(Pools[0]).Generate(Params, Tiled, TiledReference);
+            FMazeBoruvkaGenerator(Pools[0]).Generate(Params, BoruvkaReference);
+
+            FMazeFlowField FieldReference;
+            FieldReference.Build(TiledReference, GetMazeExitCells(TiledReference));
+            FMazeConnectivityReport ReportReference;
+            FMazeConnectivityValidator().Validate(BoruvkaReference, GetLatticeStartRoom(Params), ReportReference);
+
+            for (FMazeThreadPool& Pool : Pools)
+            {
+                FMazeBitGrid Grid;
+                FMazeTiledGenerator(Pool).Generate(Params, Tiled, Grid);
+                Check(SameWalls(Grid, TiledReference), "tiled output does not depend on the thread count", Size);
+                FMazeBoruvkaGenerator(Pool).Generate(Params, Grid);
+                Check(SameWalls(Grid, BoruvkaReference), "boruvka output does not depend on the thread count", Size);
+
+                FMazeFlowField Field;
+                Field.Build(TiledReference, GetMazeExitCells(TiledReference), &Pool);
+                bool bSameField = Field.GetMaxDistance() == FieldReference.GetMaxDistance();
+                for (int32_t y = 0; y < Size && bSameField; ++y)
+                {
+                    for (int32_t x = 0; x < Size && bSameField; ++x)
+                    {
+                        bSameField = Field.GetDistance(x, y) == FieldReference.GetDistance(x, y)
+                            && (!Field.IsReachable(x, y) || Field.GetDirection(x, y) == FieldReference.GetDirection(x, y));
+                    }
+                }
+                Check(bSameField, "flow field does not depend on the thread count", Size);
+
+                FMazeConnectivityReport Report;
+                FMazeConnectivityValidator(&Pool).Validate(BoruvkaReference, GetLatticeStartRoom(Params), Report);
+                Check(Report.NumComponents == ReportReference.NumComponents && Report.OpenCells == ReportReference.OpenCells, "connectivity labels do not depend on the thread count", Size);
+            }
+        }
+
+        // A batch builds the same mazes as the tiled generator on its own, in any completion order
+        std::vector<FMazeParams> Jobs;
+        for (int32_t Size : { 17, 65, 33, 300, 9, 129 })
+        {
+            Jobs.push_back(MakeParams(Size, Size + 1));
+        }
+        FMazeBatchSettings Batch;
+        Batch.CellsPerTask = 4096;
+        for (FMazeThreadPool& Pool : Pools)
+        {
+            std::vector<FMazeBitGrid> Grids(Jobs.size());
+            FMazeBatchGenerator(Pool).Generate(Jobs, Batch, [&Grids](int32_t JobIndex, const FMazeBitGrid& Grid) { Grids[JobIndex] = Grid; });
+            for (size_t i = 0; i < Jobs.size(); ++i)
+            {
+                FMazeBitGrid Reference;
+                FMazeTiledGenerator(Pools[0]).Generate(Jobs[i], Batch.Tiled, Reference);
+                Check(SameWalls(Grids[i], Reference), "batch output matches the tiled generator", Jobs[i].MazeSize);
+            }
+        }
+    }
+
+    void TestBakedRoundTrip(FMazeThreadPool& Pool, const std::string& Scratch)
+    {
+        const std::string Path = Scratch + "/MazeTests.maze";
+        for (int32_t Size : { 7, 100, 301 })
+        {
+            const FMazeParams Params = MakeParams(Size, 11);
+            FMazeBitGrid Grid;
+            FMazeTiledGenerator(Pool).Generate(Params, FMazeTiledSettings(), Grid);
+            FMazeBakeOptions Options;
+            Options.bTiles = true;
+            Options.bDistances = true;
+            const FMazeRect Room = GetLatticeStartRoom(Params);
+            if (!WriteMazeBakedFile(Path, Params, Room, Grid, Options, &Pool))
+            {
+                Check(false, "baked file can be written", Size);
+                return;
+            }
+
+            {
+                FMazeBakedMaze Baked;
+                Check(Baked.Open(Path), "baked file opens", Size);
+                if (!Baked.IsOpen())
+                {
+                    continue;
+                }
+
+                const FMazeParams Read = Baked.GetParams();
+                Check(Read.MazeSize == Params.MazeSize && Read.StartSize == Params.StartSize && Read.NorthSeed == Params.NorthSeed && Read.SouthSeed == Params.SouthSeed
+                    && Read.EastSeed == Params.EastSeed && Read.WestSeed == Params.WestSeed, "baked parameters read back", Size);
+                const FMazeRect ReadRoom = Baked.GetStartRoom();
+                Check(ReadRoom.X == Room.X && ReadRoom.Y == Room.Y && ReadRoom.Width == Room.Width && ReadRoom.Height == Room.Height, "baked start room reads back", Size);
+
+                FMazeBitGrid Walls;
+                Walls.InitFromWalls(Baked.GetWalls());
+                Check(SameWalls(Walls, Grid), "baked walls read back", Size);
+
+                const std::vector<FMazeCell> Exits = GetMazeExitCells(Grid);
+                bool bSameExits = Baked.GetNumExits() == int32_t(Exits.size());
+                for (int32_t i = 0; i < Baked.GetNumExits() && bSameExits; ++i)
+                {
+                    bSameExits = std::any_of(Exits.begin(), Exits.end(), [&](const FMazeCell& Exit) { return Exit.X == Baked.GetExits()[i].X && Exit.Y == Baked.GetExits()[i].Y; });
+                }
+                Check(bSameExits, "baked exits read back", Size);
+
+                FMazeTileArrays Tiles;
+                FMazeTileClassifier().Classify(Grid, Tiles);
+                bool bSameTiles = true;
+                for (size_t i = 0; i < Tiles.Num() && bSameTiles; ++i)
+                {
+                    FMazeTileShape Shape;
+                    bSameTiles = Baked.GetTile(Tiles.X[i], Tiles.Y[i], Shape) && Shape.Type == Tiles.Type[i] && Shape.Rotation == Tiles.Rotation[i];
+                }
+                Check(bSameTiles, "baked tiles read back", Size);
+
+                FMazeFlowField Field;
+                Field.Build(Grid, Exits);
+                FMazeFlowField BakedField;
+                Check(Baked.BuildExitField(BakedField, &Pool), "baked exit field builds", Size);
+                bool bSameDistances = true;
+                for (int32_t y = 0; y < Size && bSameDistances; ++y)
+                {
+                    for (int32_t x = 0; x < Size && bSameDistances; ++x)
+                    {
+                        bSameDistances = Baked.GetDistance(x, y) == Field.GetDistance(x, y) && BakedField.GetDistance(x, y) == Field.GetDistance(x, y)
+                            && (!Field.IsReachable(x, y) || BakedField.GetDirection(x, y) == Field.GetDirection(x, y));
+                    }
+                }
+                Check(bSameDistances, "baked distances read back", Size);
+            }
+
+            // One flipped byte in the wall plane fails the checksum
+            {
+                FILE* File = std::fopen(Path.c_str(), "r+b");
+                FMazeBakedHeader Header;
+                const bool bRead = File && std::fread(&Header, sizeof(Header), 1, File) == 1;
+                Check(bRead, "baked header can be read back", Size);
+                if (bRead)
+                {
+                    unsigned char Byte = 0;
+                    std::fseek(File, long(Header.WallsOffset + 8), SEEK_SET);
+                    std::fread(&Byte, 1, 1, File);
+                    Byte ^= 0x10;
+                    std::fseek(File, long(Header.WallsOffset + 8), SEEK_SET);
+                    std::fwrite(&Byte, 1, 1, File);
+                }
+                if (File)
+                {
+                    std::fclose(File);
+                }
+                FMazeBakedMaze Baked;
+                Check(!Baked.Open(Path), "corrupted baked file is rejected", Size);
+            }
+
+            // An open guard bit next to the middle row is caught without the checksum
+            if (WriteMazeBakedFile(Path, Params, Room, Grid, Options, &Pool))
+            {
+                FMazeBakedMaze Baked;
+                Check(Baked.Open(Path, false), "baked file opens without the checksum", Size);
+                const uint64_t WallsOffset = Baked.IsOpen() ? Baked.GetHeader().WallsOffset : 0;
+                Baked.Close();
+
+                const int32_t Bit = Size + FMazeBitGrid::GuardCells;
+                const uint64_t Word = uint64_t(Size / 2 + FMazeBitGrid::GuardCells) * FMazeBitGrid::GetWordsPerRow(Size) + Bit / 64;
+                FILE* File = std::fopen(Path.c_str(), "r+b");
+                if (File && WallsOffset)
+                {
+                    unsigned char Byte = 0;
+                    std::fseek(File, long(WallsOffset + Word * 8 + Bit % 64 / 8), SEEK_SET);
+                    std::fread(&Byte, 1, 1, File);
+                    Byte &= ~(1 << Bit % 8);
+                    std::fseek(File, long(WallsOffset + Word * 8 + Bit % 64 / 8), SEEK_SET);
+                    std::fwrite(&Byte, 1, 1, File);
+                }
+                if (File)
+                {
+                    std::fclose(File);
+                }
+                Check(!Baked.Open(Path, false), "baked file with an open guard cell is rejected", Size);
+            }
+        }
+        std::remove(Path.c_str());
+    }
+
+    void TestPathQueries(FMazeThreadPool& Pool)
+    {
+        const FMazeParams Params = MakeParams(201, 9);
+        auto Grid = std::make_shared<FMazeBitGrid>();
+        FMazeTiledGenerator(Pool).Generate(Params, FMazeTiledSettings(), *Grid);
+        const std::vector<FMazeCell> Open = GetMazeRoomCells(*Grid, FMazeRect{ 0, 0, Grid->GetWidth(), Grid->GetHeight() });
+
+        // A few goals shared by many starts, so groups are searched on several workers with reused scratch
+        std::vector<FMazePathRequest> Requests;
+        for (uint64_t i = 0; i < 400; ++i)
+        {
+            Requests.push_back(FMazePathRequest{ i, Open[(i * 7919) % Open.size()], Open[(i % 5) * 1543 % Open.size()] });
+        }
+        Requests.push_back(FMazePathRequest{ 400, FMazeCell{ 0, 0 }, Open[0] });
+
+        FMazePathQueryService Service(Grid, Pool);
+        for (int32_t Batch = 0; Batch < 2; ++Batch)
+        {
+            Service.SubmitBatch(Requests);
+        }
+        std::vector<FMazeFlowField> Fields(Requests.size());
+        int32_t NumChecked = 0;
+        while (Service.GetNumPending() > 0)
+        {
+            FMazePathResult Result;
+            if (!Service.PollResult(Result))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            const FMazePathRequest& Request = Requests[Result.Id];
+            FMazeFlowField& Field = Fields[Result.Id];
+            if (Field.GetWidth() == 0)
+            {
+                Field.Build(*Grid, { Request.Goal });
+            }
+            bool bShortest = Result.bFound == Field.IsReachable(Request.Start.X, Request.Start.Y) && (!Result.bFound || Result.Path.size() == Field.GetDistance(Request.Start.X, Request.Start.Y) + 1);
+            for (size_t i = 1; i < Result.Path.size() && bShortest; ++i)
+            {
+                const FMazeCell& A = Result.Path[i - 1];
+                const FMazeCell& B = Result.Path[i];
+                bShortest = std::abs(A.X - B.X) + std::abs(A.Y - B.Y) == 1 && !Grid->IsWall(B.X, B.Y);
+            }
+            Check(bShortest, "path queries return shortest open paths", Params.MazeSize);
+            ++NumChecked;
+        }
+        Check(NumChecked == int32_t(Requests.size()) * 2, "path queries answer every request", Params.MazeSize);
+    }
+
+    void TestDiskCache(FMazeThreadPool& Pool, const std::string& Scratch)
+    {
+        namespace fs = std::filesystem;
+        const fs::path Directory = fs::path(Scratch) / "MazeTestsCache";
+        std::error_code Error;
+        fs::remove_all(Directory, Error);
+
+        const FMazeParams Params = MakeParams(65, 5);
+        auto Grid = std::make_shared<FMazeBitGrid>();
+        FMazeTiledGenerator(Pool).Generate(Params, FMazeTiledSettings(), *Grid);
+        FMazeCacheKey Key;
+        Key.Params = Params;
+        Key.GeneratorId = 1;
+
+        // Leftovers of stores that died, one long ago and one that may still be running
+        const fs::path StaleTemp = Directory / "0123456789abcdef.maze.4d2.1f.7.tmp";
+        const fs::path FreshTemp = Directory / "0123456789abcdef.maze.4d2.1f.8.tmp";
+        fs::create_directories(Directory, Error);
+        std::fclose(std::fopen(StaleTemp.string().c_str(), "wb"));
+        std::fclose(std::fopen(FreshTemp.string().c_str(), "wb"));
+        fs::last_write_time(StaleTemp, fs::file_time_type::clock::now() - std::chrono::hours(1), Error);
+
+        {
+            FMazeDiskCache Cache(Directory.string(), uint64_t(1) << 30, Pool);
+            Cache.StoreAsync(Key, Grid, GetLatticeStartRoom(Params));
+            Cache.Flush();
+
+            FMazeBitGrid Loaded;
+            Check(Cache.TryLoad(Key, Loaded) && SameWalls(Loaded, *Grid), "disk cache hits on the stored key", Params.MazeSize);
+            Check(!fs::exists(StaleTemp) && fs::exists(FreshTemp), "disk cache sweeps stale temp files only", Params.MazeSize);
+
+            // Pretend the hashes of keys that differ in one field collided: the entry must not be taken for theirs
+            FMazeCacheKey OtherExits = Key;
+            OtherExits.Params.NumExits += 1;
+            FMazeCacheKey OtherGenerator = Key;
+            OtherGenerator.GeneratorId = 2;
+            for (const FMazeCacheKey& Other : { OtherExits, OtherGenerator })
+            {
+                fs::copy_file(Cache.GetPath(Key), Cache.GetPath(Other), fs::copy_options::overwrite_existing, Error);
+                Check(!Cache.TryLoad(Other, Loaded), "disk cache checks every key field", Params.MazeSize);
+            }
+        }
+        fs::remove_all(Directory, Error);
+    }
+}
+
+int main(int Argc, char** Argv)
+{
+    std::string Scratch = ".";
+    for (int i = 1; i + 1 < Argc; i += 2)
+    {
+        if (std::strcmp(Argv[i], "--scratch") == 0)
+        {
+            Scratch = Argv[i + 1];
+        }
+    }
+
+    FMazeThreadPool Pool(4);
+    TestConnectivity(Pool);
+    TestThreadCounts();
+    TestBakedRoundTrip(Pool, Scratch);
+    TestPathQueries(Pool);
+    TestDiskCache(Pool, Scratch);
+
+    std::printf("%s (%d failed)\n", NumFailures == 0 ? "all checks passed" : "checks failed", NumFailures);
+    return NumFailures == 0 ? 0 : 1;
+}
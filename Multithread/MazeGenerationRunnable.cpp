@@ -1,14 +1,22 @@
 #include "MazeGenerationRunnable.h"
 #include "HAL/RunnableThread.h"
+#include "Async/ParallelFor.h"
+#include "MazeStats.h"
+#include "MazeThreadPool.h"
+#include "MazeTiledGenerator.h"
+#include "MazeWedgeGenerator.h"
 
-MazeGenerationRunnable::MazeGenerationRunnable(int32 InMazeSize, int32 InStartSize, int32 InNumExits, int32 InNorthSeed, int32 InSouthSeed, int32 InEastSeed, int32 InWestSeed, std::mutex* InMutex)
-    : MazeSize(InMazeSize), StartSize(InStartSize), NumExits(InNumExits), NorthSeed(InNorthSeed), SouthSeed(InSouthSeed), EastSeed(InEastSeed), WestSeed(InWestSeed), bFinished(false), Mutex(InMutex)
+namespace
+{
+    FTransform GetBoxTransform(const FMazeInstanceBox& Box)
+    {
+        return FTransform(FRotator::ZeroRotator, FVector(Box.Location.X, Box.Location.Y, Box.Location.Z), FVector(Box.ScaleX, Box.ScaleY, 1.0f));
+    }
+}
+
+MazeGenerationRunnable::MazeGenerationRunnable(int32 InMazeSize, int32 InStartSize, int32 InNumExits, int32 InNorthSeed, int32 InSouthSeed, int32 InEastSeed, int32 InWestSeed, EMazeCarverMode InCarverMode, float InSpacing, bool bInMergeWalls, bool bInBuildFlowFields, bool bInBuildCorridorGraph)
+    : MazeSize(InMazeSize), StartSize(InStartSize), NumExits(InNumExits), NorthSeed(InNorthSeed), SouthSeed(InSouthSeed), EastSeed(InEastSeed), WestSeed(InWestSeed), CarverMode(InCarverMode), Spacing(InSpacing), bMergeWalls(bInMergeWalls), bBuildFlowFields(bInBuildFlowFields), bBuildCorridorGraph(bInBuildCorridorGraph), bFinished(false)
 {
-    Directions = { FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1) };
-    AlgIds.Add("N", 0);
-    AlgIds.Add("S", 1);
-    AlgIds.Add("E", 2);
-    AlgIds.Add("W", 3);
 }
 
 MazeGenerationRunnable::~MazeGenerationRunnable() {}
@@ -20,7 +28,53 @@ bool MazeGenerationRunnable::Init()
 
 uint32 MazeGenerationRunnable::Run()
 {
-    GenerateMaze();
+    bFromDiskCache = DiskCache && DiskCache->TryLoad(GetCacheKey(), MazeGrid);
+    if (!bFromDiskCache)
+    {
+        GenerateMaze();
+        if (bValidateConnectivity && StopTaskCounter.GetValue() == 0)
+        {
+            ValidateConnectivity();
+        }
+
+        // Written on the pool from a copy, the grid itself goes on to the transforms and the actor
+        if (DiskCache && StopTaskCounter.GetValue() == 0)
+        {
+            DiskCache->StoreAsync(GetCacheKey(), std::make_shared<const FMazeBitGrid>(MazeGrid), GetStartRoomCells());
+        }
+    }
+
+    // Skip the transform buffer if generation was cancelled, nothing will be submitted
+    if (StopTaskCounter.GetValue() == 0)
+    {
+        MAZE_STAT_SCOPE("Maze.WallTransforms", STAT_MazeWallTransforms);
+        const FMazeInstanceLayout Layout = FMazeInstanceBuilder::GetCenteredLayout(MazeGrid, Spacing);
+        if (WallChunkCells > 0)
+        {
+            BuildWallChunkTransforms(MazeGrid, Layout, WallChunkCells, bMergeWalls, WallChunkTransforms, &WallMergeStats);
+        }
+        else
+        {
+            BuildWallTransforms(MazeGrid, Layout, bMergeWalls, WallTransforms, &WallMergeStats);
+        }
+    }
+    if (bBuildFlowFields && StopTaskCounter.GetValue() == 0)
+    {
+        MAZE_STAT_SCOPE("Maze.FlowFields", STAT_MazeFlowFields);
+        // Same room the actor rebuilds its fields from, on the lattice in Tiled mode
+        TSharedPtr<FMazeFlowField> ExitField = MakeShared<FMazeFlowField>();
+        TSharedPtr<FMazeFlowField> CenterField = MakeShared<FMazeFlowField>();
+        BuildFlowFields(MazeGrid, GetStartRoomCells(), *ExitField, *CenterField);
+        ExitFlowField = ExitField;
+        CenterFlowField = CenterField;
+    }
+    if (bBuildCorridorGraph && StopTaskCounter.GetValue() == 0)
+    {
+        MAZE_STAT_SCOPE("Maze.CorridorGraph", STAT_MazeCorridorGraph);
+        TSharedPtr<FMazeCorridorGraph> Graph = MakeShared<FMazeCorridorGraph>();
+        Graph->Build(MazeGrid, &FMazeThreadPool::GetShared());
+        CorridorGraph = Graph;
+    }
     bFinished = true;
     return 0;
 }
@@ -28,13 +82,12 @@ uint32 MazeGenerationRunnable::Run()
 void MazeGenerationRunnable::Stop()
 {
     StopTaskCounter.Increment();
+    bStopRequested = true;
 }
 
-void MazeGenerationRunnable::EnsureCompletion()
+void MazeGenerationRunnable::EnsureCompletion(FRunnableThread* Thread)
 {
     Stop();
-    // Note: WaitForCompletion() is not a member function of FRunnableThread.
-    // Use appropriate thread join or wait logic here.
     if (Thread)
     {
         Thread->WaitForCompletion();
@@ -43,148 +96,161 @@ void MazeGenerationRunnable::EnsureCompletion()
 
 void MazeGenerationRunnable::GenerateMaze()
 {
-    std::lock_guard<std::mutex> guard(*Mutex);  // Lock the mutex for accessing shared data
-
-    MazeArray.SetNum(MazeSize);
-    for (int32 i = 0; i < MazeSize; ++i)
+    if (CarverMode == EMazeCarverMode::Tiled)
     {
-        MazeArray[i].SetNum(MazeSize);
-        for (int32 j = 0; j < MazeSize; ++j)
-        {
-            MazeArray[i][j] = 1;
-        }
+        // Scales with core count; builds its own start room, perimeter and exits
+        MAZE_STAT_SCOPE("Maze.Carve", STAT_MazeCarve);
+        FMazeTiledGenerator TiledGenerator(FMazeThreadPool::GetShared());
+        TiledGenerator.Generate(GetParams(), FMazeTiledSettings(), MazeGrid);
+        return;
     }
 
-    int32 centerX = MazeSize / 2;
-    int32 centerY = MazeSize / 2;
-    int32 startX = centerX - StartSize / 2;
-    int32 startY = centerY - StartSize / 2;
+    FMazeWedgeSettings Settings;
+    std::copy(std::begin(CarverAlgorithms), std::end(CarverAlgorithms), std::begin(Settings.Algorithms));
+    Settings.Mode = CarverMode == EMazeCarverMode::Concurrent ? EMazeWedgeMode::Concurrent : EMazeWedgeMode::RoundRobin;
+
+    // The service's arena when there is one, so generating again at the same size or smaller allocates no stacks
+    FMazeCarverArena OwnArena;
+    FMazeCarverArena& Arena = CarverArena ? *CarverArena : OwnArena;
+
+    MAZE_STAT_SCOPE("Maze.Carve", STAT_MazeCarve);
+    FMazeWedgeGenerator(&FMazeThreadPool::GetShared()).Generate(GetParams(), Settings, Arena, MazeGrid, &bStopRequested);
+}
+
+void MazeGenerationRunnable::BuildWallTransforms(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, bool bMerge, TArray<FTransform>& OutTransforms, FMazeWallMergeStats* OutStats)
+{
+    const FMazeInstanceBuilder Builder(&FMazeThreadPool::GetShared());
+    const int32 BlockSize = 16384;
 
-    for (int32 i = 0; i < StartSize; ++i)
+    if (bMerge)
     {
-        for (int32 j = 0; j < StartSize; ++j)
-        {
-            MazeArray[startY + i][startX + j] = 0;
-        }
+        std::vector<FMazeInstanceBox> Boxes;
+        Builder.BuildMergedWallBoxes(Grid, Layout, Boxes, OutStats);
+        BuildBoxTransforms(Boxes, OutTransforms);
+        return;
     }
 
-    Stacks.Add("N", { FIntPoint(centerX, startY - 1) });
-    Stacks.Add("S", { FIntPoint(centerX, startY + StartSize) });
-    Stacks.Add("E", { FIntPoint(startX + StartSize, centerY) });
-    Stacks.Add("W", { FIntPoint(startX - 1, centerY) });
+    std::vector<FMazeInstanceLocation> Locations;
+    Builder.BuildWallLocations(Grid, Layout, Locations);
 
-    bool anyActive = true;
-    while (anyActive && StopTaskCounter.GetValue() == 0)
+    // Convert in blocks, FTransform construction is cheap but there can be millions of them
+    const int32 NumLocations = int32(Locations.size());
+    OutTransforms.SetNumUninitialized(NumLocations);
+    ParallelFor(FMath::DivideAndRoundUp(NumLocations, BlockSize), [&Locations, &OutTransforms, NumLocations, BlockSize](int32 Block)
     {
-        anyActive = false;
-
-        for (const auto& Dir : AlgIds)
+        const int32 End = FMath::Min(NumLocations, (Block + 1) * BlockSize);
+        for (int32 i = Block * BlockSize; i < End; ++i)
         {
-            bool stepResult = false;
-            CarvePathStep(Dir.Key, Dir.Value, stepResult);
-            anyActive = anyActive || stepResult;
+            const FMazeInstanceLocation& Location = Locations[i];
+            OutTransforms[i] = FTransform(FVector(Location.X, Location.Y, Location.Z));
         }
-    }
+    });
 
-    CreatePerimeterWall();
-    FRandomStream RandStream(NorthSeed + SouthSeed + EastSeed + WestSeed);
-    CreateExits(RandStream);
+    if (OutStats)
+    {
+        OutStats->WallCells = NumLocations;
+        OutStats->Instances = NumLocations;
+    }
 }
 
-void MazeGenerationRunnable::CarvePathStep(FString Direction, int32 Seed, bool& bContinue)
+void MazeGenerationRunnable::BuildWallChunkTransforms(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, int32 ChunkCells, bool bMerge, TArray<TArray<FTransform>>& OutTransforms, FMazeWallMergeStats* OutStats)
 {
-    std::lock_guard<std::mutex> guard(*Mutex);  // Lock the mutex for accessing shared data
+    FMazeInstanceChunkGrid Chunks;
+    FMazeInstanceBuilder(&FMazeThreadPool::GetShared()).BuildWallChunks(Grid, Layout, ChunkCells, bMerge, Chunks, OutStats);
 
-    TArray<FIntPoint>& stack = Stacks[Direction];
-    if (!stack.IsEmpty())
+    // Chunks are small, one task each
+    const int32 NumChunks = int32(Chunks.Chunks.size());
+    OutTransforms.Reset();
+    OutTransforms.SetNum(NumChunks);
+    ParallelFor(NumChunks, [&Chunks, &OutTransforms](int32 Index)
     {
-        FRandomStream RandStream(Seed);
-        FIntPoint current = stack.Last();
-        ShuffleDirections(RandStream);
-
-        TArray<FIntPoint> neighbors = GetUnvisitedNeighbors(current.X, current.Y, RandStream);
-        if (!neighbors.IsEmpty())
+        const std::vector<FMazeInstanceBox>& Boxes = Chunks.Chunks[Index].Boxes;
+        TArray<FTransform>& Transforms = OutTransforms[Index];
+        Transforms.SetNumUninitialized(int32(Boxes.size()));
+        for (int32 i = 0; i < Transforms.Num(); ++i)
         {
-            FIntPoint next = neighbors[RandStream.RandRange(0, neighbors.Num() - 1)];
-            MazeArray[next.Y][next.X] = 0;
-            MazeArray[(current.Y + next.Y) / 2][(current.X + next.X) / 2] = 0;
-
-            stack.Add(next);
-            bContinue = true;
+            Transforms[i] = GetBoxTransform(Boxes[i]);
         }
-        else
+    });
+}
+
+void MazeGenerationRunnable::BuildBoxTransforms(const std::vector<FMazeInstanceBox>& Boxes, TArray<FTransform>& OutTransforms)
+{
+    const int32 BlockSize = 16384;
+    const int32 NumBoxes = int32(Boxes.size());
+    OutTransforms.SetNumUninitialized(NumBoxes);
+    ParallelFor(FMath::DivideAndRoundUp(NumBoxes, BlockSize), [&Boxes, &OutTransforms, NumBoxes, BlockSize](int32 Block)
+    {
+        const int32 End = FMath::Min(NumBoxes, (Block + 1) * BlockSize);
+        for (int32 i = Block * BlockSize; i < End; ++i)
         {
-            stack.Pop();
+            OutTransforms[i] = GetBoxTransform(Boxes[i]);
         }
-    }
+    });
 }
 
-void MazeGenerationRunnable::ShuffleDirections(FRandomStream& RandStream)
+void MazeGenerationRunnable::SetCarverAlgorithms(EMazeCarverAlgorithm North, EMazeCarverAlgorithm South, EMazeCarverAlgorithm East, EMazeCarverAlgorithm West)
 {
-    std::lock_guard<std::mutex> guard(*Mutex);  // Lock the mutex for accessing shared data
-
-    for (int32 i = Directions.Num() - 1; i > 0; --i)
-    {
-        int32 j = RandStream.RandRange(0, i);
-        Directions.Swap(i, j);
-    }
+    CarverAlgorithms[0] = North;
+    CarverAlgorithms[1] = South;
+    CarverAlgorithms[2] = East;
+    CarverAlgorithms[3] = West;
 }
 
-TArray<FIntPoint> MazeGenerationRunnable::GetUnvisitedNeighbors(int32 x, int32 y, FRandomStream& RandStream)
+FMazeParams MazeGenerationRunnable::GetParams() const
 {
-    std::lock_guard<std::mutex> guard(*Mutex);  // Lock the mutex for accessing shared data
+    FMazeParams Params;
+    Params.MazeSize = MazeSize;
+    Params.StartSize = StartSize;
+    Params.NumExits = NumExits;
+    Params.NorthSeed = NorthSeed;
+    Params.SouthSeed = SouthSeed;
+    Params.EastSeed = EastSeed;
+    Params.WestSeed = WestSeed;
+    return Params;
+}
 
-    TArray<FIntPoint> Neighbors;
-    for (const FIntPoint& Direction : Directions)
+FMazeCacheKey MazeGenerationRunnable::GetCacheKey() const
+{
+    // Tiled lays out a different maze for the same seeds, the carver modes differ by their algorithms, and a
+    // repaired maze can have walls the unrepaired one keeps
+    FMazeCacheKey Key;
+    Key.Params = GetParams();
+    Key.GeneratorId = uint32(CarverMode == EMazeCarverMode::Tiled);
+    Key.GeneratorId |= uint32(bValidateConnectivity && bRepairConnectivity) << 1;
+    if (CarverMode != EMazeCarverMode::Tiled)
     {
-        int32 nx = x + Direction.X * 2;
-        int32 ny = y + Direction.Y * 2;
-
-        if (nx >= 0 && nx < MazeSize && ny >= 0 && ny < MazeSize && MazeArray[ny][nx] == 1)
+        for (int32 Carver = 0; Carver < NumCarvers; ++Carver)
         {
-            Neighbors.Add(FIntPoint(nx, ny));
+            Key.GeneratorId |= uint32(CarverAlgorithms[Carver]) << (8 + 4 * Carver);
         }
     }
-    return Neighbors;
+    return Key;
 }
 
-void MazeGenerationRunnable::CreatePerimeterWall()
+FMazeRect MazeGenerationRunnable::GetStartRoomCells() const
 {
-    std::lock_guard<std::mutex> guard(*Mutex);  // Lock the mutex for accessing shared data
-
-    for (int32 x = 0; x < MazeSize; x++)
-    {
-        MazeArray[0][x] = 1;
-        MazeArray[MazeSize - 1][x] = 1;
-    }
-    for (int32 y = 0; y < MazeSize; y++)
-    {
-        MazeArray[y][0] = 1;
-        MazeArray[y][MazeSize - 1] = 1;
-    }
+    const FMazeParams Params = GetParams();
+    return CarverMode == EMazeCarverMode::Tiled ? GetLatticeStartRoom(Params) : GetStartRoom(Params);
 }
 
-void MazeGenerationRunnable::CreateExits(FRandomStream& RandStream)
+void MazeGenerationRunnable::ValidateConnectivity()
 {
-    std::lock_guard<std::mutex> guard(*Mutex);  // Lock the mutex for accessing shared data
-
-    TArray<FIntPoint> PotentialExits;
-
-    for (int32 x = 1; x < MazeSize - 1; x++)
+    MAZE_STAT_SCOPE("Maze.Validate", STAT_MazeValidate);
+    FMazeConnectivityValidator Validator(&FMazeThreadPool::GetShared());
+    if (bRepairConnectivity)
     {
-        PotentialExits.Add(FIntPoint(x, 0));  // Top row
-        PotentialExits.Add(FIntPoint(x, MazeSize - 1));  // Bottom row
+        Validator.Repair(MazeGrid, GetStartRoomCells(), ConnectivityReport);
     }
-
-    for (int32 y = 1; y < MazeSize - 1; y++)
+    else
     {
-        PotentialExits.Add(FIntPoint(0, y));  // Left column
-        PotentialExits.Add(FIntPoint(MazeSize - 1, y));  // Right column
+        Validator.Validate(MazeGrid, GetStartRoomCells(), ConnectivityReport);
     }
+}
 
-    for (int32 i = 0; i < FMath::Min(NumExits, PotentialExits.Num()); i++)
-    {
-        FIntPoint Exit = PotentialExits[i];
-        MazeArray[Exit.Y][Exit.X] = 0;
-    }
+void MazeGenerationRunnable::BuildFlowFields(const FMazeBitGrid& Grid, const FMazeRect& StartRoom, FMazeFlowField& OutExitField, FMazeFlowField& OutCenterField)
+{
+    FMazeThreadPool& Pool = FMazeThreadPool::GetShared();
+    OutExitField.Build(Grid, GetMazeExitCells(Grid), &Pool);
+    OutCenterField.Build(Grid, GetMazeRoomCells(Grid, StartRoom), &Pool);
 }
@@ -2,33 +2,101 @@
 
 #include "CoreMinimal.h"
 #include "HAL/Runnable.h"
-#include <mutex>
+#include "MazeBitGrid.h"
+#include "MazeCarverPolicies.h"
+#include "MazeConnectivity.h"
+#include "MazeCorridorGraph.h"
+#include "MazeDiskCache.h"
+#include "MazeFlowField.h"
+#include "MazeInstanceBuilder.h"
+#include "MazeRandom.h"
+#include <atomic>
 
 // Forward declaration to avoid circular dependency
 class AMaze_Runner_Maze;
+class FRunnableThread;
+
+// How the four direction carvers share the grid. Each carver owns its wedge of the grid (FMazeWedgeRegion), so
+// RoundRobin and Concurrent carve the same maze.
+enum class EMazeCarverMode : uint8
+{
+    // Carvers take turns on the generation thread
+    RoundRobin,
+    // Each carver runs on its own worker
+    Concurrent,
+    // The grid is split into tiles carved on a worker pool and stitched into one perfect maze
+    Tiled
+};
 
 class MazeGenerationRunnable : public FRunnable
 {
 public:
-    MazeGenerationRunnable(int32 InMazeSize, int32 InStartSize, int32 InNumExits, int32 InNorthSeed, int32 InSouthSeed, int32 InEastSeed, int32 InWestSeed, std::mutex* InMutex);
+    MazeGenerationRunnable(int32 InMazeSize, int32 InStartSize, int32 InNumExits, int32 InNorthSeed, int32 InSouthSeed, int32 InEastSeed, int32 InWestSeed, EMazeCarverMode InCarverMode = EMazeCarverMode::RoundRobin, float InSpacing = 100.0f, bool bInMergeWalls = false, bool bInBuildFlowFields = false, bool bInBuildCorridorGraph = false);
     virtual ~MazeGenerationRunnable();
 
     virtual bool Init() override;
     virtual uint32 Run() override;
     virtual void Stop() override;
-    void EnsureCompletion();
+    void EnsureCompletion(FRunnableThread* Thread);
 
     void GenerateMaze();
-    void CarvePathStep(FString Direction, int32 Seed, bool& bContinue);
-    void ShuffleDirections(FRandomStream& RandStream);
-    TArray<FIntPoint> GetUnvisitedNeighbors(int32 x, int32 y, FRandomStream& RandStream);
-    void CreatePerimeterWall();
-    void CreateExits(FRandomStream& RandStream);
 
-    const TArray<TArray<int32>>& GetMazeArray() const { return MazeArray; }
+    // Algorithm of each direction carver (north, south, east, west), backtracker by default; not used in Tiled mode.
+    // Set before the runnable starts.
+    void SetCarverAlgorithms(EMazeCarverAlgorithm North, EMazeCarverAlgorithm South, EMazeCarverAlgorithm East, EMazeCarverAlgorithm West);
+
+    // Arena the wedge carvers' stacks come from, kept by the caller so later generations reuse it; without one the
+    // runnable reserves its own for each generation. Set before the runnable starts.
+    void SetCarverArena(FMazeCarverArena* InCarverArena) { CarverArena = InCarverArena; }
+
+    // Mazes already in the cache are loaded instead of generated, new ones are stored after generation.
+    // Set before the runnable starts.
+    void SetDiskCache(TSharedPtr<FMazeDiskCache> InDiskCache) { DiskCache = InDiskCache; }
+    bool IsFromDiskCache() const { return bFromDiskCache; }
+
+    // Generated mazes are checked for open cells and exits the start room cannot reach, and with bRepair walls
+    // are opened until everything is connected. Cached mazes were checked before they were stored and are not
+    // checked again. Set before the runnable starts.
+    void SetConnectivityCheck(bool bValidate, bool bRepair) { bValidateConnectivity = bValidate; bRepairConnectivity = bRepair; }
+    const FMazeConnectivityReport& GetConnectivityReport() const { return ConnectivityReport; }
+
+    // The grid is owned by the generation thread until IsFinished() returns true
+    bool IsFinished() const { return bFinished; }
+    const FMazeBitGrid& GetMazeArray() const { return MazeGrid; }
+
+    // With ChunkCells > 0 the walls are built per chunk of ChunkCells x ChunkCells cells (GetWallChunkTransforms)
+    // instead of as one buffer. Set before the runnable starts.
+    void SetWallChunkSize(int32 ChunkCells) { WallChunkCells = ChunkCells; }
+
+    // Wall instance transforms, built on the generation thread so the actor can submit them in one batch
+    const TArray<FTransform>& GetWallTransforms() const { return WallTransforms; }
+
+    // Per chunk, in the row-major order of FMazeInstanceChunkGrid; empty unless a chunk size was set
+    const TArray<TArray<FTransform>>& GetWallChunkTransforms() const { return WallChunkTransforms; }
+    const FMazeWallMergeStats& GetWallMergeStats() const { return WallMergeStats; }
+
+    // Distance / next step towards the nearest exit and towards the start room, only built when requested
+    TSharedPtr<const FMazeFlowField> GetExitFlowField() const { return ExitFlowField; }
+    TSharedPtr<const FMazeFlowField> GetCenterFlowField() const { return CenterFlowField; }
+
+    // Junction graph for path queries, only built when requested
+    TSharedPtr<const FMazeCorridorGraph> GetCorridorGraph() const { return CorridorGraph; }
+
+    // Bulk conversion of a grid's walls into instance transforms, spread over the worker pool.
+    // With bMerge, straight wall runs become single instances scaled along the run.
+    static void BuildWallTransforms(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, bool bMerge, TArray<FTransform>& OutTransforms, FMazeWallMergeStats* OutStats = nullptr);
+
+    // Same, one transform array per chunk of the grid (see FMazeInstanceBuilder::BuildWallChunks)
+    static void BuildWallChunkTransforms(const FMazeWallPlane& Grid, const FMazeInstanceLayout& Layout, int32 ChunkCells, bool bMerge, TArray<TArray<FTransform>>& OutTransforms, FMazeWallMergeStats* OutStats = nullptr);
+
+    // Scaled wall boxes as transforms
+    static void BuildBoxTransforms(const std::vector<FMazeInstanceBox>& Boxes, TArray<FTransform>& OutTransforms);
+
+    // Both agent flow fields of a finished grid: one seeded from the open perimeter cells, one from the start room
+    static void BuildFlowFields(const FMazeBitGrid& Grid, const FMazeRect& StartRoom, FMazeFlowField& OutExitField, FMazeFlowField& OutCenterField);
 
 private:
-    TArray<TArray<int32>> MazeArray;
+    FMazeBitGrid MazeGrid;
     int32 MazeSize;
     int32 StartSize;
     int32 NumExits;
@@ -36,12 +104,41 @@ private:
     int32 SouthSeed;
     int32 EastSeed;
     int32 WestSeed;
-    bool bFinished;
+    EMazeCarverMode CarverMode;
+    float Spacing;
+    bool bMergeWalls;
+    bool bBuildFlowFields;
+    bool bBuildCorridorGraph;
+    std::atomic<bool> bFinished;
+
+    FMazeCarverArena* CarverArena = nullptr;
 
-    TArray<FIntPoint> Directions;
-    TMap<FString, int32> AlgIds;
-    TMap<FString, TArray<FIntPoint>> Stacks;
+    TSharedPtr<FMazeDiskCache> DiskCache;
+    bool bFromDiskCache = false;
+
+    bool bValidateConnectivity = true;
+    bool bRepairConnectivity = true;
+    FMazeConnectivityReport ConnectivityReport;
+
+    int32 WallChunkCells = 0;
+    TArray<FTransform> WallTransforms;
+    TArray<TArray<FTransform>> WallChunkTransforms;
+    FMazeWallMergeStats WallMergeStats;
+    TSharedPtr<const FMazeFlowField> ExitFlowField;
+    TSharedPtr<const FMazeFlowField> CenterFlowField;
+    TSharedPtr<const FMazeCorridorGraph> CorridorGraph;
+
+    // Indexed by carver: north, south, east, west
+    static constexpr int32 NumCarvers = 4;
+    EMazeCarverAlgorithm CarverAlgorithms[NumCarvers] = {};
 
     FThreadSafeCounter StopTaskCounter;
-    std::mutex* Mutex;
+
+    // Stop() for the MazeCore generators, which poll it between batches of steps
+    std::atomic<bool> bStopRequested{ false };
+
+    FMazeParams GetParams() const;
+    FMazeRect GetStartRoomCells() const;
+    void ValidateConnectivity();
+    FMazeCacheKey GetCacheKey() const;
 };
@@ -0,0 +1,120 @@
+#include "MazeGenerationService.h"
+#include "Async/Async.h"
+
+FMazeGenerationJob::FMazeGenerationJob(TUniquePtr<MazeGenerationRunnable> InGenerator, FMazeGenerationCallback InOnCompleted)
+    : Generator(MoveTemp(InGenerator)), OnCompleted(MoveTemp(InOnCompleted)), bFinished(false), bCancelled(false)
+{
+}
+
+void FMazeGenerationJob::Cancel()
+{
+    bCancelled = true;
+    Generator->Stop();
+}
+
+void FMazeGenerationJob::Wait()
+{
+    std::unique_lock<std::mutex> Lock(FinishedMutex);
+    FinishedChanged.wait(Lock, [this]() { return bFinished.load(); });
+}
+
+void FMazeGenerationJob::Execute(FMazeCarverArena& Arena)
+{
+    // A job cancelled while still queued never starts
+    if (!bCancelled && Generator->Init())
+    {
+        Generator->SetCarverArena(&Arena);
+        Generator->Run();
+        Generator->SetCarverArena(nullptr);
+        Generator->Exit();
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock(FinishedMutex);
+        bFinished = true;
+    }
+    FinishedChanged.notify_all();
+}
+
+void FMazeGenerationJob::NotifyCompleted()
+{
+    // Cancel is also called on the game thread, so nothing can slip in between this check and the callback
+    if (!bCancelled && OnCompleted)
+    {
+        OnCompleted(*Generator);
+    }
+    OnCompleted = nullptr;
+}
+
+void FMazeGenerationHandle::Cancel()
+{
+    if (Job.IsValid())
+    {
+        Job->Cancel();
+        Job.Reset();
+    }
+}
+
+void FMazeGenerationHandle::Wait() const
+{
+    if (Job.IsValid())
+    {
+        Job->Wait();
+    }
+}
+
+FMazeGenerationService::FMazeGenerationService(int32 NumWorkers)
+    : Workers(NumWorkers)
+{
+}
+
+FMazeGenerationHandle FMazeGenerationService::Submit(TUniquePtr<MazeGenerationRunnable> Generator, FMazeGenerationCallback OnCompleted)
+{
+    TSharedPtr<FMazeGenerationJob> Job = MakeShared<FMazeGenerationJob>(MoveTemp(Generator), MoveTemp(OnCompleted));
+
+    Workers.Submit([this, Job]()
+    {
+        std::unique_ptr<FMazeCarverArena> Arena = BorrowArena();
+        Job->Execute(*Arena);
+        ReturnArena(std::move(Arena));
+        AsyncTask(ENamedThreads::GameThread, [Job]()
+        {
+            Job->NotifyCompleted();
+        });
+    });
+
+    return FMazeGenerationHandle(Job);
+}
+
+void FMazeGenerationService::ReleaseArenas()
+{
+    std::lock_guard<std::mutex> Lock(ArenaMutex);
+    FreeArenas.clear();
+}
+
+std::unique_ptr<FMazeCarverArena> FMazeGenerationService::BorrowArena()
+{
+    {
+        std::lock_guard<std::mutex> Lock(ArenaMutex);
+        if (!FreeArenas.empty())
+        {
+            std::unique_ptr<FMazeCarverArena> Arena = std::move(FreeArenas.back());
+            FreeArenas.pop_back();
+            return Arena;
+        }
+    }
+    return std::make_unique<FMazeCarverArena>();
+}
+
+void FMazeGenerationService::ReturnArena(std::unique_ptr<FMazeCarverArena> Arena)
+{
+    std::lock_guard<std::mutex> Lock(ArenaMutex);
+    FreeArenas.push_back(std::move(Arena));
+}
+
+FMazeGenerationService& FMazeGenerationService::Get()
+{
+    // A couple of workers is enough, every generation spreads its own work over the task graph or the maze pool
+    static FMazeGenerationService Service(2);
+    return Service;
+}
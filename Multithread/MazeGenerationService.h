@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MazeCarverArena.h"
+#include "MazeGenerationRunnable.h"
+#include "MazeThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Called on the game thread with the finished generator (grid, wall transforms and merge stats)
+using FMazeGenerationCallback = TFunction<void(const MazeGenerationRunnable& Result)>;
+
+// State shared between a submitted generation, its worker and its handle
+class FMazeGenerationJob
+{
+public:
+    FMazeGenerationJob(TUniquePtr<MazeGenerationRunnable> InGenerator, FMazeGenerationCallback InOnCompleted);
+
+    bool IsFinished() const { return bFinished; }
+    bool IsCancelled() const { return bCancelled; }
+
+    // Safe from any thread; the generator notices through its StopTaskCounter
+    void Cancel();
+
+    // Block until the worker is done with the job
+    void Wait();
+
+private:
+    friend class FMazeGenerationService;
+
+    // Worker side; the wedge carvers take their stacks from Arena
+    void Execute(FMazeCarverArena& Arena);
+
+    // Game thread side
+    void NotifyCompleted();
+
+    TUniquePtr<MazeGenerationRunnable> Generator;
+    FMazeGenerationCallback OnCompleted;
+    std::atomic<bool> bFinished;
+    std::atomic<bool> bCancelled;
+
+    std::mutex FinishedMutex;
+    std::condition_variable FinishedChanged;
+};
+
+// Handle to a submitted generation, cheap to copy. An empty handle is not valid.
+class FMazeGenerationHandle
+{
+public:
+    FMazeGenerationHandle() {}
+    explicit FMazeGenerationHandle(TSharedPtr<FMazeGenerationJob> InJob) : Job(InJob) {}
+
+    bool IsValid() const { return Job.IsValid(); }
+    bool IsFinished() const { return Job.IsValid() && Job->IsFinished(); }
+
+    // Stop the generation and drop its completion callback, then forget the job
+    void Cancel();
+
+    void Wait() const;
+    void Reset() { Job.Reset(); }
+
+private:
+    TSharedPtr<FMazeGenerationJob> Job;
+};
+
+// Persistent workers that run maze generations one job at a time, so starting a maze no longer
+// creates and destroys an FRunnableThread, and completion is pushed to the game thread instead of polled.
+// The service keeps the carver stack arenas: a running job borrows one and hands it back, so there are never more
+// than there are workers, and generating again at the same size or smaller allocates no stacks.
+class FMazeGenerationService
+{
+public:
+    explicit FMazeGenerationService(int32 NumWorkers);
+
+    // Run Generator on a worker; OnCompleted fires on the game thread unless the job was cancelled first
+    FMazeGenerationHandle Submit(TUniquePtr<MazeGenerationRunnable> Generator, FMazeGenerationCallback OnCompleted);
+
+    // Frees the arenas no job is using; later jobs reserve theirs again
+    void ReleaseArenas();
+
+    // Service shared by every maze actor
+    static FMazeGenerationService& Get();
+
+private:
+    std::unique_ptr<FMazeCarverArena> BorrowArena();
+    void ReturnArena(std::unique_ptr<FMazeCarverArena> Arena);
+
+    std::mutex ArenaMutex;
+    std::vector<std::unique_ptr<FMazeCarverArena>> FreeArenas;
+
+    // Declared last so the workers are joined before the arenas go
+    FMazeThreadPool Workers;
+};
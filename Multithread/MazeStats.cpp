@@ -0,0 +1,27 @@
+#include "MazeStats.h"
+
+#if MAZE_TRACE_ENABLED
+DEFINE_STAT(STAT_MazeCarve);
+DEFINE_STAT(STAT_MazeValidate);
+DEFINE_STAT(STAT_MazeWallTransforms);
+DEFINE_STAT(STAT_MazeFlowFields);
+DEFINE_STAT(STAT_MazeCorridorGraph);
+DEFINE_STAT(STAT_MazeAddInstances);
+
+DEFINE_STAT(STAT_MazeStepsTaken);
+DEFINE_STAT(STAT_MazeBacktracks);
+DEFINE_STAT(STAT_MazeNeighborChecks);
+DEFINE_STAT(STAT_MazeInstancesSubmitted);
+DEFINE_STAT(STAT_MazeLockWait);
+#endif
+
+void PublishMazeTraceStats()
+{
+#if MAZE_TRACE_ENABLED
+    SET_DWORD_STAT(STAT_MazeStepsTaken, FMazeTrace::GetCount(EMazeTraceCounter::StepsTaken));
+    SET_DWORD_STAT(STAT_MazeBacktracks, FMazeTrace::GetCount(EMazeTraceCounter::Backtracks));
+    SET_DWORD_STAT(STAT_MazeNeighborChecks, FMazeTrace::GetCount(EMazeTraceCounter::NeighborChecks));
+    SET_DWORD_STAT(STAT_MazeInstancesSubmitted, FMazeTrace::GetCount(EMazeTraceCounter::InstancesSubmitted));
+    SET_FLOAT_STAT(STAT_MazeLockWait, float(double(FMazeTrace::GetCount(EMazeTraceCounter::LockWaitNanoseconds)) * 1e-6));
+#endif
+}
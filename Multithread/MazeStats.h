@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "MazeTrace.h"
+
+// Unreal side of the maze trace ("stat Maze"): a cycle stat per generation phase and the trace counters.
+// Like the Chrome trace it only exists when the module is built with MAZE_TRACE_ENABLED=1.
+#if MAZE_TRACE_ENABLED
+DECLARE_STATS_GROUP(TEXT("Maze"), STATGROUP_Maze, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Carve"), STAT_MazeCarve, STATGROUP_Maze, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Validate"), STAT_MazeValidate, STATGROUP_Maze, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Wall transforms"), STAT_MazeWallTransforms, STATGROUP_Maze, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Flow fields"), STAT_MazeFlowFields, STATGROUP_Maze, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Corridor graph"), STAT_MazeCorridorGraph, STATGROUP_Maze, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Add instances"), STAT_MazeAddInstances, STATGROUP_Maze, );
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Steps taken"), STAT_MazeStepsTaken, STATGROUP_Maze, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Backtracks"), STAT_MazeBacktracks, STATGROUP_Maze, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Neighbour checks"), STAT_MazeNeighborChecks, STATGROUP_Maze, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Instances submitted"), STAT_MazeInstancesSubmitted, STATGROUP_Maze, );
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Lock wait (ms)"), STAT_MazeLockWait, STATGROUP_Maze, );
+
+// One scope feeding both the Chrome trace and the Unreal cycle stat
+#define MAZE_STAT_SCOPE(Name, Stat) MAZE_TRACE_SCOPE(Name); SCOPE_CYCLE_COUNTER(Stat)
+#else
+#define MAZE_STAT_SCOPE(Name, Stat) ((void)0)
+#endif
+
+// Copies the trace counter totals into the accumulator stats. Game thread.
+void PublishMazeTraceStats();
@@ -2,11 +2,37 @@
 #include "Engine/World.h"
 #include "Math/UnrealMathUtility.h"
 #include "MazeGenerationRunnable.h"  // Include the header file for the runnable
+#include "MazeBakedMaze.h"
+#include "MazeGenerationService.h"
+#include "MazeStats.h"
+#include "MazeThreadPool.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/Paths.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+
+// Navigation for one grid, filled on the worker pool and handed to the game thread in one piece
+struct FMazeNavigationBuild
+{
+    // NavigationBuildId of the request, a newer request makes it stale
+    int64 Id = 0;
+    std::shared_ptr<const FMazeBitGrid> Grid;
+    FMazeRect StartRoom;
+
+    // Baked level the grid came from, its exit distances replace the exit search
+    std::shared_ptr<const FMazeBakedMaze> Baked;
+
+    TSharedPtr<FMazeFlowField> ExitField;
+    TSharedPtr<FMazeFlowField> CenterField;
+    TSharedPtr<FMazeCorridorGraph> Graph;
+};
 
 // Sets default values
 AMaze_Runner_Maze::AMaze_Runner_Maze()
 {
+    // Only streaming and time-sliced generation need Tick, they turn it on themselves
     PrimaryActorTick.bCanEverTick = true;
+    PrimaryActorTick.bStartWithTickEnabled = false;
 
     InstancedMeshComponent = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("InstancedStaticMeshComponent"));
     RootComponent = InstancedMeshComponent;
@@ -15,56 +41,87 @@ AMaze_Runner_Maze::AMaze_Runner_Maze()
     StartSize = 10;
     Spacing = 100.0f;
     NumExits = 1;
+    CarverMode = EMazeCarverMode::Concurrent;  // Use Tiled for very large mazes, RoundRobin for a single generation thread
+    bMergeWalls = false;
+    bValidateConnectivity = true;
+    bRepairConnectivity = true;
+    WallChunkSize = 128;
+    bBuildFlowFields = false;
+    bBuildCorridorGraph = false;
+    LastPathRequestId = 0;
+    NavigationBuildId = 0;
 
-    Directions.Add(FIntPoint(1, 0));
-    Directions.Add(FIntPoint(-1, 0));
-    Directions.Add(FIntPoint(0, 1));
-    Directions.Add(FIntPoint(0, -1));
+    bUseDiskCache = false;
+    DiskCacheMaxBytes = 512ll * 1024 * 1024;
 
     NorthSeed = 0;
     SouthSeed = 1;
     EastSeed = 2;
     WestSeed = 3;
 
-    AlgIds.Add("N", 0);
-    AlgIds.Add("S", 1);
-    AlgIds.Add("E", 2);
-    AlgIds.Add("W", 3);
+    NorthAlgorithm = EMazeCarverAlgorithm::Backtracker;
+    SouthAlgorithm = EMazeCarverAlgorithm::Backtracker;
+    EastAlgorithm = EMazeCarverAlgorithm::Backtracker;
+    WestAlgorithm = EMazeCarverAlgorithm::Backtracker;
+
+    bTimeSliced = false;
+    TimeSliceBudgetMicroseconds = 2000;  // 2 ms of every frame
 
-    Runnable = nullptr;
-    Thread = nullptr;
+    bInfiniteMode = false;
+    ChunkSize = 32;
+    ChunkRadius = 2;
+    ChunkCacheCapacity = 64;  // Must stay above (2 * ChunkRadius + 1)^2
+    bHasStreamingCenter = false;
 }
 
 void AMaze_Runner_Maze::BeginPlay()
 {
     Super::BeginPlay();
-    StartMazeGeneration();
+
+    if (bInfiniteMode)
+    {
+        StartChunkStreaming();
+    }
+    else
+    {
+        StartMazeGeneration();
+    }
 }
 
 void AMaze_Runner_Maze::Tick(float DeltaTime)
 {
     Super::Tick(DeltaTime);
 
-    if (Runnable && Runnable->IsFinished())
+    if (PathQueries)
     {
-        PrimaryActorTick.bCanEverTick = false;
-        OnMazeGenerationCompleted();
+        UpdatePathQueries();
+    }
+
+    if (ChunkCache)
+    {
+        UpdateChunkStreaming();
+        return;
+    }
+
+    if (SteppedGenerator)
+    {
+        UpdateTimeSlicedGeneration();
     }
 }
 
 void AMaze_Runner_Maze::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-    if (Thread && Runnable)
-    {
-        Runnable->EnsureCompletion();  // Ensure the runnable completes
-        delete Thread;  // Delete the thread
-        Thread = nullptr;
-    }
+    // The cache waits for its in-flight chunk jobs, which use the generator
+    ChunkCache.Reset();
+    ChunkGenerator.Reset();
 
-    if (Runnable)
+    // The job owns its generator, cancelling only has to stop it and drop the callback
+    GenerationHandle.Cancel();
+
+    // The level is going away, so the stacks kept for the next generation are not worth holding on to
+    if (EndPlayReason != EEndPlayReason::Destroyed)
     {
-        delete Runnable;  // Delete the runnable
-        Runnable = nullptr;
+        FMazeGenerationService::Get().ReleaseArenas();
     }
 
     Super::EndPlay(EndPlayReason);
@@ -72,46 +129,723 @@ void AMaze_Runner_Maze::EndPlay(const EEndPlayReason::Type EndPlayReason)
 
 void AMaze_Runner_Maze::StartMazeGeneration()
 {
-    Runnable = new MazeGenerationRunnable(MazeSize, StartSize, NumExits, NorthSeed, SouthSeed, EastSeed, WestSeed, &MazeArrayMutex);
-    Thread = FRunnableThread::Create(Runnable, TEXT("MazeGenerationThread"));
-    PrimaryActorTick.bCanEverTick = true;
+    // Fields of the previous maze would send agents through walls of the new one, including any still being built
+    ++NavigationBuildId;
+    ExitFlowField.Reset();
+    CenterFlowField.Reset();
+    SetCorridorGraph(nullptr);
+    PathQueries.Reset();
+    QueuedPathRequests.clear();
+    CompletedPaths.Empty();
+
+    if (!BakedMazePath.IsEmpty())
+    {
+        // Nothing in flight may land on top of the baked level
+        GenerationHandle.Cancel();
+        SteppedGenerator.Reset();
+        if (LoadBakedMaze())
+        {
+            return;
+        }
+    }
+
+    if (bTimeSliced)
+    {
+        StartTimeSlicedGeneration();
+        return;
+    }
+
+    GenerationHandle.Cancel();
+
+    TUniquePtr<MazeGenerationRunnable> Generator = MakeUnique<MazeGenerationRunnable>(MazeSize, StartSize, NumExits, NorthSeed, SouthSeed, EastSeed, WestSeed, CarverMode, Spacing, bMergeWalls, bBuildFlowFields, bBuildCorridorGraph);
+    Generator->SetCarverAlgorithms(NorthAlgorithm, SouthAlgorithm, EastAlgorithm, WestAlgorithm);
+    Generator->SetWallChunkSize(WallChunkSize);
+    Generator->SetConnectivityCheck(bValidateConnectivity, bRepairConnectivity);
+    if (bUseDiskCache)
+    {
+        if (!DiskCache)
+        {
+            const FString CacheDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("MazeCache"));
+            DiskCache = MakeShared<FMazeDiskCache>(std::string(TCHAR_TO_UTF8(*CacheDir)), uint64(DiskCacheMaxBytes), FMazeThreadPool::GetShared());
+        }
+        Generator->SetDiskCache(DiskCache);
+    }
+
+    TWeakObjectPtr<AMaze_Runner_Maze> WeakThis(this);
+    GenerationHandle = FMazeGenerationService::Get().Submit(
+        MoveTemp(Generator),
+        [WeakThis](const MazeGenerationRunnable& Result)
+        {
+            if (AMaze_Runner_Maze* Maze = WeakThis.Get())
+            {
+                Maze->OnMazeGenerationCompleted(Result);
+            }
+        });
+}
+
+void AMaze_Runner_Maze::OnMazeGenerationCompleted(const MazeGenerationRunnable& Result)
+{
+    // Transforms were built on the generation worker, submit them in a single batch (one per chunk)
+    InstancedMeshComponent->ClearInstances();
+    WallInstances.Reset();
+    if (WallChunkSize > 0)
+    {
+        SetWallChunks(Result.GetMazeArray().GetWidth(), Result.GetMazeArray().GetHeight(), Result.GetWallChunkTransforms());
+    }
+    else
+    {
+        ClearWallChunks();
+        AddWallInstances(InstancedMeshComponent, Result.GetWallTransforms());
+    }
+
+    const FMazeWallMergeStats& MergeStats = Result.GetWallMergeStats();
+    UE_LOG(LogTemp, Log, TEXT("Maze walls: %lld cells as %lld instances (%.1f%% fewer)%s"), MergeStats.WallCells, MergeStats.Instances, MergeStats.GetReduction() * 100.0,
+        Result.IsFromDiskCache() ? TEXT(", loaded from the disk cache") : TEXT(""));
+
+    const FMazeConnectivityReport& Connectivity = Result.GetConnectivityReport();
+    if (Connectivity.WallsOpened > 0)
+    {
+        UE_LOG(LogTemp, Log, TEXT("Maze connectivity: opened %d walls to join disconnected parts"), Connectivity.WallsOpened);
+    }
+    if (bValidateConnectivity && !Result.IsFromDiskCache() && !Connectivity.IsValid(NumExits))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("Maze connectivity: %lld of %lld open cells and %d of %d exits unreachable from the start room (%d components)"),
+            Connectivity.UnreachableCells, Connectivity.OpenCells, int32(Connectivity.DeadExits.size()), Connectivity.NumExits, Connectivity.NumComponents);
+    }
+
+    ExitFlowField = Result.GetExitFlowField();
+    CenterFlowField = Result.GetCenterFlowField();
+    SetCorridorGraph(Result.GetCorridorGraph());
+    SetPathQueryGrid(std::make_shared<const FMazeBitGrid>(Result.GetMazeArray()));
+    MazeStartRoom = CarverMode == EMazeCarverMode::Tiled ? GetLatticeStartRoom(GetMazeParams()) : GetStartRoom(GetMazeParams());
+
+    GenerationHandle.Reset();
+    PublishMazeTraceStats();
+}
+
+void AMaze_Runner_Maze::StartTimeSlicedGeneration()
+{
+    SteppedGenerator = MakeUnique<FMazeSteppedGenerator>();
+    SteppedGenerator->Begin(GetMazeParams());
+
+    // One instance per cell so a cell's instance index is simply y * MazeSize + x
+    const FMazeBitGrid& Grid = SteppedGenerator->GetGrid();
+    const int32 Width = Grid.GetWidth();
+    TArray<FTransform> Transforms;
+    Transforms.SetNumUninitialized(Width * Grid.GetHeight());
+    ParallelFor(Grid.GetHeight(), [this, &Grid, &Transforms, Width](int32 y)
+    {
+        for (int32 x = 0; x < Width; x++)
+        {
+            Transforms[y * Width + x] = GetCellTransform(x, y, Grid.IsWall(x, y));
+        }
+    });
+
+    ClearWallChunks();
+    InstancedMeshComponent->ClearInstances();
+    WallInstances.Reset();
+    AddWallInstances(InstancedMeshComponent, Transforms);
+    SetActorTickEnabled(true);
+}
+
+void AMaze_Runner_Maze::UpdateTimeSlicedGeneration()
+{
+    SteppedGenerator->StepFor(std::chrono::microseconds(TimeSliceBudgetMicroseconds));
+
+    // Hide the instances of the cells carved this frame, the render state is refreshed once for the whole batch
+    SteppedGenerator->ConsumeRevealed(RevealedCells);
+    const int32 Width = SteppedGenerator->GetGrid().GetWidth();
+    for (int32 i = 0; i < int32(RevealedCells.size()); i++)
+    {
+        const FMazeRevealedCell& Cell = RevealedCells[i];
+        const bool bLast = i == int32(RevealedCells.size()) - 1;
+        InstancedMeshComponent->UpdateInstanceTransform(Cell.Y * Width + Cell.X, GetCellTransform(Cell.X, Cell.Y, false), false, bLast, true);
+    }
+
+    if (SteppedGenerator->IsDone())
+    {
+        const FMazeBitGrid& Grid = SteppedGenerator->GetGrid();
+        SetWalls(Grid);
+        BuildNavigation(std::make_shared<const FMazeBitGrid>(Grid), GetStartRoom(GetMazeParams()));
+
+        SteppedGenerator.Reset();
+        SetActorTickEnabled(false);
+        PublishMazeTraceStats();
+    }
+}
+
+void AMaze_Runner_Maze::AddWallInstances(UInstancedStaticMeshComponent* Component, const TArray<FTransform>& Transforms)
+{
+    MAZE_STAT_SCOPE("Maze.AddInstances", STAT_MazeAddInstances);
+    MAZE_TRACE_COUNT(InstancesSubmitted, Transforms.Num());
+    Component->AddInstances(Transforms, false);
+}
+
+void AMaze_Runner_Maze::SetWalls(const FMazeWallPlane& Grid)
+{
+    const FMazeInstanceLayout Layout = FMazeInstanceBuilder::GetCenteredLayout(Grid, Spacing);
+    InstancedMeshComponent->ClearInstances();
+    WallInstances.Reset();
+    if (WallChunkSize > 0)
+    {
+        TArray<TArray<FTransform>> ChunkTransforms;
+        MazeGenerationRunnable::BuildWallChunkTransforms(Grid, Layout, WallChunkSize, bMergeWalls, ChunkTransforms);
+        SetWallChunks(Grid.GetWidth(), Grid.GetHeight(), ChunkTransforms);
+        return;
+    }
+
+    ClearWallChunks();
+    TArray<FTransform> WallTransforms;
+    MazeGenerationRunnable::BuildWallTransforms(Grid, Layout, bMergeWalls, WallTransforms);
+    AddWallInstances(InstancedMeshComponent, WallTransforms);
+}
+
+void AMaze_Runner_Maze::SetWallChunks(int32 Width, int32 Height, const TArray<TArray<FTransform>>& ChunkTransforms)
+{
+    ClearWallChunks();
+    WallChunks.Init(Width, Height, WallChunkSize);
+
+    WallChunkComponents.SetNumZeroed(ChunkTransforms.Num());
+    WallChunkInstances.resize(ChunkTransforms.Num());
+    for (int32 Index = 0; Index < ChunkTransforms.Num(); ++Index)
+    {
+        SetWallChunkInstances(Index, ChunkTransforms[Index]);
+    }
+}
+
+void AMaze_Runner_Maze::ClearWallChunks()
+{
+    for (UHierarchicalInstancedStaticMeshComponent* Component : WallChunkComponents)
+    {
+        if (Component)
+        {
+            Component->DestroyComponent();
+        }
+    }
+    WallChunkComponents.Reset();
+    WallChunkInstances.clear();
+    WallChunks = FMazeInstanceChunkGrid();
+}
+
+void AMaze_Runner_Maze::UpdateWallChunks(const FMazeWallPlane& Grid, const FMazeRect& ChangedCells)
+{
+    if (WallChunkComponents.Num() == 0)
+    {
+        SetWalls(Grid);
+        return;
+    }
+
+    std::vector<int32_t> Indices;
+    WallChunks.GetOverlappingChunks(ChangedCells, Indices);
+    FMazeInstanceBuilder(&FMazeThreadPool::GetShared()).RebuildWallChunks(Grid, FMazeInstanceBuilder::GetCenteredLayout(Grid, Spacing), bMergeWalls, Indices, WallChunks);
+
+    // Boxes are only kept until they are submitted
+    TArray<FTransform> Transforms;
+    for (int32 Index : Indices)
+    {
+        std::vector<FMazeInstanceBox>& Boxes = WallChunks.Chunks[Index].Boxes;
+        MazeGenerationRunnable::BuildBoxTransforms(Boxes, Transforms);
+        SetWallChunkInstances(Index, Transforms);
+        std::vector<FMazeInstanceBox>().swap(Boxes);
+    }
+}
+
+void AMaze_Runner_Maze::SetWallChunkInstances(int32 ChunkIndex, const TArray<FTransform>& Transforms)
+{
+    // Rebuilt chunks map their instances again on the next edit
+    WallChunkInstances[ChunkIndex].Reset();
+
+    UHierarchicalInstancedStaticMeshComponent*& Component = WallChunkComponents[ChunkIndex];
+    if (Component)
+    {
+        Component->ClearInstances();
+    }
+    else if (Transforms.Num() > 0)
+    {
+        Component = CreateWallComponent();
+    }
+
+    if (Component)
+    {
+        AddWallInstances(Component, Transforms);
+    }
+}
+
+void AMaze_Runner_Maze::ApplyWallChange(const FMazeWallPlane& OldGrid, const FMazeWallPlane& NewGrid, const FMazeRegionChange& Change)
+{
+    // Merged boxes span many cells, the chunks they overlap are rebuilt
+    if (bMergeWalls)
+    {
+        UpdateWallChunks(NewGrid, Change.Cells);
+        return;
+    }
+
+    FMazeInstanceEdits Edits;
+    if (WallChunkComponents.Num() == 0)
+    {
+        // InstancedMeshComponent was filled row-major from every wall of the grid
+        if (!WallInstances.IsValid())
+        {
+            WallInstances.Init(OldGrid, FMazeRect{ 0, 0, OldGrid.GetWidth(), OldGrid.GetHeight() });
+        }
+        const int32 OldNum = WallInstances.GetNum();
+        WallInstances.ApplyChange(Change.Opened, Change.Closed, Edits);
+        EditWallInstances(InstancedMeshComponent, OldNum, Edits);
+        return;
+    }
+
+    std::vector<int32_t> Indices;
+    WallChunks.GetOverlappingChunks(Change.Cells, Indices);
+    for (int32 Index : Indices)
+    {
+        // Components were filled row-major from the walls before the change
+        FMazeWallInstanceSet& Instances = WallChunkInstances[Index];
+        if (!Instances.IsValid())
+        {
+            Instances.Init(OldGrid, WallChunks.Chunks[Index].Cells);
+        }
+        const int32 OldNum = Instances.GetNum();
+        Instances.ApplyChange(Change.Opened, Change.Closed, Edits);
+        if (Edits.Updates.empty() && Edits.Adds.empty() && Edits.NewNum == OldNum)
+        {
+            continue;
+        }
+
+        UHierarchicalInstancedStaticMeshComponent*& Component = WallChunkComponents[Index];
+        if (!Component)
+        {
+            Component = CreateWallComponent();
+        }
+        EditWallInstances(Component, OldNum, Edits);
+    }
+}
+
+void AMaze_Runner_Maze::EditWallInstances(UInstancedStaticMeshComponent* Component, int32 OldNum, const FMazeInstanceEdits& Edits)
+{
+    if (Edits.Updates.empty() && Edits.Adds.empty() && Edits.NewNum == OldNum)
+    {
+        return;
+    }
+
+    for (const FMazeInstanceEdits::FUpdate& Update : Edits.Updates)
+    {
+        Component->UpdateInstanceTransform(Update.Index, GetCellTransform(Update.Cell.X, Update.Cell.Y, true), false, false, true);
+    }
+    // Removing from the back never moves an instance that is still in use
+    for (int32 Last = OldNum - 1; Last >= Edits.NewNum; --Last)
+    {
+        Component->RemoveInstance(Last);
+    }
+    if (!Edits.Adds.empty())
+    {
+        TArray<FTransform> Transforms;
+        Transforms.Reserve(int32(Edits.Adds.size()));
+        for (const FMazeCell& Cell : Edits.Adds)
+        {
+            Transforms.Add(GetCellTransform(Cell.X, Cell.Y, true));
+        }
+        AddWallInstances(Component, Transforms);
+    }
+    Component->MarkRenderStateDirty();
+}
+
+UHierarchicalInstancedStaticMeshComponent* AMaze_Runner_Maze::CreateWallComponent()
+{
+    UHierarchicalInstancedStaticMeshComponent* Component = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+    Component->SetStaticMesh(InstancedMeshComponent->GetStaticMesh());
+    Component->SetMaterial(0, InstancedMeshComponent->GetMaterial(0));
+    Component->SetupAttachment(RootComponent);
+    Component->RegisterComponent();
+    return Component;
 }
 
-void AMaze_Runner_Maze::OnMazeGenerationCompleted()
+bool AMaze_Runner_Maze::RegenerateRegion(int32 X, int32 Y, int32 Width, int32 Height, int32 Seed)
 {
-    if (Runnable)
+    // The path query service holds the finished maze; nothing to edit before that or while a new one is coming
+    if (!PathQueries || GenerationHandle.IsValid() || SteppedGenerator || ChunkCache)
+    {
+        return false;
+    }
+
+    // Queries still in flight keep searching the old grid they share
+    const FMazeBitGrid& OldGrid = PathQueries->GetGrid();
+    std::shared_ptr<FMazeBitGrid> Grid = std::make_shared<FMazeBitGrid>(OldGrid);
+    FMazeRegionChange Change;
+    if (!RegionRegenerator.Regenerate(*Grid, FMazeRect{ X, Y, Width, Height }, MixMazeSeed(GetMazeParams().GetCombinedSeed(), uint64(uint32(Seed))), Change))
     {
-        std::lock_guard<std::mutex> lock(MazeArrayMutex);  // Lock the mutex for accessing shared data
-        const TArray<TArray<int32>>& RunnableMazeArray = Runnable->GetMazeArray();
+        return false;
+    }
+    UE_LOG(LogTemp, Log, TEXT("Maze region %dx%d at (%d, %d) regenerated: %d walls opened, %d closed"), Change.Cells.Width, Change.Cells.Height, Change.Cells.X, Change.Cells.Y,
+        int32(Change.Opened.size()), int32(Change.Closed.size()));
+
+    if (!Change.IsEmpty())
+    {
+        ApplyWallChange(OldGrid, *Grid, Change);
+    }
+
+    // Replaces PathQueries, so OldGrid is not used past this point. Flow fields and the corridor graph of the old
+    // grid stay in use until the rebuild on the pool lands.
+    QueuedPathRequests.clear();
+    CompletedPaths.Empty();
+    BuildNavigation(MoveTemp(Grid), MazeStartRoom);
+    PublishMazeTraceStats();
+    return true;
+}
+
+bool AMaze_Runner_Maze::ExportMazeTrace(const FString& FilePath) const
+{
+    return FMazeTrace::WriteChromeTrace(std::string(TCHAR_TO_UTF8(*FilePath)));
+}
+
+void AMaze_Runner_Maze::BuildNavigation(std::shared_ptr<const FMazeBitGrid> Grid, const FMazeRect& StartRoom, std::shared_ptr<const FMazeBakedMaze> Baked)
+{
+    // The path query service only shares the grid, it switches right away
+    MazeStartRoom = StartRoom;
+    SetPathQueryGrid(Grid);
+    ++NavigationBuildId;
+    if (!bBuildFlowFields && !bBuildCorridorGraph)
+    {
+        return;
+    }
+
+    TSharedPtr<FMazeNavigationBuild> Build = MakeShared<FMazeNavigationBuild>();
+    Build->Id = NavigationBuildId;
+    Build->Grid = MoveTemp(Grid);
+    Build->StartRoom = StartRoom;
+    Build->Baked = MoveTemp(Baked);
 
-        int32 centerX = RunnableMazeArray.Num() / 2;
-        int32 centerY = RunnableMazeArray[0].Num() / 2;
-        for (int32 x = 0; x < RunnableMazeArray.Num(); x++)
+    // Each part spreads over the pool itself, so the task is never the only one working
+    const bool bFlowFields = bBuildFlowFields;
+    const bool bCorridorGraph = bBuildCorridorGraph;
+    TWeakObjectPtr<AMaze_Runner_Maze> WeakThis(this);
+    FMazeThreadPool::GetShared().Submit([Build, bFlowFields, bCorridorGraph, WeakThis]()
+    {
+        if (bFlowFields)
         {
-            for (int32 y = 0; y < RunnableMazeArray[x].Num(); y++)
+            MAZE_STAT_SCOPE("Maze.FlowFields", STAT_MazeFlowFields);
+            Build->ExitField = MakeShared<FMazeFlowField>();
+            Build->CenterField = MakeShared<FMazeFlowField>();
+            FMazeThreadPool& Pool = FMazeThreadPool::GetShared();
+            if (Build->Baked && Build->Baked->BuildExitField(*Build->ExitField, &Pool))
+            {
+                Build->CenterField->Build(*Build->Grid, GetMazeRoomCells(*Build->Grid, Build->StartRoom), &Pool);
+            }
+            else
             {
-                if (RunnableMazeArray[y][x] == 1)
-                {
-                    AddWallInstance(x - centerX, y - centerY);
-                }
+                MazeGenerationRunnable::BuildFlowFields(*Build->Grid, Build->StartRoom, *Build->ExitField, *Build->CenterField);
             }
         }
+        if (bCorridorGraph)
+        {
+            MAZE_STAT_SCOPE("Maze.CorridorGraph", STAT_MazeCorridorGraph);
+            Build->Graph = MakeShared<FMazeCorridorGraph>();
+            Build->Graph->Build(*Build->Grid, &FMazeThreadPool::GetShared());
+        }
+        AsyncTask(ENamedThreads::GameThread, [Build, WeakThis]()
+        {
+            if (AMaze_Runner_Maze* Maze = WeakThis.Get())
+            {
+                Maze->OnNavigationBuilt(*Build);
+            }
+        });
+    });
+}
 
-        delete Runnable;
-        Runnable = nullptr;
-        delete Thread;
-        Thread = nullptr;
+void AMaze_Runner_Maze::OnNavigationBuilt(const FMazeNavigationBuild& Build)
+{
+    // Another grid or a new maze came along while this one was being built
+    if (Build.Id != NavigationBuildId)
+    {
+        return;
+    }
+    if (Build.ExitField.IsValid())
+    {
+        ExitFlowField = Build.ExitField;
+        CenterFlowField = Build.CenterField;
+    }
+    if (Build.Graph.IsValid())
+    {
+        SetCorridorGraph(Build.Graph);
     }
+    PublishMazeTraceStats();
 }
 
-void AMaze_Runner_Maze::AddWallInstance(int32 x, int32 y)
+bool AMaze_Runner_Maze::LoadBakedMaze()
 {
-    FVector Location(x * Spacing, y * Spacing, 0.0f);
-    FTransform InstanceTransform(Location);
-    InstancedMeshComponent->AddInstance(InstanceTransform);
+    std::shared_ptr<FMazeBakedMaze> Baked = std::make_shared<FMazeBakedMaze>();
+    if (!Baked->Open(std::string(TCHAR_TO_UTF8(*BakedMazePath))))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("Baked maze %s not loaded (%s), generating instead"), *BakedMazePath, UTF8_TO_TCHAR(Baked->GetError()));
+        return false;
+    }
+
+    // The file defines the level, so cell lookups must use its size
+    const FMazeParams Params = Baked->GetParams();
+    MazeSize = Params.MazeSize;
+    StartSize = Params.StartSize;
+    NumExits = Params.NumExits;
+    NorthSeed = Params.NorthSeed;
+    SouthSeed = Params.SouthSeed;
+    EastSeed = Params.EastSeed;
+    WestSeed = Params.WestSeed;
+
+    // Instances come straight from the mapped wall plane
+    const FMazeWallPlane Walls = Baked->GetWalls();
+    SetWalls(Walls);
+
+    // Navigation needs a grid of its own, a plain copy of the walls. The rest is built on the pool, which keeps
+    // the mapping open to read the baked exit distances.
+    std::shared_ptr<FMazeBitGrid> Grid = std::make_shared<FMazeBitGrid>();
+    Grid->InitFromWalls(Walls);
+    BuildNavigation(Grid, Baked->GetStartRoom(), Baked);
+    PublishMazeTraceStats();
+    return true;
+}
+
+FTransform AMaze_Runner_Maze::GetCellTransform(int32 x, int32 y, bool bVisible) const
+{
+    const FVector Location((x - MazeSize / 2) * Spacing, (y - MazeSize / 2) * Spacing, 0.0f);
+    return FTransform(FRotator::ZeroRotator, Location, bVisible ? FVector(1.0f, 1.0f, 1.0f) : FVector(0.0f, 0.0f, 0.0f));
+}
+
+FVector AMaze_Runner_Maze::GetCellLocation(int32 x, int32 y) const
+{
+    return GetActorLocation() + FVector((x - MazeSize / 2) * Spacing, (y - MazeSize / 2) * Spacing, 0.0f);
+}
+
+FIntPoint AMaze_Runner_Maze::GetCellAt(const FVector& Location) const
+{
+    // Inverse of GetCellTransform
+    const FVector Local = Location - GetActorLocation();
+    return FIntPoint(FMath::RoundToInt(Local.X / Spacing) + MazeSize / 2, FMath::RoundToInt(Local.Y / Spacing) + MazeSize / 2);
+}
+
+bool AMaze_Runner_Maze::GetFlowFieldTarget(const FMazeFlowField* Field, const FVector& Location, FVector& OutTarget) const
+{
+    if (!Field)
+    {
+        return false;
+    }
+
+    const FIntPoint Cell = GetCellAt(Location);
+    if (Cell.X < 0 || Cell.X >= Field->GetWidth() || Cell.Y < 0 || Cell.Y >= Field->GetHeight() || !Field->IsReachable(Cell.X, Cell.Y))
+    {
+        return false;
+    }
+
+    const FMazeCell Next = Field->GetNextStep(Cell.X, Cell.Y);
+    OutTarget = GetCellLocation(Next.X, Next.Y);
+    return true;
+}
+
+bool AMaze_Runner_Maze::GetNextStepTowardsExit(const FVector& Location, FVector& OutTarget) const
+{
+    return GetFlowFieldTarget(ExitFlowField.Get(), Location, OutTarget);
+}
+
+bool AMaze_Runner_Maze::GetNextStepTowardsCenter(const FVector& Location, FVector& OutTarget) const
+{
+    return GetFlowFieldTarget(CenterFlowField.Get(), Location, OutTarget);
+}
+
+int32 AMaze_Runner_Maze::GetDistanceToExit(const FVector& Location) const
+{
+    const FIntPoint Cell = GetCellAt(Location);
+    if (!ExitFlowField.IsValid() || Cell.X < 0 || Cell.X >= ExitFlowField->GetWidth() || Cell.Y < 0 || Cell.Y >= ExitFlowField->GetHeight() || !ExitFlowField->IsReachable(Cell.X, Cell.Y))
+    {
+        return -1;
+    }
+    return int32(ExitFlowField->GetDistance(Cell.X, Cell.Y));
+}
+
+void AMaze_Runner_Maze::SetCorridorGraph(TSharedPtr<const FMazeCorridorGraph> Graph)
+{
+    // The pathfinder references the graph, so it goes first
+    Pathfinder.Reset();
+    CorridorGraph = Graph;
+    if (CorridorGraph.IsValid())
+    {
+        Pathfinder = MakeUnique<FMazeCorridorPathfinder>(*CorridorGraph);
+    }
+}
+
+bool AMaze_Runner_Maze::FindMazePath(const FVector& From, const FVector& To, TArray<FVector>& OutPoints)
+{
+    OutPoints.Reset();
+    if (!Pathfinder)
+    {
+        return false;
+    }
+
+    const FIntPoint FromCell = GetCellAt(From);
+    const FIntPoint ToCell = GetCellAt(To);
+    if (Pathfinder->FindPath(FMazeCell{ FromCell.X, FromCell.Y }, FMazeCell{ ToCell.X, ToCell.Y }, &PathCells) == ~uint32(0))
+    {
+        return false;
+    }
+
+    OutPoints.Reserve(int32(PathCells.size()));
+    for (const FMazeCell& Cell : PathCells)
+    {
+        OutPoints.Add(GetCellLocation(Cell.X, Cell.Y));
+    }
+    return true;
+}
+
+void AMaze_Runner_Maze::SetPathQueryGrid(std::shared_ptr<const FMazeBitGrid> Grid)
+{
+    // The service shares Grid with its in-flight searches and is the actor's copy of the finished maze
+    PathQueries = MakeUnique<FMazePathQueryService>(MoveTemp(Grid), FMazeThreadPool::GetShared());
+}
+
+int64 AMaze_Runner_Maze::RequestPathAsync(const FVector& From, const FVector& To)
+{
+    if (!PathQueries)
+    {
+        return 0;
+    }
+
+    const FIntPoint FromCell = GetCellAt(From);
+    const FIntPoint ToCell = GetCellAt(To);
+
+    FMazePathRequest Request;
+    Request.Id = uint64(++LastPathRequestId);
+    Request.Start = FMazeCell{ FromCell.X, FromCell.Y };
+    Request.Goal = FMazeCell{ ToCell.X, ToCell.Y };
+    QueuedPathRequests.push_back(Request);
+
+    SetActorTickEnabled(true);
+    return int64(Request.Id);
+}
+
+void AMaze_Runner_Maze::UpdatePathQueries()
+{
+    if (!QueuedPathRequests.empty())
+    {
+        PathQueries->SubmitBatch(MoveTemp(QueuedPathRequests));
+        QueuedPathRequests.clear();
+    }
+
+    FMazePathResult Result;
+    while (PathQueries->PollResult(Result))
+    {
+        CompletedPaths.Add(int64(Result.Id), MoveTemp(Result));
+    }
+
+    // Streaming and time-sliced generation keep ticking on their own
+    if (PathQueries->GetNumPending() == 0 && !ChunkCache && !SteppedGenerator)
+    {
+        SetActorTickEnabled(false);
+    }
+}
+
+bool AMaze_Runner_Maze::TryTakePathResult(int64 RequestId, bool& bOutFound, TArray<FVector>& OutPoints)
+{
+    FMazePathResult Result;
+    if (!CompletedPaths.RemoveAndCopyValue(RequestId, Result))
+    {
+        return false;
+    }
+
+    bOutFound = Result.bFound;
+    OutPoints.Reset(int32(Result.Path.size()));
+    for (const FMazeCell& Cell : Result.Path)
+    {
+        OutPoints.Add(GetCellLocation(Cell.X, Cell.Y));
+    }
+    return true;
+}
+
+float AMaze_Runner_Maze::GetGenerationProgress() const
+{
+    if (SteppedGenerator)
+    {
+        return SteppedGenerator->GetProgress();
+    }
+    return GenerationHandle.IsValid() ? 0.0f : 1.0f;
 }
 
 void AMaze_Runner_Maze::GenerateMaze()
 {
     StartMazeGeneration();
 }
+
+FMazeParams AMaze_Runner_Maze::GetMazeParams() const
+{
+    FMazeParams Params;
+    Params.MazeSize = MazeSize;
+    Params.StartSize = StartSize;
+    Params.NumExits = NumExits;
+    Params.NorthSeed = NorthSeed;
+    Params.SouthSeed = SouthSeed;
+    Params.EastSeed = EastSeed;
+    Params.WestSeed = WestSeed;
+    return Params;
+}
+
+void AMaze_Runner_Maze::StartChunkStreaming()
+{
+    ChunkGenerator = MakeUnique<FMazeChunkGenerator>(GetMazeParams(), ChunkSize);
+    ChunkCache = MakeUnique<FMazeChunkCache>(*ChunkGenerator, ChunkCacheCapacity, FMazeThreadPool::GetShared());
+    bHasStreamingCenter = false;
+    SetActorTickEnabled(true);
+}
+
+void AMaze_Runner_Maze::UpdateChunkStreaming()
+{
+    // Queue chunks around the player whenever they cross into another chunk
+    const APawn* Pawn = UGameplayStatics::GetPlayerPawn(this, 0);
+    const FVector PlayerLocation = Pawn ? Pawn->GetActorLocation() - GetActorLocation() : FVector::ZeroVector;
+    const float ChunkExtent = ChunkGenerator->GetChunkSize() * Spacing;
+    const FIntPoint Center(FMath::FloorToInt(PlayerLocation.X / ChunkExtent), FMath::FloorToInt(PlayerLocation.Y / ChunkExtent));
+
+    if (!bHasStreamingCenter || Center != StreamingCenter)
+    {
+        StreamingCenter = Center;
+        bHasStreamingCenter = true;
+        ChunkCache->Prefetch(FMazeChunkCoord{ Center.X, Center.Y }, ChunkRadius);
+    }
+
+    // Completed before evicted, a chunk can finish and be evicted between two ticks
+    std::vector<std::shared_ptr<const FMazeChunk>> CompletedChunks;
+    ChunkCache->ConsumeCompleted(CompletedChunks);
+    for (const std::shared_ptr<const FMazeChunk>& Chunk : CompletedChunks)
+    {
+        AddChunkComponent(*Chunk);
+    }
+
+    std::vector<FMazeChunkCoord> EvictedChunks;
+    ChunkCache->ConsumeEvicted(EvictedChunks);
+    for (const FMazeChunkCoord& Coord : EvictedChunks)
+    {
+        RemoveChunkComponent(FIntPoint(Coord.X, Coord.Y));
+    }
+}
+
+void AMaze_Runner_Maze::AddChunkComponent(const FMazeChunk& Chunk)
+{
+    const FIntPoint ChunkCoord(Chunk.Coord.X, Chunk.Coord.Y);
+    RemoveChunkComponent(ChunkCoord);
+
+    UHierarchicalInstancedStaticMeshComponent* ChunkComponent = CreateWallComponent();
+
+    FMazeInstanceLayout Layout;
+    Layout.Spacing = Spacing;
+    Layout.OriginX = Chunk.Coord.X * Chunk.Grid.GetWidth();
+    Layout.OriginY = Chunk.Coord.Y * Chunk.Grid.GetHeight();
+
+    TArray<FTransform> Transforms;
+    MazeGenerationRunnable::BuildWallTransforms(Chunk.Grid, Layout, bMergeWalls, Transforms);
+    AddWallInstances(ChunkComponent, Transforms);
+
+    ChunkComponents.Add(ChunkCoord, ChunkComponent);
+}
+
+void AMaze_Runner_Maze::RemoveChunkComponent(const FIntPoint& ChunkCoord)
+{
+    if (UHierarchicalInstancedStaticMeshComponent** Found = ChunkComponents.Find(ChunkCoord))
+    {
+        (*Found)->DestroyComponent();
+        ChunkComponents.Remove(ChunkCoord);
+    }
+}
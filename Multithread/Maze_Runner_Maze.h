@@ -2,11 +2,19 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Components/InstancedStaticMeshComponent.h"
-#include <mutex>
 #include "MazeGenerationRunnable.h"
+#include "MazeGenerationService.h"
+#include "MazeChunkStreamer.h"
+#include "MazePathQueryService.h"
+#include "MazeRegionRegenerator.h"
+#include "MazeSteppedGenerator.h"
 #include "Maze_Runner_Maze.generated.h"
 
+class FMazeBakedMaze;
+struct FMazeNavigationBuild;
+
 UCLASS()
 class MAZE_API AMaze_Runner_Maze : public AActor
 {
@@ -15,6 +23,39 @@ class MAZE_API AMaze_Runner_Maze : public AActor
 public:
     AMaze_Runner_Maze();
 
+    // 0..1 while a maze is being generated, 1 once it is done
+    float GetGenerationProgress() const;
+
+    // Flow-field lookups for agents, O(1) each. They return false until a maze with bBuildFlowFields has finished
+    // or when Location is not on a reachable path cell; OutTarget is the centre of the neighbouring cell to move to.
+    bool GetNextStepTowardsExit(const FVector& Location, FVector& OutTarget) const;
+    bool GetNextStepTowardsCenter(const FVector& Location, FVector& OutTarget) const;
+
+    // Steps to the nearest exit, -1 if unknown
+    int32 GetDistanceToExit(const FVector& Location) const;
+
+    // Shortest path on the corridor graph as cell centres from From to To, false if there is no graph yet
+    // (see bBuildCorridorGraph) or no path. Game thread only, the pathfinder scratch is shared.
+    bool FindMazePath(const FVector& From, const FVector& To, TArray<FVector>& OutPoints);
+
+    // Asynchronous path query, answered on the worker pool together with the other requests of this frame.
+    // Returns 0 while no maze is ready. Poll with TryTakePathResult from the following frames.
+    int64 RequestPathAsync(const FVector& From, const FVector& To);
+
+    // True once the result of RequestId has arrived (it is then removed); bOutFound is false if there is no path
+    bool TryTakePathResult(int64 RequestId, bool& bOutFound, TArray<FVector>& OutPoints);
+
+    // Writes the phase timings and counters recorded so far as a Chrome trace (chrome://tracing, Perfetto).
+    // Only has data in builds with MAZE_TRACE_ENABLED=1.
+    bool ExportMazeTrace(const FString& FilePath) const;
+
+    // Re-carves the cells of a rectangle of the finished maze from Seed, keeping every passage that crosses its
+    // edge so the rest of the maze stays connected. Only the walls that changed are touched on the instanced
+    // components and pending async path requests are dropped. Flow fields and the corridor graph are rebuilt on
+    // the worker pool; the old ones answer until the new ones replace them. False while generating or if the
+    // rectangle holds nothing to re-carve.
+    bool RegenerateRegion(int32 X, int32 Y, int32 Width, int32 Height, int32 Seed);
+
 protected:
     virtual void BeginPlay() override;
     virtual void Tick(float DeltaTime) override;
@@ -22,9 +63,57 @@ protected:
 
 private:
     void StartMazeGeneration();
-    void OnMazeGenerationCompleted();
-    void AddWallInstance(int32 x, int32 y);
+
+    // Loads BakedMazePath instead of generating; false (and a warning) if the file is missing or invalid
+    bool LoadBakedMaze();
+
+    // Flow fields, corridor graph and path queries for a finished grid, as far as they are enabled. Path queries
+    // move to Grid at once; fields and graph are built on the worker pool and swapped in by OnNavigationBuilt.
+    // Baked supplies the exit distances when the grid was loaded from a baked level.
+    void BuildNavigation(std::shared_ptr<const FMazeBitGrid> Grid, const FMazeRect& StartRoom, std::shared_ptr<const FMazeBakedMaze> Baked = nullptr);
+    void OnNavigationBuilt(const FMazeNavigationBuild& Build);
+    void OnMazeGenerationCompleted(const MazeGenerationRunnable& Result);
     void GenerateMaze();
+    FMazeParams GetMazeParams() const;
+
+    // Time-sliced mode: generation runs on the game thread a budget at a time
+    void StartTimeSlicedGeneration();
+    void UpdateTimeSlicedGeneration();
+    FTransform GetCellTransform(int32 x, int32 y, bool bVisible) const;
+
+    // Every AddInstances of the actor goes through here so submission shows up in the trace
+    void AddWallInstances(UInstancedStaticMeshComponent* Component, const TArray<FTransform>& Transforms);
+
+    // Replaces the walls of the maze with those of Grid, per chunk or all on InstancedMeshComponent (WallChunkSize)
+    void SetWalls(const FMazeWallPlane& Grid);
+    void SetWallChunks(int32 Width, int32 Height, const TArray<TArray<FTransform>>& ChunkTransforms);
+    void ClearWallChunks();
+
+    // Rebuilds the wall chunks overlapping ChangedCells from Grid, the other chunks keep their instances
+    void UpdateWallChunks(const FMazeWallPlane& Grid, const FMazeRect& ChangedCells);
+    void SetWallChunkInstances(int32 ChunkIndex, const TArray<FTransform>& Transforms);
+
+    // Brings the wall instances from OldGrid to NewGrid after a regional change. Per-cell walls are edited in
+    // place, in the chunks the change overlaps or on InstancedMeshComponent when WallChunkSize is 0; merged walls
+    // rebuild the chunks the change overlaps, or everything without chunks.
+    void ApplyWallChange(const FMazeWallPlane& OldGrid, const FMazeWallPlane& NewGrid, const FMazeRegionChange& Change);
+
+    // Applies edits from a FMazeWallInstanceSet that held OldNum instances of Component
+    void EditWallInstances(UInstancedStaticMeshComponent* Component, int32 OldNum, const FMazeInstanceEdits& Edits);
+
+    // Wall component sharing the mesh and material of InstancedMeshComponent, attached and registered
+    UHierarchicalInstancedStaticMeshComponent* CreateWallComponent();
+
+    FIntPoint GetCellAt(const FVector& Location) const;
+    FVector GetCellLocation(int32 x, int32 y) const;
+    void SetCorridorGraph(TSharedPtr<const FMazeCorridorGraph> Graph);
+    bool GetFlowFieldTarget(const FMazeFlowField* Field, const FVector& Location, FVector& OutTarget) const;
+
+    // Infinite mode streaming
+    void StartChunkStreaming();
+    void UpdateChunkStreaming();
+    void AddChunkComponent(const FMazeChunk& Chunk);
+    void RemoveChunkComponent(const FIntPoint& ChunkCoord);
 
     UPROPERTY(EditAnywhere)
     UInstancedStaticMeshComponent* InstancedMeshComponent;
@@ -33,17 +122,100 @@ private:
     int32 StartSize;
     float Spacing;
     int32 NumExits;
+    EMazeCarverMode CarverMode;
+
+    // Pre-baked level (see MazeCore/Tools/MazeBake.cpp); when set and valid, it replaces generation and its
+    // size and seeds override the ones above
+    FString BakedMazePath;
+
+    // Threaded generation first looks for the same maze under Saved/MazeCache and stores new ones there,
+    // keeping the directory under DiskCacheMaxBytes by dropping the least recently used mazes
+    bool bUseDiskCache;
+    int64 DiskCacheMaxBytes;
+    TSharedPtr<FMazeDiskCache> DiskCache;
+
+    // Check every generated maze for cells and exits the start room cannot reach (logged as a warning), and open
+    // walls to connect them with bRepairConnectivity. Only threaded generation is checked.
+    bool bValidateConnectivity;
+    bool bRepairConnectivity;
+
+    // Merge straight wall runs into scaled instances (needs a one-cell wall mesh with a centred pivot)
+    bool bMergeWalls;
+
+    // Walls go to one hierarchical instanced component per WallChunkSize x WallChunkSize cells, so the renderer
+    // culls whole chunks and a wall change only rebuilds the chunks it touches. 0 puts every wall on
+    // InstancedMeshComponent. WallChunkComponents is indexed like WallChunks, nullptr for chunks without walls.
+    int32 WallChunkSize;
+    FMazeInstanceChunkGrid WallChunks;
+
+    UPROPERTY()
+    TArray<UHierarchicalInstancedStaticMeshComponent*> WallChunkComponents;
+
+    // Cell of every instance of the per-cell wall chunks, built the first time a region change reaches the chunk
+    std::vector<FMazeWallInstanceSet> WallChunkInstances;
+
+    // The same for InstancedMeshComponent when it holds every wall of the grid, reset whenever it is refilled
+    FMazeWallInstanceSet WallInstances;
 
-    TArray<FIntPoint> Directions;
-    TMap<FString, int32> AlgIds;
+    // Build the exit and centre flow fields after generation, for AI agents
+    bool bBuildFlowFields;
+    TSharedPtr<const FMazeFlowField> ExitFlowField;
+    TSharedPtr<const FMazeFlowField> CenterFlowField;
+
+    // Build the corridor graph after generation, for path queries
+    bool bBuildCorridorGraph;
+    TSharedPtr<const FMazeCorridorGraph> CorridorGraph;
+    TUniquePtr<FMazeCorridorPathfinder> Pathfinder;
+    std::vector<FMazeCell> PathCells;
 
     int32 NorthSeed;
     int32 SouthSeed;
     int32 EastSeed;
     int32 WestSeed;
 
-    // Multithreading variables
-    std::mutex MazeArrayMutex;
-    MazeGenerationRunnable* Runnable;
-    FRunnableThread* Thread;
+    // Algorithm of each direction carver in RoundRobin and Concurrent mode; they trade speed, memory and maze
+    // texture differently (see EMazeCarverAlgorithm), so a platform can pick its own
+    EMazeCarverAlgorithm NorthAlgorithm;
+    EMazeCarverAlgorithm SouthAlgorithm;
+    EMazeCarverAlgorithm EastAlgorithm;
+    EMazeCarverAlgorithm WestAlgorithm;
+
+    // Batched path queries against the finished grid: requests queue up during the frame and go out together in Tick
+    void UpdatePathQueries();
+    void SetPathQueryGrid(std::shared_ptr<const FMazeBitGrid> Grid);
+    TUniquePtr<FMazePathQueryService> PathQueries;
+    std::vector<FMazePathRequest> QueuedPathRequests;
+    TMap<int64, FMazePathResult> CompletedPaths;
+    int64 LastPathRequestId;
+
+    // Start room of the current maze, for rebuilding the flow fields after a region is regenerated
+    FMazeRect MazeStartRoom;
+
+    // Bumped by every navigation build and new maze; a finished build with an older id is dropped
+    int64 NavigationBuildId;
+    FMazeRegionRegenerator RegionRegenerator;
+
+    // Generation running on the shared service; completion arrives through OnMazeGenerationCompleted
+    FMazeGenerationHandle GenerationHandle;
+
+    // Time-sliced mode, for platforms without a dedicated generation thread. Every cell starts as a wall instance
+    // and carved cells are hidden as they open; the final (optionally merged) walls replace them once done.
+    bool bTimeSliced;
+    int32 TimeSliceBudgetMicroseconds;
+    TUniquePtr<FMazeSteppedGenerator> SteppedGenerator;
+    std::vector<FMazeRevealedCell> RevealedCells;
+
+    // Infinite mode: stream an unbounded maze in chunks around the player instead of one MazeSize maze
+    bool bInfiniteMode;
+    int32 ChunkSize;
+    int32 ChunkRadius;
+    int32 ChunkCacheCapacity;
+
+    TUniquePtr<FMazeChunkGenerator> ChunkGenerator;
+    TUniquePtr<FMazeChunkCache> ChunkCache;
+    FIntPoint StreamingCenter;
+    bool bHasStreamingCenter;
+
+    UPROPERTY()
+    TMap<FIntPoint, UHierarchicalInstancedStaticMeshComponent*> ChunkComponents;
 };
@@ -1,6 +1,8 @@
 #include "Maze_Runner_Maze.h"
 #include "Engine/World.h"
 #include "Math/UnrealMathUtility.h"  // For FMath::RandRange
+#include "MazeInstanceBuilder.h"
+#include "MazeThreadPool.h"
 
 // Sets default values
 AMaze_Runner_Maze::AMaze_Runner_Maze()
@@ -17,6 +19,7 @@ AMaze_Runner_Maze::AMaze_Runner_Maze()
     StartSize = 10;
     Spacing = 100.0f;
     NumExits = 1;  // Default to 1 exit
+    bMergeWalls = false;
 
     // Initialize directions for carving paths (right, left, up, down)
     Directions.Add(FIntPoint(1, 0));
@@ -29,12 +32,6 @@ AMaze_Runner_Maze::AMaze_Runner_Maze()
     SouthSeed = 1;
     EastSeed = 2;
     WestSeed = 3;
-
-    // Initialize algorithm ids
-    AlgIds.Add("N", 0);
-    AlgIds.Add("S", 1);
-    AlgIds.Add("E", 2);
-    AlgIds.Add("W", 3);
 }
 
 // Called when the game starts or when spawned
@@ -52,19 +49,8 @@ void AMaze_Runner_Maze::Tick(float DeltaTime)
 
 void AMaze_Runner_Maze::GenerateMaze()
 {
-    // Initialize the maze array with walls (1 represents wall, 0 represents path)
-    MazeArray.SetNum(MazeSize);
-    VisitedArray.SetNum(MazeSize);
-    for (int32 i = 0; i < MazeSize; ++i)
-    {
-        MazeArray[i].SetNum(MazeSize);
-        VisitedArray[i].SetNum(MazeSize);
-        for (int32 j = 0; j < MazeSize; ++j)
-        {
-            MazeArray[i][j] = 1;  // Initialize all cells as walls
-            VisitedArray[i][j] = false;
-        }
-    }
+    // Initialize the maze grid with unvisited walls
+    MazeGrid.Init(MazeSize, MazeSize);
 
     // Define the central starting area and mark it
     int32 centerX = MazeSize / 2;
@@ -72,14 +58,7 @@ void AMaze_Runner_Maze::GenerateMaze()
     int32 startX = centerX - StartSize / 2;
     int32 startY = centerY - StartSize / 2;
 
-    for (int32 i = 0; i < StartSize; ++i)
-    {
-        for (int32 j = 0; j < StartSize; ++j)
-        {
-            MazeArray[startY + i][startX + j] = 0;
-            VisitedArray[startY + i][startX + j] = true;
-        }
-    }
+    MazeGrid.ClearRect(startX, startY, StartSize, StartSize);
 
     // Create perimeter wall
     CreatePerimeterWall();
@@ -88,66 +67,95 @@ void AMaze_Runner_Maze::GenerateMaze()
     FRandomStream RandStream(NorthSeed + SouthSeed + EastSeed + WestSeed); // Use combined seeds for consistency
     CreateExits(RandStream);
 
-    // Set starting points outside the central area
-    Stacks.Add("N", { FIntPoint(centerX, centerY - StartSize / 2 - 1) });
-    Stacks.Add("S", { FIntPoint(centerX, centerY + StartSize / 2) });
-    Stacks.Add("E", { FIntPoint(centerX + StartSize / 2, centerY) });
-    Stacks.Add("W", { FIntPoint(centerX - StartSize / 2 - 1, centerY) });
+    // Set starting points outside the central area (north, south, east, west)
+    CarverStarts[0] = FIntPoint(centerX, centerY - StartSize / 2 - 1);
+    CarverStarts[1] = FIntPoint(centerX, centerY + StartSize / 2);
+    CarverStarts[2] = FIntPoint(centerX + StartSize / 2, centerY);
+    CarverStarts[3] = FIntPoint(centerX - StartSize / 2 - 1, centerY);
 
     // Mark the starting points as visited
-    for (auto& Elem : Stacks)
+    for (const FIntPoint& Start : CarverStarts)
     {
-        FIntPoint StartPoint = Elem.Value[0];
-        VisitedArray[StartPoint.Y][StartPoint.X] = true;
-        MazeArray[StartPoint.Y][StartPoint.X] = 0;
+        MazeGrid.Carve(Start.X, Start.Y);
     }
 
+    // Sized once for the deepest path a carver can take, so carving never allocates
+    StackArena.Reserve(1, GetMazeCellStackBound(MazeSize, MazeSize));
+
     // Carve paths from the starting points sequentially
-    CarvePath("N", NorthSeed);
-    CarvePath("S", SouthSeed);
-    CarvePath("E", EastSeed);
-    CarvePath("W", WestSeed);
+    CarvePath(0, NorthSeed);
+    CarvePath(1, SouthSeed);
+    CarvePath(2, EastSeed);
+    CarvePath(3, WestSeed);
 
-    // Add instances based on the maze array
-    for (int32 x = 0; x < MazeSize; x++)
+    // Build every wall location from the bit-planes in bulk and submit them in a single batch
+    const FMazeInstanceBuilder Builder(&FMazeThreadPool::GetShared());
+    const FMazeInstanceLayout Layout = FMazeInstanceBuilder::GetCenteredLayout(MazeGrid, Spacing);
+    TArray<FTransform> WallTransforms;
+
+    if (bMergeWalls)
     {
-        for (int32 y = 0; y < MazeSize; y++)
+        std::vector<FMazeInstanceBox> WallBoxes;
+        FMazeWallMergeStats MergeStats;
+        Builder.BuildMergedWallBoxes(MazeGrid, Layout, WallBoxes, &MergeStats);
+
+        WallTransforms.Reserve(int32(WallBoxes.size()));
+        for (const FMazeInstanceBox& Box : WallBoxes)
         {
-            if (MazeArray[y][x] == 1)
-            {
-                AddWallInstance(x - centerX, y - centerY);
-            }
+            WallTransforms.Add(FTransform(FRotator::ZeroRotator, FVector(Box.Location.X, Box.Location.Y, Box.Location.Z), FVector(Box.ScaleX, Box.ScaleY, 1.0f)));
+        }
+        UE_LOG(LogTemp, Log, TEXT("Maze walls: %lld cells as %lld instances (%.1f%% fewer)"), MergeStats.WallCells, MergeStats.Instances, MergeStats.GetReduction() * 100.0);
+    }
+    else
+    {
+        std::vector<FMazeInstanceLocation> WallLocations;
+        Builder.BuildWallLocations(MazeGrid, Layout, WallLocations);
+
+        WallTransforms.Reserve(int32(WallLocations.size()));
+        for (const FMazeInstanceLocation& Location : WallLocations)
+        {
+            WallTransforms.Add(FTransform(FVector(Location.X, Location.Y, Location.Z)));
         }
     }
+    InstancedMeshComponent->AddInstances(WallTransforms, false);
+
+    AssignTileTypes();
 }
 
-void AMaze_Runner_Maze::CarvePath(FString Direction, int32 Seed)
+void AMaze_Runner_Maze::CarvePath(int32 Carver, int32 Seed)
 {
-    TArray<FIntPoint>& Stack = Stacks[Direction];
+    const FIntPoint Start = CarverStarts[Carver];
+    if (Start.X < 0 || Start.Y < 0 || Start.X >= MazeSize || Start.Y >= MazeSize)
+    {
+        return;
+    }
+
+    FMazeCellStack Stack = StackArena.GetStack(0);
+    Stack.Push(FMazeCell{ Start.X, Start.Y });
     FRandomStream RandStream(Seed);
+    FIntPoint Neighbors[4];
 
-    while (Stack.Num() > 0)
+    while (!Stack.IsEmpty())
     {
-        FIntPoint Current = Stack.Last();
+        const FMazeCell Current = Stack.Top();
         int32 x = Current.X;
         int32 y = Current.Y;
 
         // Shuffle directions to ensure randomness
         ShuffleDirections(RandStream);
 
-        TArray<FIntPoint> Neighbors = GetUnvisitedNeighbors(x, y, RandStream);
-        if (Neighbors.Num() > 0)
+        const int32 NumNeighbors = GetUnvisitedNeighbors(x, y, Neighbors);
+        if (NumNeighbors > 0)
         {
-            FIntPoint Next = Neighbors[RandStream.RandRange(0, Neighbors.Num() - 1)];
+            FIntPoint Next = Neighbors[RandStream.RandRange(0, NumNeighbors - 1)];
             int32 nx = Next.X;
             int32 ny = Next.Y;
 
             // Carve the path between the current cell and the new cell
-            MazeArray[ny][nx] = 0;
-            MazeArray[(y + ny) / 2][(x + nx) / 2] = 0;
-            VisitedArray[ny][nx] = true;
+            MazeGrid.Carve(nx, ny);
+            MazeGrid.ClearWall((x + nx) / 2, (y + ny) / 2);
 
-            Stack.Add(Next);
+            Stack.Push(FMazeCell{ nx, ny });
         }
         else
         {
@@ -174,24 +182,22 @@ void AMaze_Runner_Maze::ShuffleArray(TArray<FIntPoint>& Array, FRandomStream& Ra
     }
 }
 
-TArray<FIntPoint> AMaze_Runner_Maze::GetUnvisitedNeighbors(int32 x, int32 y, FRandomStream& RandStream)
+int32 AMaze_Runner_Maze::GetUnvisitedNeighbors(int32 x, int32 y, FIntPoint (&OutNeighbors)[4]) const
 {
-    TArray<FIntPoint> Neighbors;
+    int32 NumNeighbors = 0;
     for (const FIntPoint& Direction : Directions)
     {
         int32 nx = x + Direction.X * 2;
         int32 ny = y + Direction.Y * 2;
 
-        // Check if the new position is within bounds and not yet visited
-        if (nx >= 0 && nx < MazeSize && ny >= 0 && ny < MazeSize && !VisitedArray[ny][nx])
+        // Guard cells around the grid count as visited, so no bounds checks are needed
+        if (!MazeGrid.IsVisited(nx, ny))
         {
             // Ensure the destination is not adjacent to any visited path
             bool AdjacentVisited = false;
             for (const FIntPoint& Adj : Directions)
             {
-                int32 ax = nx + Adj.X;
-                int32 ay = ny + Adj.Y;
-                if (ax >= 0 && ax < MazeSize && ay >= 0 && ay < MazeSize && VisitedArray[ay][ax])
+                if (MazeGrid.IsVisited(nx + Adj.X, ny + Adj.Y))
                 {
                     AdjacentVisited = true;
                     break;
@@ -199,32 +205,16 @@ TArray<FIntPoint> AMaze_Runner_Maze::GetUnvisitedNeighbors(int32 x, int32 y, FRa
             }
             if (!AdjacentVisited)
             {
-                Neighbors.Add(FIntPoint(nx, ny));
+                OutNeighbors[NumNeighbors++] = FIntPoint(nx, ny);
             }
         }
     }
-    return Neighbors;
-}
-
-void AMaze_Runner_Maze::AddWallInstance(int32 x, int32 y)
-{
-    FVector Location(x * Spacing, y * Spacing, 0.0f);
-    FTransform InstanceTransform(Location);
-    InstancedMeshComponent->AddInstance(InstanceTransform);
+    return NumNeighbors;
 }
 
 void AMaze_Runner_Maze::CreatePerimeterWall()
 {
-    for (int32 x = 0; x < MazeSize; x++)
-    {
-        MazeArray[0][x] = 1;
-        MazeArray[MazeSize - 1][x] = 1;
-    }
-    for (int32 y = 0; y < MazeSize; y++)
-    {
-        MazeArray[y][0] = 1;
-        MazeArray[y][MazeSize - 1] = 1;
-    }
+    MazeGrid.SetPerimeterWalls();
 }
 
 void AMaze_Runner_Maze::CreateExits(FRandomStream& RandStream)
@@ -245,6 +235,29 @@ void AMaze_Runner_Maze::CreateExits(FRandomStream& RandStream)
     for (int32 i = 0; i < FMath::Min(NumExits, PotentialExits.Num()); i++)
     {
         FIntPoint Exit = PotentialExits[i];
-        MazeArray[Exit.Y][Exit.X] = 0;
+        MazeGrid.ClearWall(Exit.X, Exit.Y);
     }
 }
+
+void AMaze_Runner_Maze::AssignTileTypes()
+{
+    // Whole grid at once from the wall bit-plane, one table lookup per path cell
+    FMazeTileArrays Tiles;
+    FMazeTileClassifier(&FMazeThreadPool::GetShared()).Classify(MazeGrid, Tiles);
+
+    const int32 NumTiles = int32(Tiles.Num());
+    PathTiles.SetNumUninitialized(NumTiles);
+    TileTypes.SetNumUninitialized(NumTiles);
+    TileRotations.SetNumUninitialized(NumTiles);
+    for (int32 i = 0; i < NumTiles; i++)
+    {
+        PathTiles[i] = FIntPoint(Tiles.X[i], Tiles.Y[i]);
+        TileTypes[i] = static_cast<ETileType>(Tiles.Type[i]);
+        TileRotations[i] = Tiles.Rotation[i];
+    }
+}
+
+ETileType AMaze_Runner_Maze::DetermineTileType(int32 x, int32 y)
+{
+    return static_cast<ETileType>(GetMazeTileShape(GetMazeTileMask(MazeGrid, x, y)).Type);
+}
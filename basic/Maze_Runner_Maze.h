@@ -3,6 +3,9 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Components/InstancedStaticMeshComponent.h"
+#include "MazeBitGrid.h"
+#include "MazeCarverArena.h"
+#include "MazeTileClassifier.h"
 #include "Maze_Runner_Maze.generated.h"
 
 UENUM(BlueprintType)
@@ -52,6 +55,10 @@ public:
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Maze", meta = (ClampMin = "0", UIMin = "0"))
     int32 NumExits;
 
+    // Merge straight wall runs into single scaled instances (the wall mesh must be one cell wide with a centred pivot)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Maze")
+    bool bMergeWalls;
+
     // Random seed for north path
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Maze")
     int32 NorthSeed;
@@ -80,30 +87,33 @@ public:
     UPROPERTY(BlueprintReadOnly, Category = "Maze")
     TArray<ETileType> TileTypes;
 
+    // Clockwise quarter turns of each path tile, parallel to PathTiles
+    UPROPERTY(BlueprintReadOnly, Category = "Maze")
+    TArray<uint8> TileRotations;
+
 private:
     // Iterative backtracking algorithm to carve paths using stacks
-    void CarvePath(FString Direction, int32 Seed);
+    void CarvePath(int32 Carver, int32 Seed);
 
     // Directions for movement in the maze
     TArray<FIntPoint> Directions;
 
-    // Maze and visited arrays
-    TArray<TArray<int32>> MazeArray;
-    TArray<TArray<bool>> VisitedArray;
+    // Bit-packed maze grid (wall and visited planes)
+    FMazeBitGrid MazeGrid;
+
+    // Starting cells for each direction: north, south, east, west
+    FIntPoint CarverStarts[4];
 
-    // Maze generation stacks for each direction
-    TMap<FString, TArray<FIntPoint>> Stacks;
-    TMap<FString, int32> AlgIds;
+    // Packed backtracking stack, shared by the carvers since they run one after another and kept across
+    // GenerateMaze calls
+    FMazeCarverArena StackArena;
 
     // Manual shuffle function
     void ShuffleDirections(FRandomStream& RandStream);
     void ShuffleArray(TArray<FIntPoint>& Array, FRandomStream& RandStream);
 
-    // Helper function to get unvisited neighbors
-    TArray<FIntPoint> GetUnvisitedNeighbors(int32 x, int32 y, FRandomStream& RandStream);
-
-    // Helper function to add wall instance
-    void AddWallInstance(int32 x, int32 y);
+    // Helper function to get unvisited neighbors, returns how many were written to OutNeighbors
+    int32 GetUnvisitedNeighbors(int32 x, int32 y, FIntPoint (&OutNeighbors)[4]) const;
 
     // Helper function to create perimeter wall
     void CreatePerimeterWall();